@@ -12,29 +12,43 @@
 
 #include "buffer/buffer_pool_manager_instance.h"
 
+#include <algorithm>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "common/exception.h"
+#include "common/logger.h"
 #include "common/macros.h"
 
 namespace bustub {
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
-    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager) {}
+                                                     LogManager *log_manager, ReplacerPolicy replacer_policy)
+    : BufferPoolManagerInstance(pool_size, 1, 0, disk_manager, log_manager, replacer_policy) {}
 
 BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                                                     DiskManager *disk_manager, LogManager *log_manager)
+                                                     DiskManager *disk_manager, LogManager *log_manager,
+                                                     ReplacerPolicy replacer_policy, int numa_node)
     : pool_size_(pool_size),
       num_instances_(num_instances),
       instance_index_(instance_index),
-      next_page_id_(instance_index),
+      frame_arena_(pool_size, numa_node, pool_size * BUFFER_POOL_MAX_GROWTH),
+      pages_(frame_arena_.GetPages()),
       disk_manager_(disk_manager),
       log_manager_(log_manager) {
   BUSTUB_ASSERT(num_instances > 0, "If BPI is not part of a pool, then the pool size should just be 1");
   BUSTUB_ASSERT(
       instance_index < num_instances,
       "BPI index cannot be greater than the number of BPIs in the pool. In non-parallel case, index should just be 1.");
-  // We allocate a consecutive memory space for the buffer pool.
-  pages_ = new Page[pool_size_];
-  replacer_ = new LRUReplacer(pool_size);
+  for (tablespace_id_t tablespace_id = 0; tablespace_id < MAX_TABLESPACES; tablespace_id++) {
+    auto first_page_id = static_cast<uint32_t>(FirstPageIdOf(tablespace_id));
+    next_page_ids_[tablespace_id] =
+        static_cast<page_id_t>(first_page_id + (instance_index + num_instances - first_page_id % num_instances) %
+                                                   num_instances);
+  }
+  // The replacer covers every frame the pool may grow to.
+  replacer_ = CreateReplacer(replacer_policy, frame_arena_.GetCapacity());
 
   // Initially, every page is in the free list.
   for (size_t i = 0; i < pool_size_; ++i) {
@@ -42,66 +56,164 @@ BufferPoolManagerInstance::BufferPoolManagerInstance(size_t pool_size, uint32_t
   }
 }
 
+auto BufferPoolManagerInstance::CreateReplacer(ReplacerPolicy replacer_policy, size_t pool_size) -> Replacer * {
+  switch (replacer_policy) {
+    case ReplacerPolicy::CLOCK:
+      return new ClockReplacer(pool_size);
+    case ReplacerPolicy::LRU_K:
+      return new LRUKReplacer(pool_size, LRUK_REPLACER_K, LRUK_CORRELATED_PERIOD);
+    case ReplacerPolicy::LRU:
+    default:
+      return new LRUReplacer(pool_size);
+  }
+}
+
 BufferPoolManagerInstance::~BufferPoolManagerInstance() {
-  delete[] pages_;
+  StopPageCleaner();
+  StopPrefetcher();
+  StopWarmUp();
   delete replacer_;
 }
 
 auto BufferPoolManagerInstance::FlushPgImp(page_id_t page_id) -> bool {
   // Make sure you call DiskManager::WritePage!
-  auto cnt = this->page_table_.count(page_id);
-  if (cnt == 0 || page_id == INVALID_PAGE_ID) {
+  if (page_id == INVALID_PAGE_ID) {
+    return false;
+  }
+  // The pin keeps the frame from being reused, so no pool latch is held while the page is written.
+  Page *page = this->PinResidentPage(page_id, false);
+  if (page == nullptr) {
     // LOG_INFO("instance %d page id %d does not exist or invalid", this->instance_index_, page_id);
     return false;
   }
   // LOG_INFO("instance %d Flush page id %d", this->instance_index_, page_id);
-  Page *page = &this->pages_[this->page_table_[page_id]];
-  if (!page->IsDirty()) {
-    return true;
+  if (this->WriteBackPage(page_id, page)) {
+    this->disk_manager_->Sync();
+    this->counters_.Add(BufferPoolCounters::FLUSHES);
   }
-  this->disk_manager_->WritePage(page_id, page->data_);
+  this->UnpinPgImp(page_id, false);
   return true;
 }
 
 void BufferPoolManagerInstance::FlushAllPgsImp() {
   // You can do it!
   // LOG_INFO("instance %d Flush all page", this->instance_index_);
-  for (auto item : this->page_table_) {
-    if (item.first == INVALID_PAGE_ID) {
-      continue;
+  this->WriteDirtyPages();
+  this->disk_manager_->Sync();
+}
+
+void BufferPoolManagerInstance::WriteDirtyPages() {
+  std::vector<page_id_t> dirty_page_ids;
+  for (auto &shard : this->page_table_) {
+    std::shared_lock<std::shared_mutex> shard_guard(shard.latch_);
+    for (auto item : shard.map_) {
+      if (this->pages_[item.second].IsDirty()) {
+        dirty_page_ids.push_back(item.first);
+      }
     }
-    Page *page = &this->pages_[item.second];
-    if (!page->IsDirty()) {
-      continue;
+  }
+  // Write the dirty pages in batches in page id order, so that neighbours are coalesced into a single write. Each page
+  // is pinned and copied like in WriteBackPage, and stays claimed until its batch is written.
+  std::sort(dirty_page_ids.begin(), dirty_page_ids.end());
+  std::vector<PageBuffer> buffers(std::min(dirty_page_ids.size(), WRITE_BACK_BATCH_PAGES));
+  std::vector<page_id_t> page_ids;
+  std::vector<const char *> page_data;
+  std::vector<Page *> claimed_pages;
+  size_t next = 0;
+  while (next < dirty_page_ids.size()) {
+    page_ids.clear();
+    page_data.clear();
+    claimed_pages.clear();
+    for (; next < dirty_page_ids.size() && page_ids.size() < buffers.size(); next++) {
+      Page *page = this->PinResidentPage(dirty_page_ids[next], false);
+      if (page == nullptr) {
+        // Evicted meanwhile, which wrote it back.
+        continue;
+      }
+      this->BeginWriteBack(page);
+      page->RLatch();
+      bool dirty = page->IsDirty();
+      if (dirty) {
+        page->is_dirty_ = false;
+        memcpy(buffers[page_ids.size()].data_, page->data_, PAGE_SIZE);
+      }
+      page->RUnlatch();
+      if (!dirty) {
+        this->EndWriteBack(page);
+        this->UnpinPgImp(dirty_page_ids[next], false);
+        continue;
+      }
+      page_data.push_back(buffers[page_ids.size()].data_);
+      page_ids.push_back(dirty_page_ids[next]);
+      claimed_pages.push_back(page);
+    }
+    this->disk_manager_->WritePages(page_ids.data(), page_data.data(), page_ids.size());
+    for (size_t i = 0; i < page_ids.size(); i++) {
+      this->EndWriteBack(claimed_pages[i]);
+      this->UnpinPgImp(page_ids[i], false);
     }
-    this->disk_manager_->WritePage(item.first, this->pages_[item.second].data_);
+    this->counters_.Add(BufferPoolCounters::FLUSHES, page_ids.size());
   }
 }
 
-auto BufferPoolManagerInstance::ReplacePage(frame_id_t *frame_id) {
+auto BufferPoolManagerInstance::WriteBackPage(page_id_t page_id, Page *page) -> bool {
+  if (!page->IsDirty()) {
+    return false;
+  }
+  PageBuffer buffer;
+  this->BeginWriteBack(page);
+  page->RLatch();
+  bool dirty = page->IsDirty();
+  page->is_dirty_ = false;
+  memcpy(buffer.data_, page->data_, PAGE_SIZE);
+  page->RUnlatch();
+  if (dirty) {
+    this->disk_manager_->WritePage(page_id, buffer.data_);
+  }
+  this->EndWriteBack(page);
+  return dirty;
+}
+
+void BufferPoolManagerInstance::BeginWriteBack(Page *page) {
+  // Write-backs are short and a page rarely has two at once, so spinning beats a condition variable per frame.
+  while (page->writing_back_.exchange(true, std::memory_order_acquire)) {
+    std::this_thread::yield();
+  }
+}
+
+void BufferPoolManagerInstance::EndWriteBack(Page *page) {
+  page->writing_back_.store(false, std::memory_order_release);
+}
+
+auto BufferPoolManagerInstance::ReplacePage(frame_id_t *frame_id) -> bool {
   if (!this->free_list_.empty()) {
     *frame_id = this->free_list_.front();
     this->free_list_.pop_front();
     return true;
   }
 
-  if (this->replacer_->Victim(frame_id)) {
-    // bool flag = false;
-    // for (auto item : this->page_table_) {
-    //   if (item.second == *frame_id) {
-    //     flag = true;
-    //     break;
-    //   }
-    // }
-    // if (!flag) {
-    //   LOG_ERROR("frame id %d not in page table", *frame_id);
-    //   return false;
-    // }
+  while (this->replacer_->Victim(frame_id)) {
     Page *victim = &this->pages_[*frame_id];
+    if (static_cast<size_t>(*frame_id) >= this->pool_size_ || victim->page_id_ == INVALID_PAGE_ID) {
+      // A stale entry for a frame that Resize dropped or that is on the free list.
+      continue;
+    }
+    auto &shard = this->ShardOf(victim->page_id_);
+    std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+    if (victim->pin_count_ > 0) {
+      // A hit pinned the frame after the replacer picked it. It is back in the replacer once it is unpinned.
+      continue;
+    }
+    shard.map_.erase(victim->page_id_);
+    shard_guard.unlock();
+    // The frame is unreachable from the page table now, so nobody else can pin or dirty it.
+    this->counters_.Add(BufferPoolCounters::EVICTIONS);
     if (victim->IsDirty()) {
+      this->counters_.Add(BufferPoolCounters::DIRTY_EVICTIONS);
       this->disk_manager_->WritePage(victim->page_id_, victim->data_);
+      // The cleaner is falling behind, wake it up early.
+      this->cleaner_cv_.notify_one();
     }
-    this->page_table_.erase(victim->page_id_);
     // LOG_INFO("evit frame %d", *frame_id);
     return true;
   }
@@ -109,43 +221,99 @@ auto BufferPoolManagerInstance::ReplacePage(frame_id_t *frame_id) {
 }
 
 auto BufferPoolManagerInstance::NewPgImp(page_id_t *page_id) -> Page * {
+  return this->NewTablespacePgImp(page_id, DEFAULT_TABLESPACE_ID);
+}
+
+auto BufferPoolManagerInstance::NewTablespacePgImp(page_id_t *page_id, tablespace_id_t tablespace_id) -> Page * {
   // 0.   Make sure you call AllocatePage!
   // 1.   If all the pages in the buffer pool are pinned, return nullptr.
   // 2.   Pick a victim page P from either the free list or the replacer. Always pick from the free list first.
   // 3.   Update P's metadata, zero out memory and add P to the page table.
   // 4.   Set the page ID output parameter. Return a pointer to P.
-  std::lock_guard<std::mutex> guard(this->latch_);
-  // bool flag = false;
-  // for (size_t i = 0; i < this->pool_size_; i++) {
-  //   if (this->pages_[i].pin_count_ == 0) {
-  //     flag = true;
-  //     break;
-  //   }
-  // }
-  // if (!flag) {
-  //   // LOG_DEBUG("instance %d all pages are pined", this->instance_index_);
-  //   return nullptr;
-  // }
-
+  if (this->disk_manager_->IsReadOnly()) {
+    return nullptr;
+  }
+  if (!this->disk_manager_->HasTablespace(tablespace_id)) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "no tablespace " + std::to_string(tablespace_id));
+  }
+  auto guard = this->AcquireLatch();
   frame_id_t frame_id;
   if (!this->ReplacePage(&frame_id)) {
     // LOG_DEBUG("instance %d fail to find free page", this->instance_index_);
     return nullptr;
   }
   // LOG_DEBUG("instance index %d frame_id %d", this->instance_index_, frame_id);
-  *page_id = this->AllocatePage();
+  // A reused id can still be resident, e.g. if it was fetched after its delete. A pinned one is skipped for now.
+  std::vector<page_id_t> skipped_page_ids;
+  *page_id = this->AllocatePage(tablespace_id);
+  while (*page_id != INVALID_PAGE_ID && !this->DropStalePage(*page_id)) {
+    skipped_page_ids.push_back(*page_id);
+    *page_id = this->AllocatePage(tablespace_id);
+  }
+  for (auto skipped_page_id : skipped_page_ids) {
+    this->DeallocatePage(skipped_page_id);
+  }
   Page *victim = &this->pages_[frame_id];
+  if (*page_id == INVALID_PAGE_ID) {
+    // The victim is already evicted; the frame goes to the free list.
+    victim->page_id_ = INVALID_PAGE_ID;
+    victim->is_dirty_ = false;
+    this->free_list_.push_front(frame_id);
+    return nullptr;
+  }
   victim->ResetMemory();
   victim->page_id_ = *page_id;
-  victim->is_dirty_ = false;
+  // Allocation is lazy: nothing is written now, the page reaches disk when it is first evicted or flushed. A reused
+  // page still holds its old contents on disk, but being dirty, the zeroed frame is written over them before any read.
+  victim->is_dirty_ = true;
   victim->pin_count_ = 1;
+  victim->access_count_ = 1;
   this->replacer_->Pin(frame_id);
-  this->page_table_[*page_id] = frame_id;
-  this->disk_manager_->WritePage(*page_id, victim->GetData());
-
+  {
+    auto &shard = this->ShardOf(*page_id);
+    std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+    shard.map_[*page_id] = frame_id;
+  }
   return victim;
 }
 
+auto BufferPoolManagerInstance::PinResidentPage(page_id_t page_id, bool touch) -> Page * {
+  auto &shard = this->ShardOf(page_id);
+  {
+    std::shared_lock<std::shared_mutex> shard_guard(shard.latch_);
+    auto iter = shard.map_.find(page_id);
+    if (iter == shard.map_.end()) {
+      return nullptr;
+    }
+    // Pinning a pinned page leaves the replacer alone, so it only takes a CAS under the shared latch.
+    Page *page = &this->pages_[iter->second];
+    int pin_count = page->pin_count_.load();
+    while (pin_count > 0) {
+      if (page->pin_count_.compare_exchange_weak(pin_count, pin_count + 1)) {
+        if (touch) {
+          page->access_count_.fetch_add(1, std::memory_order_relaxed);
+        }
+        return page;
+      }
+    }
+  }
+  // The 0 -> 1 transition and the replacer update happen under the exclusive latch, like 1 -> 0 in UnpinPgImp, so
+  // that the two cannot interleave and leave an unpinned frame outside the replacer.
+  std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+  auto iter = shard.map_.find(page_id);
+  if (iter == shard.map_.end()) {
+    return nullptr;
+  }
+  Page *page = &this->pages_[iter->second];
+  if (touch) {
+    page->access_count_.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (page->pin_count_.fetch_add(1) == 0 && touch) {
+    this->replacer_->Pin(iter->second);
+  }
+  return page;
+}
+
 auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   // 1.     Search the page table for the requested page (P).
   // 1.1    If P exists, pin it and return it immediately.
@@ -157,28 +325,133 @@ auto BufferPoolManagerInstance::FetchPgImp(page_id_t page_id) -> Page * {
   if (page_id == INVALID_PAGE_ID) {
     return nullptr;
   }
-  std::lock_guard<std::mutex> guard(this->latch_);
-  auto iter = this->page_table_.find(page_id);
-  if (iter != this->page_table_.end()) {
+  Page *page = this->PinResidentPage(page_id);
+  if (page != nullptr) {
     // LOG_INFO("instance %d fetch page id %d", this->instance_index_, page_id);
-    this->replacer_->Pin(iter->second);
-    this->pages_[iter->second].pin_count_++;
-    return &this->pages_[page_table_[page_id]];
+    this->counters_.Add(BufferPoolCounters::HITS);
+    return page;
+  }
+
+  auto guard = this->AcquireLatch();
+  // Another miss may have brought the page in while we were waiting for the latch.
+  page = this->PinResidentPage(page_id);
+  if (page != nullptr) {
+    this->counters_.Add(BufferPoolCounters::HITS);
+    this->counters_.Add(BufferPoolCounters::PIN_WAITS);
+    return page;
   }
+  this->counters_.Add(BufferPoolCounters::MISSES);
   frame_id_t frame_id;
   if (!this->ReplacePage(&frame_id)) {
     // LOG_DEBUG("instance %d fail to find free page", this->instance_index_);
     return nullptr;
   }
   // LOG_INFO("instance %d fetch page id %d from freelist or lrc", this->instance_index_, page_id);
-  Page *victim = &this->pages_[frame_id];
-  this->page_table_[page_id] = frame_id;
-  this->disk_manager_->ReadPage(page_id, victim->data_);
-  victim->is_dirty_ = false;
-  victim->pin_count_ = 1;
-  victim->page_id_ = page_id;
+  // The frame is private until it is published in the page table, so the read happens before that.
+  page = &this->pages_[frame_id];
+  this->ReadFrame(frame_id, page_id);
+  page->is_dirty_ = false;
+  page->pin_count_ = 1;
+  page->access_count_ = 1;
+  page->page_id_ = page_id;
   this->replacer_->Pin(frame_id);
-  return victim;
+  {
+    auto &shard = this->ShardOf(page_id);
+    std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+    shard.map_[page_id] = frame_id;
+  }
+  return page;
+}
+
+auto BufferPoolManagerInstance::FetchPages(const page_id_t *page_ids, size_t num_pages, Page **pages) -> size_t {
+  size_t fetched = 0;
+  std::vector<size_t> misses;
+  for (size_t i = 0; i < num_pages; i++) {
+    pages[i] = page_ids[i] == INVALID_PAGE_ID ? nullptr : this->PinResidentPage(page_ids[i]);
+    if (pages[i] != nullptr) {
+      this->counters_.Add(BufferPoolCounters::HITS);
+      fetched++;
+    } else if (page_ids[i] != INVALID_PAGE_ID) {
+      misses.push_back(i);
+    }
+  }
+  if (misses.empty()) {
+    return fetched;
+  }
+
+  auto guard = this->AcquireLatch();
+  // Frames are claimed for every distinct missing page first, so that all of them can be read together.
+  std::vector<size_t> reads;
+  std::vector<size_t> repeats;
+  std::vector<frame_id_t> frame_ids;
+  std::unordered_set<page_id_t> reading;
+  for (auto i : misses) {
+    pages[i] = this->PinResidentPage(page_ids[i]);
+    if (pages[i] != nullptr) {
+      this->counters_.Add(BufferPoolCounters::HITS);
+      this->counters_.Add(BufferPoolCounters::PIN_WAITS);
+      fetched++;
+      continue;
+    }
+    if (reading.count(page_ids[i]) != 0) {
+      repeats.push_back(i);
+      continue;
+    }
+    this->counters_.Add(BufferPoolCounters::MISSES);
+    frame_id_t frame_id;
+    if (!this->ReplacePage(&frame_id)) {
+      continue;
+    }
+    reads.push_back(i);
+    frame_ids.push_back(frame_id);
+    reading.insert(page_ids[i]);
+  }
+  if (reads.empty()) {
+    return fetched;
+  }
+
+  std::vector<page_id_t> read_page_ids;
+  std::vector<char *> read_data;
+  try {
+    for (size_t r = 0; r < reads.size(); r++) {
+      if (this->MapFrame(frame_ids[r], page_ids[reads[r]])) {
+        this->disk_manager_->VerifyChecksum(page_ids[reads[r]], this->pages_[frame_ids[r]].data_);
+      } else {
+        read_page_ids.push_back(page_ids[reads[r]]);
+        read_data.push_back(this->pages_[frame_ids[r]].data_);
+      }
+    }
+    if (!read_page_ids.empty()) {
+      this->disk_manager_->ReadPages(read_page_ids.data(), read_data.data(), read_page_ids.size());
+    }
+  } catch (Exception &) {
+    for (auto frame_id : frame_ids) {
+      this->ReleaseFrame(frame_id);
+    }
+    throw;
+  }
+  for (size_t r = 0; r < reads.size(); r++) {
+    Page *page = &this->pages_[frame_ids[r]];
+    page_id_t page_id = page_ids[reads[r]];
+    page->is_dirty_ = false;
+    page->pin_count_ = 1;
+    page->access_count_ = 1;
+    page->page_id_ = page_id;
+    this->replacer_->Pin(frame_ids[r]);
+    {
+      auto &shard = this->ShardOf(page_id);
+      std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+      shard.map_[page_id] = frame_ids[r];
+    }
+    pages[reads[r]] = page;
+    fetched++;
+  }
+  for (auto i : repeats) {
+    pages[i] = this->PinResidentPage(page_ids[i]);
+    this->counters_.Add(BufferPoolCounters::HITS);
+    fetched++;
+  }
+  return fetched;
 }
 
 auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
@@ -187,22 +460,31 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
   // 1.   If P does not exist, return true.
   // 2.   If P exists, but has a non-zero pin-count, return false. Someone is using the page.
   // 3.   Otherwise, P can be deleted. Remove P from the page table, reset its metadata and return it to the free list.
-  std::lock_guard<std::mutex> guard(this->latch_);
-  if (this->page_table_.count(page_id) == 0) {
+  if (this->disk_manager_->IsReadOnly()) {
+    return false;
+  }
+  auto guard = this->AcquireLatch();
+  auto &shard = this->ShardOf(page_id);
+  std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+  auto iter = shard.map_.find(page_id);
+  if (iter == shard.map_.end()) {
     // LOG_INFO("instance %d page id %d does not exist", this->instance_index_, page_id);
+    shard_guard.unlock();
+    DeallocatePage(page_id);
     return true;
   }
-  frame_id_t frame_id = page_table_[page_id];
+  frame_id_t frame_id = iter->second;
   Page *page = &this->pages_[frame_id];
   if (page->pin_count_ != 0) {
     // LOG_INFO("instance %d page id %d is being pinned", this->instance_index_, page_id);
     return false;
   }
-  if (page->IsDirty()) {
-    this->FlushPgImp(page_id);
-  }
+  // The page is going away, so there is no point in writing it back even if it is dirty.
   // LOG_INFO("instance %d delete page id %d", this->instance_index_, page_id);
-  this->page_table_.erase(page_id);
+  shard.map_.erase(iter);
+  shard_guard.unlock();
+  // The frame goes to the free list, so it must not be handed out by the replacer as well.
+  this->replacer_->Pin(frame_id);
   page->ResetMemory();
   page->pin_count_ = 0;
   page->page_id_ = INVALID_PAGE_ID;
@@ -213,23 +495,38 @@ auto BufferPoolManagerInstance::DeletePgImp(page_id_t page_id) -> bool {
 }
 
 auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) -> bool {
-  std::lock_guard<std::mutex> guard(this->latch_);
-  if (this->page_table_.count(page_id) == 0) {
+  auto &shard = this->ShardOf(page_id);
+  std::shared_lock<std::shared_mutex> shard_guard(shard.latch_);
+  auto iter = shard.map_.find(page_id);
+  if (iter == shard.map_.end()) {
     LOG_ERROR("page id %d does not present in page table", page_id);
     return false;
   }
-  frame_id_t frame_id = this->page_table_[page_id];
+  frame_id_t frame_id = iter->second;
   Page *page = &this->pages_[frame_id];
+  // The dirty flag has to be visible before the pin count can drop to zero and make the frame evictable.
   if (is_dirty) {
     page->is_dirty_ = true;
   }
 
-  if (page->pin_count_ == 0) {
+  int pin_count = page->pin_count_.load();
+  while (pin_count > 1) {
+    if (page->pin_count_.compare_exchange_weak(pin_count, pin_count - 1)) {
+      return true;
+    }
+  }
+  if (pin_count <= 0) {
     // LOG_INFO("page id %d pin count already 0", page_id);
     return true;
   }
-  page->pin_count_--;
-  if (page->pin_count_ == 0) {
+  // Dropping the last pin puts the frame into the replacer, see PinResidentPage.
+  shard_guard.unlock();
+  std::unique_lock<std::shared_mutex> exclusive_guard(shard.latch_);
+  iter = shard.map_.find(page_id);
+  if (iter == shard.map_.end() || iter->second != frame_id || page->pin_count_ <= 0) {
+    return true;
+  }
+  if (page->pin_count_.fetch_sub(1) == 1) {
     this->replacer_->Unpin(frame_id);
     // LOG_INFO("instance %d unpin frame %d now lru size %ld / %ld", this->instance_index_, frame_id,
     //          this->replacer_->Size(), this->pool_size_);
@@ -237,13 +534,428 @@ auto BufferPoolManagerInstance::UnpinPgImp(page_id_t page_id, bool is_dirty) ->
   return true;
 }
 
-auto BufferPoolManagerInstance::AllocatePage() -> page_id_t {
-  const page_id_t next_page_id = next_page_id_;
-  next_page_id_ += num_instances_;
+auto BufferPoolManagerInstance::Resize(size_t new_size) -> bool {
+  auto guard = this->AcquireLatch();
+  size_t old_size = this->pool_size_;
+  if (new_size == 0 || new_size > this->frame_arena_.GetCapacity()) {
+    return false;
+  }
+  if (new_size >= old_size) {
+    this->frame_arena_.Grow(new_size);
+    for (size_t i = old_size; i < new_size; ++i) {
+      this->free_list_.emplace_back(static_cast<frame_id_t>(i));
+    }
+    this->pool_size_ = new_size;
+    return true;
+  }
+
+  // Every shard is latched exclusively while the frames are checked, so that no hit can pin one of them before its
+  // page is out of the page table. Either all of them leave, or none does.
+  std::vector<std::unique_lock<std::shared_mutex>> shard_guards;
+  shard_guards.reserve(PAGE_TABLE_SHARDS);
+  for (auto &shard : this->page_table_) {
+    shard_guards.emplace_back(shard.latch_);
+  }
+  for (size_t i = new_size; i < old_size; ++i) {
+    Page *page = &this->pages_[i];
+    if (page->page_id_ != INVALID_PAGE_ID && page->pin_count_ > 0) {
+      return false;
+    }
+  }
+  for (size_t i = new_size; i < old_size; ++i) {
+    if (this->pages_[i].page_id_ != INVALID_PAGE_ID) {
+      this->ShardOf(this->pages_[i].page_id_).map_.erase(this->pages_[i].page_id_);
+    }
+  }
+  shard_guards.clear();
+  for (size_t i = new_size; i < old_size; ++i) {
+    this->EvictFrame(static_cast<frame_id_t>(i));
+  }
+  this->free_list_.remove_if([new_size](frame_id_t frame_id) { return static_cast<size_t>(frame_id) >= new_size; });
+  this->pool_size_ = new_size;
+  this->frame_arena_.Release(new_size, old_size);
+  return true;
+}
+
+void BufferPoolManagerInstance::EvictFrame(frame_id_t frame_id) {
+  Page *page = &this->pages_[frame_id];
+  if (page->page_id_ == INVALID_PAGE_ID) {
+    // Already on the free list.
+    return;
+  }
+  this->counters_.Add(BufferPoolCounters::EVICTIONS);
+  if (page->IsDirty()) {
+    this->counters_.Add(BufferPoolCounters::DIRTY_EVICTIONS);
+    this->disk_manager_->WritePage(page->page_id_, page->data_);
+  }
+  this->replacer_->Pin(frame_id);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  this->free_list_.push_back(frame_id);
+}
+
+void BufferPoolManagerInstance::StartPageCleaner(size_t clean_target, std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> guard(this->cleaner_latch_);
+  if (this->cleaner_running_) {
+    return;
+  }
+  this->clean_target_ = clean_target;
+  this->cleaner_interval_ = interval;
+  this->cleaner_running_ = true;
+  this->cleaner_thread_ = std::thread(&BufferPoolManagerInstance::RunPageCleaner, this);
+}
+
+void BufferPoolManagerInstance::StopPageCleaner() {
+  {
+    std::lock_guard<std::mutex> guard(this->cleaner_latch_);
+    this->cleaner_running_ = false;
+  }
+  this->cleaner_cv_.notify_one();
+  if (this->cleaner_thread_.joinable()) {
+    this->cleaner_thread_.join();
+  }
+}
+
+void BufferPoolManagerInstance::RunPageCleaner() {
+  std::unique_lock<std::mutex> lock(this->cleaner_latch_);
+  while (this->cleaner_running_) {
+    this->cleaner_cv_.wait_for(lock, this->cleaner_interval_);
+    if (!this->cleaner_running_) {
+      break;
+    }
+    lock.unlock();
+    this->CleanColdFrames();
+    lock.lock();
+  }
+}
+
+auto BufferPoolManagerInstance::CleanColdFrames() -> size_t {
+  std::vector<frame_id_t> frame_ids;
+  this->replacer_->PeekVictims(this->clean_target_, &frame_ids);
+  if (frame_ids.empty()) {
+    return 0;
+  }
+  // Only read which pages live in the cold frames under the latch; the writes happen without it.
+  std::vector<page_id_t> dirty_page_ids;
+  {
+    auto guard = this->AcquireLatch();
+    for (auto frame_id : frame_ids) {
+      Page *page = &this->pages_[frame_id];
+      if (page->page_id_ != INVALID_PAGE_ID && page->pin_count_ == 0 && page->IsDirty()) {
+        dirty_page_ids.push_back(page->page_id_);
+      }
+    }
+  }
+
+  size_t cleaned = 0;
+  for (auto page_id : dirty_page_ids) {
+    Page *page = this->PinResidentPage(page_id, false);
+    if (page == nullptr) {
+      continue;
+    }
+    // Somebody may be using it again, or it may have been written back already. Keep the pin until the write is done,
+    // otherwise the frame could be evicted as clean and re-read stale.
+    if (page->pin_count_ == 1 && this->WriteBackPage(page_id, page)) {
+      cleaned++;
+    }
+    this->UnpinPgImp(page_id, false);
+  }
+  this->cleaned_pages_ += cleaned;
+  this->counters_.Add(BufferPoolCounters::FLUSHES, cleaned);
+  return cleaned;
+}
+
+auto BufferPoolManagerInstance::AcquireLatch() -> std::unique_lock<std::mutex> {
+  std::unique_lock<std::mutex> lock(this->latch_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    auto start = std::chrono::steady_clock::now();
+    lock.lock();
+    auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+    this->counters_.Add(BufferPoolCounters::LATCH_WAITS);
+    this->counters_.Add(BufferPoolCounters::LATCH_WAIT_NS, waited.count());
+  }
+  return lock;
+}
+
+auto BufferPoolManagerInstance::GetStats() -> BufferPoolStats {
+  BufferPoolStats stats;
+  this->counters_.Fill(&stats);
+  // Which page lives in a frame only changes under the latch.
+  auto guard = this->AcquireLatch();
+  for (size_t i = 0; i < this->pool_size_; ++i) {
+    if (this->pages_[i].page_id_ != INVALID_PAGE_ID) {
+      stats.access_histogram_[BufferPoolStats::HistogramBucket(this->pages_[i].access_count_)]++;
+    }
+  }
+  return stats;
+}
+
+void BufferPoolManagerInstance::Prefetch(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID || static_cast<uint32_t>(page_id) % this->num_instances_ != this->instance_index_ ||
+      this->IsResident(page_id)) {
+    return;
+  }
+  // Reading a page that was never allocated or written would make one up, and a deleted one would bring it back.
+  if (!this->MayExist(page_id) || this->disk_manager_->IsFreePage(page_id)) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> guard(this->prefetch_latch_);
+    // pool_size_ is atomic, a concurrent Resize only changes how many pages may queue up.
+    if (this->prefetch_queue_.size() >= this->pool_size_.load()) {
+      return;
+    }
+    if (!this->prefetch_running_) {
+      this->prefetch_running_ = true;
+      this->prefetch_thread_ = std::thread(&BufferPoolManagerInstance::RunPrefetcher, this);
+    }
+    this->prefetch_queue_.push_back(page_id);
+  }
+  this->prefetch_cv_.notify_one();
+}
+
+void BufferPoolManagerInstance::StopPrefetcher() {
+  {
+    std::lock_guard<std::mutex> guard(this->prefetch_latch_);
+    this->prefetch_running_ = false;
+    this->prefetch_queue_.clear();
+  }
+  this->prefetch_cv_.notify_one();
+  if (this->prefetch_thread_.joinable()) {
+    this->prefetch_thread_.join();
+  }
+}
+
+void BufferPoolManagerInstance::RunPrefetcher() {
+  std::unique_lock<std::mutex> lock(this->prefetch_latch_);
+  while (true) {
+    this->prefetch_cv_.wait(lock, [this] { return !this->prefetch_running_ || !this->prefetch_queue_.empty(); });
+    if (!this->prefetch_running_) {
+      break;
+    }
+    page_id_t page_id = this->prefetch_queue_.front();
+    this->prefetch_queue_.pop_front();
+    lock.unlock();
+    if (this->LoadPage(page_id)) {
+      this->prefetched_pages_++;
+    }
+    lock.lock();
+  }
+}
+
+auto BufferPoolManagerInstance::IsResident(page_id_t page_id) -> bool {
+  auto &shard = this->ShardOf(page_id);
+  std::shared_lock<std::shared_mutex> shard_guard(shard.latch_);
+  return shard.map_.count(page_id) != 0;
+}
+
+auto BufferPoolManagerInstance::LoadPage(page_id_t page_id, bool free_frame_only) -> bool {
+  if (this->IsResident(page_id)) {
+    return false;
+  }
+  auto guard = this->AcquireLatch();
+  frame_id_t frame_id;
+  // A free page may be handed out by NewPage any time, and must not be resident then.
+  if (this->IsResident(page_id) || this->disk_manager_->IsFreePage(page_id) ||
+      (free_frame_only && this->free_list_.empty()) || !this->ReplacePage(&frame_id)) {
+    return false;
+  }
+  Page *page = &this->pages_[frame_id];
+  try {
+    this->ReadFrame(frame_id, page_id);
+  } catch (Exception &) {
+    // Nobody asked for the page yet; the reader that does gets the exception.
+    return false;
+  }
+  page->is_dirty_ = false;
+  page->pin_count_ = 0;
+  page->access_count_ = 0;
+  page->page_id_ = page_id;
+  // Nobody can reach the frame before it is published, so it can enter the replacer first.
+  this->replacer_->Unpin(frame_id);
+  {
+    auto &shard = this->ShardOf(page_id);
+    std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+    shard.map_[page_id] = frame_id;
+  }
+  return true;
+}
+
+auto BufferPoolManagerInstance::MapFrame(frame_id_t frame_id, page_id_t page_id) -> bool {
+  Page *page = &this->pages_[frame_id];
+  char *mapped = this->disk_manager_->GetMappedPage(page_id);
+  if (mapped != nullptr) {
+    page->data_ = mapped;
+    return true;
+  }
+  page->data_ = this->frame_arena_.GetData() + static_cast<size_t>(frame_id) * PAGE_SIZE;
+  return false;
+}
+
+void BufferPoolManagerInstance::ReadFrame(frame_id_t frame_id, page_id_t page_id) {
+  Page *page = &this->pages_[frame_id];
+  try {
+    if (this->MapFrame(frame_id, page_id)) {
+      this->disk_manager_->VerifyChecksum(page_id, page->data_);
+    } else {
+      this->disk_manager_->ReadPage(page_id, page->data_);
+    }
+  } catch (Exception &) {
+    this->ReleaseFrame(frame_id);
+    throw;
+  }
+}
+
+auto BufferPoolManagerInstance::DropStalePage(page_id_t page_id) -> bool {
+  auto &shard = this->ShardOf(page_id);
+  std::unique_lock<std::shared_mutex> shard_guard(shard.latch_);
+  auto iter = shard.map_.find(page_id);
+  if (iter == shard.map_.end()) {
+    return true;
+  }
+  frame_id_t frame_id = iter->second;
+  Page *page = &this->pages_[frame_id];
+  if (page->pin_count_ > 0) {
+    return false;
+  }
+  LOG_WARN("page %d was still resident when it was allocated again", page_id);
+  // Like DeletePage, the contents of a page that was deleted are not written back.
+  shard.map_.erase(iter);
+  shard_guard.unlock();
+  this->replacer_->Pin(frame_id);
+  page->ResetMemory();
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  this->free_list_.push_back(frame_id);
+  return true;
+}
+
+void BufferPoolManagerInstance::ReleaseFrame(frame_id_t frame_id) {
+  Page *page = &this->pages_[frame_id];
+  this->MapFrame(frame_id, INVALID_PAGE_ID);
+  page->page_id_ = INVALID_PAGE_ID;
+  page->is_dirty_ = false;
+  page->pin_count_ = 0;
+  this->free_list_.push_back(frame_id);
+}
+
+void BufferPoolManagerInstance::GetResidentPages(std::vector<page_id_t> *page_ids) {
+  auto guard = this->AcquireLatch();
+  std::vector<frame_id_t> frame_ids;
+  this->replacer_->PeekVictims(this->pool_size_, &frame_ids);
+  std::vector<bool> listed(this->pool_size_, false);
+  for (size_t i = 0; i < this->pool_size_; ++i) {
+    if (this->pages_[i].page_id_ != INVALID_PAGE_ID && this->pages_[i].pin_count_ > 0) {
+      page_ids->push_back(this->pages_[i].page_id_);
+      listed[i] = true;
+    }
+  }
+  for (auto iter = frame_ids.rbegin(); iter != frame_ids.rend(); ++iter) {
+    auto frame_id = static_cast<size_t>(*iter);
+    if (frame_id < this->pool_size_ && !listed[frame_id] && this->pages_[frame_id].page_id_ != INVALID_PAGE_ID) {
+      page_ids->push_back(this->pages_[frame_id].page_id_);
+      listed[frame_id] = true;
+    }
+  }
+}
+
+void BufferPoolManagerInstance::WarmUp(const std::vector<page_id_t> &page_ids) {
+  // Read once, Resize may change it meanwhile; warm-up never evicts, so a pool that shrank just loads fewer pages.
+  const size_t pool_size = this->pool_size_.load();
+  std::vector<page_id_t> own_page_ids;
+  std::unordered_set<page_id_t> seen;
+  for (auto page_id : page_ids) {
+    if (own_page_ids.size() == pool_size) {
+      break;
+    }
+    // A snapshot older than the last deletes may list pages that are free now.
+    if (page_id != INVALID_PAGE_ID && static_cast<uint32_t>(page_id) % this->num_instances_ == this->instance_index_ &&
+        !this->disk_manager_->IsFreePage(page_id) && seen.insert(page_id).second) {
+      own_page_ids.push_back(page_id);
+    }
+  }
+  StopWarmUp();
+  this->warmup_running_ = true;
+  this->warmup_thread_ = std::thread(&BufferPoolManagerInstance::RunWarmUp, this, std::move(own_page_ids));
+}
+
+void BufferPoolManagerInstance::RunWarmUp(std::vector<page_id_t> page_ids) {
+  std::vector<page_id_t> sorted_page_ids = page_ids;
+  std::sort(sorted_page_ids.begin(), sorted_page_ids.end());
+  for (auto page_id : sorted_page_ids) {
+    if (!this->warmup_running_) {
+      return;
+    }
+    if (this->LoadPage(page_id, true)) {
+      this->warmed_pages_++;
+    } else if (!this->IsResident(page_id) && !this->disk_manager_->IsFreePage(page_id)) {
+      // Out of free frames: the pool is warm, or live traffic filled it first.
+      break;
+    }
+  }
+  // Touch the pages from coldest to hottest so that the replacer ends up in snapshot order.
+  for (auto iter = page_ids.rbegin(); iter != page_ids.rend() && this->warmup_running_; ++iter) {
+    if (this->PinResidentPage(*iter) != nullptr) {
+      this->UnpinPgImp(*iter, false);
+    }
+  }
+}
+
+void BufferPoolManagerInstance::WaitForWarmUp() {
+  if (this->warmup_thread_.joinable()) {
+    this->warmup_thread_.join();
+  }
+}
+
+void BufferPoolManagerInstance::StopWarmUp() {
+  this->warmup_running_ = false;
+  WaitForWarmUp();
+}
+
+auto BufferPoolManagerInstance::AllocatePage(tablespace_id_t tablespace_id) -> page_id_t {
+  auto &counter = next_page_ids_[tablespace_id];
+  page_id_t page_id = disk_manager_->AllocateFreePage(num_instances_, instance_index_, tablespace_id);
+  if (page_id != INVALID_PAGE_ID) {
+    ValidatePageId(page_id);
+    // The map may hold pages freed before a restart, which the counter has not reached yet.
+    page_id_t next_page_id = counter;
+    while (next_page_id <= page_id &&
+           !counter.compare_exchange_weak(next_page_id, page_id + static_cast<page_id_t>(num_instances_))) {
+    }
+    return page_id;
+  }
+  // The counter stops one step past the end of the tablespace, so a full tablespace never hands out ids of the next.
+  page_id_t next_page_id = counter;
+  do {
+    if (TablespaceOf(next_page_id) != tablespace_id) {
+      LOG_WARN("tablespace %d has run out of page ids", tablespace_id);
+      return INVALID_PAGE_ID;
+    }
+  } while (!counter.compare_exchange_weak(
+      next_page_id, static_cast<page_id_t>(static_cast<uint32_t>(next_page_id) + num_instances_)));
   ValidatePageId(next_page_id);
   return next_page_id;
 }
 
+void BufferPoolManagerInstance::DeallocatePage(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID || static_cast<uint32_t>(page_id) % num_instances_ != instance_index_) {
+    return;
+  }
+  // A page that was never allocated or written must not end up in the map.
+  if (!MayExist(page_id)) {
+    return;
+  }
+  disk_manager_->DeallocatePage(page_id);
+}
+
+auto BufferPoolManagerInstance::MayExist(page_id_t page_id) -> bool {
+  tablespace_id_t tablespace_id = TablespaceOf(page_id);
+  if (tablespace_id < 0 || tablespace_id >= MAX_TABLESPACES || !disk_manager_->HasTablespace(tablespace_id)) {
+    return false;
+  }
+  return page_id < next_page_ids_[tablespace_id] || disk_manager_->HasPage(page_id);
+}
+
 void BufferPoolManagerInstance::ValidatePageId(const page_id_t page_id) const {
   assert(page_id % num_instances_ == instance_index_);  // allocated pages mod back to this BPI
 }
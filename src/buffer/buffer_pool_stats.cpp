@@ -0,0 +1,109 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.cpp
+//
+// Identification: src/buffer/buffer_pool_stats.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/buffer_pool_stats.h"
+
+#include <sstream>
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+auto BufferPoolStats::HitRatio() const -> double {
+  uint64_t fetches = hits_ + misses_;
+  return fetches == 0 ? 0.0 : static_cast<double>(hits_) / static_cast<double>(fetches);
+}
+
+auto BufferPoolStats::HistogramBucket(uint32_t access_count) -> size_t {
+  size_t bucket = 0;
+  while (access_count != 0 && bucket < HISTOGRAM_BUCKETS - 1) {
+    access_count >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+auto BufferPoolStats::operator+=(const BufferPoolStats &other) -> BufferPoolStats & {
+  hits_ += other.hits_;
+  misses_ += other.misses_;
+  evictions_ += other.evictions_;
+  dirty_evictions_ += other.dirty_evictions_;
+  flushes_ += other.flushes_;
+  pin_waits_ += other.pin_waits_;
+  latch_waits_ += other.latch_waits_;
+  latch_wait_ns_ += other.latch_wait_ns_;
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    access_histogram_[i] += other.access_histogram_[i];
+  }
+  return *this;
+}
+
+auto BufferPoolStats::ToString() const -> std::string {
+  std::ostringstream os;
+  os << "hits=" << hits_ << " misses=" << misses_ << " hit_ratio=" << HitRatio() << " evictions=" << evictions_
+     << " dirty_evictions=" << dirty_evictions_ << " flushes=" << flushes_ << " pin_waits=" << pin_waits_
+     << " latch_waits=" << latch_waits_ << " latch_wait_ms=" << latch_wait_ns_ / 1000000 << " access_histogram=[";
+  for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+    os << (i == 0 ? "" : " ") << access_histogram_[i];
+  }
+  os << "]";
+  return os.str();
+}
+
+auto BufferPoolCounters::Get(Counter counter) const -> uint64_t {
+  uint64_t sum = 0;
+  for (const auto &shard : shards_) {
+    sum += shard.counters_[counter].load(std::memory_order_relaxed);
+  }
+  return sum;
+}
+
+void BufferPoolCounters::Fill(BufferPoolStats *stats) const {
+  stats->hits_ = Get(HITS);
+  stats->misses_ = Get(MISSES);
+  stats->evictions_ = Get(EVICTIONS);
+  stats->dirty_evictions_ = Get(DIRTY_EVICTIONS);
+  stats->flushes_ = Get(FLUSHES);
+  stats->pin_waits_ = Get(PIN_WAITS);
+  stats->latch_waits_ = Get(LATCH_WAITS);
+  stats->latch_wait_ns_ = Get(LATCH_WAIT_NS);
+}
+
+auto BufferPoolCounters::ThreadShard() -> size_t {
+  static std::atomic<size_t> next_shard{0};
+  thread_local size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+  return shard;
+}
+
+BufferPoolStatsDumper::BufferPoolStatsDumper(BufferPoolManager *buffer_pool_manager, std::chrono::milliseconds interval)
+    : buffer_pool_manager_(buffer_pool_manager), interval_(interval) {
+  thread_ = std::thread(&BufferPoolStatsDumper::Run, this);
+}
+
+BufferPoolStatsDumper::~BufferPoolStatsDumper() {
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    running_ = false;
+  }
+  cv_.notify_one();
+  thread_.join();
+}
+
+void BufferPoolStatsDumper::Run() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (!cv_.wait_for(lock, interval_, [this] { return !running_; })) {
+    LOG_INFO("buffer pool stats: %s", buffer_pool_manager_->GetStats().ToString().c_str());
+  }
+}
+
+}  // namespace bustub
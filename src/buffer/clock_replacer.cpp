@@ -14,16 +14,53 @@
 
 namespace bustub {
 
-ClockReplacer::ClockReplacer(size_t num_pages) {}
+ClockReplacer::ClockReplacer(size_t num_pages) : num_pages_(num_pages), frames_(num_pages) {}
 
 ClockReplacer::~ClockReplacer() = default;
 
-auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool { return false; }
+auto ClockReplacer::Victim(frame_id_t *frame_id) -> bool {
+  // Every frame in the replacer is taken within two sweeps unless other threads keep pinning and unpinning, so this
+  // only spins while there is something left to take.
+  while (this->size_ > 0) {
+    size_t index = this->hand_.fetch_add(1) % this->num_pages_;
+    uint8_t state = this->frames_[index].load();
+    if (state == REFERENCED) {
+      this->frames_[index].compare_exchange_strong(state, UNREFERENCED);
+    } else if (state == UNREFERENCED && this->frames_[index].compare_exchange_strong(state, ABSENT)) {
+      this->size_--;
+      *frame_id = static_cast<frame_id_t>(index);
+      return true;
+    }
+  }
+  return false;
+}
 
-void ClockReplacer::Pin(frame_id_t frame_id) {}
+void ClockReplacer::Pin(frame_id_t frame_id) {
+  if (this->frames_[frame_id].exchange(ABSENT) != ABSENT) {
+    this->size_--;
+  }
+}
 
-void ClockReplacer::Unpin(frame_id_t frame_id) {}
+void ClockReplacer::Unpin(frame_id_t frame_id) {
+  uint8_t expected = ABSENT;
+  if (this->frames_[frame_id].compare_exchange_strong(expected, REFERENCED)) {
+    this->size_++;
+  }
+}
 
-auto ClockReplacer::Size() -> size_t { return 0; }
+auto ClockReplacer::Size() -> size_t { return this->size_; }
+
+void ClockReplacer::PeekVictims(size_t max_frames, std::vector<frame_id_t> *frame_ids) {
+  // Frames the hand already cleared go first, in the order the hand will reach them, then the referenced ones.
+  size_t start = this->hand_ % this->num_pages_;
+  for (uint8_t wanted : {UNREFERENCED, REFERENCED}) {
+    for (size_t i = 0; i < this->num_pages_ && frame_ids->size() < max_frames; ++i) {
+      size_t index = (start + i) % this->num_pages_;
+      if (this->frames_[index].load() == wanted) {
+        frame_ids->push_back(static_cast<frame_id_t>(index));
+      }
+    }
+  }
+}
 
 }  // namespace bustub
@@ -0,0 +1,121 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.cpp
+//
+// Identification: src/buffer/frame_arena.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/frame_arena.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <vector>
+
+#include "common/logger.h"
+#include "common/macros.h"
+
+namespace bustub {
+
+namespace {
+/** MPOL_BIND from linux/mempolicy.h, so that numactl headers are not needed. */
+constexpr int MPOL_BIND_MODE = 2;
+}  // namespace
+
+FrameArena::FrameArena(size_t num_frames, int numa_node, size_t capacity)
+    : capacity_(std::max(num_frames, capacity)),
+      mapping_size_((capacity_ * PAGE_SIZE + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE) {
+  if (this->mapping_size_ == 0) {
+    this->mapping_size_ = HUGE_PAGE_SIZE;
+  }
+  MapData();
+  if (numa_node >= 0) {
+    BindToNode(numa_node);
+  }
+
+  // Room for every Page object is reserved up front; they are constructed as frames come into use.
+  this->pages_ = static_cast<Page *>(::operator new[](this->capacity_ * sizeof(Page)));
+  Grow(num_frames);
+}
+
+FrameArena::~FrameArena() {
+  for (size_t i = 0; i < this->num_constructed_; ++i) {
+    this->pages_[i].~Page();
+  }
+  ::operator delete[](this->pages_);
+  munmap(this->data_, this->mapping_size_);
+}
+
+void FrameArena::Grow(size_t num_frames) {
+  BUSTUB_ASSERT(num_frames <= this->capacity_, "cannot grow a frame arena beyond its capacity");
+  // Each Page points at its slice of the mapping, which the kernel has already zeroed.
+  for (; this->num_constructed_ < num_frames; ++this->num_constructed_) {
+    new (&this->pages_[this->num_constructed_]) Page(this->data_ + this->num_constructed_ * PAGE_SIZE);
+  }
+}
+
+void FrameArena::Release(size_t first_frame, size_t last_frame) {
+  if (first_frame >= last_frame) {
+    return;
+  }
+  // Best effort: with explicit huge pages only whole huge pages can be dropped, and madvise fails otherwise.
+  madvise(this->data_ + first_frame * PAGE_SIZE, (last_frame - first_frame) * PAGE_SIZE, MADV_DONTNEED);
+}
+
+void FrameArena::MapData() {
+#ifdef MAP_HUGETLB
+  void *huge_addr =
+      mmap(nullptr, this->mapping_size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (huge_addr != MAP_FAILED) {
+    this->data_ = static_cast<char *>(huge_addr);
+    this->huge_tlb_ = true;
+    return;
+  }
+#endif
+
+  // No reserved huge pages: over-map by one huge page and trim both ends to get an aligned range.
+  size_t padded_size = this->mapping_size_ + HUGE_PAGE_SIZE;
+  void *addr = mmap(nullptr, padded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (addr == MAP_FAILED) {
+    throw std::bad_alloc();
+  }
+  auto start = reinterpret_cast<uintptr_t>(addr);
+  uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+  if (aligned > start) {
+    munmap(addr, aligned - start);
+  }
+  size_t tail = start + padded_size - (aligned + this->mapping_size_);
+  if (tail > 0) {
+    munmap(reinterpret_cast<void *>(aligned + this->mapping_size_), tail);
+  }
+  this->data_ = reinterpret_cast<char *>(aligned);
+#ifdef MADV_HUGEPAGE
+  madvise(this->data_, this->mapping_size_, MADV_HUGEPAGE);
+#endif
+}
+
+void FrameArena::BindToNode(int numa_node) {
+  const size_t bits_per_word = 8 * sizeof(unsigned long);                  // NOLINT
+  std::vector<unsigned long> node_mask(numa_node / bits_per_word + 1, 0);  // NOLINT
+  node_mask[numa_node / bits_per_word] = 1UL << (numa_node % bits_per_word);
+  long ret = syscall(SYS_mbind, this->data_, this->mapping_size_, MPOL_BIND_MODE, node_mask.data(),  // NOLINT
+                     node_mask.size() * bits_per_word + 1, 0);
+  if (ret != 0) {
+    LOG_WARN("mbind to NUMA node %d failed (%s), using first-touch placement", numa_node, strerror(errno));
+    return;
+  }
+  this->numa_bound_ = true;
+}
+
+}  // namespace bustub
@@ -0,0 +1,108 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.cpp
+//
+// Identification: src/buffer/lru_k_replacer.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/lru_k_replacer.h"
+
+#include "common/macros.h"
+
+namespace bustub {
+
+LRUKReplacer::LRUKReplacer(size_t num_pages, size_t k, uint64_t correlated_period)
+    : k_(k), correlated_period_(correlated_period) {
+  BUSTUB_ASSERT(k > 0, "LRU-K needs to remember at least one access");
+  this->frames_.reserve(num_pages);
+}
+
+LRUKReplacer::~LRUKReplacer() = default;
+
+auto LRUKReplacer::EvictionKey(const FrameHistory &history, frame_id_t frame_id) const
+    -> std::pair<uint64_t, frame_id_t> {
+  // With fewer than K accesses this is the first (or only) access; with K it is the K-th most recent one.
+  return {history.accesses_.front(), frame_id};
+}
+
+void LRUKReplacer::InsertEvictable(const FrameHistory &history, frame_id_t frame_id) {
+  if (history.accesses_.size() < this->k_) {
+    this->history_.insert(EvictionKey(history, frame_id));
+  } else {
+    this->cache_.insert(EvictionKey(history, frame_id));
+  }
+}
+
+void LRUKReplacer::EraseEvictable(const FrameHistory &history, frame_id_t frame_id) {
+  if (history.accesses_.size() < this->k_) {
+    this->history_.erase(EvictionKey(history, frame_id));
+  } else {
+    this->cache_.erase(EvictionKey(history, frame_id));
+  }
+}
+
+auto LRUKReplacer::Victim(frame_id_t *frame_id) -> bool {
+  std::lock_guard<std::mutex> guard(this->latch_);
+  auto &candidates = this->history_.empty() ? this->cache_ : this->history_;
+  if (candidates.empty()) {
+    return false;
+  }
+  *frame_id = candidates.begin()->second;
+  candidates.erase(candidates.begin());
+  // The frame will hold a different page, so its history does not carry over.
+  this->frames_.erase(*frame_id);
+  return true;
+}
+
+void LRUKReplacer::Pin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(this->latch_);
+  auto &history = this->frames_[frame_id];
+  if (history.evictable_) {
+    EraseEvictable(history, frame_id);
+    history.evictable_ = false;
+  }
+  uint64_t now = ++this->current_timestamp_;
+  if (!history.accesses_.empty() && now - history.accesses_.back() <= this->correlated_period_) {
+    history.accesses_.back() = now;
+    return;
+  }
+  history.accesses_.push_back(now);
+  if (history.accesses_.size() > this->k_) {
+    history.accesses_.pop_front();
+  }
+}
+
+void LRUKReplacer::Unpin(frame_id_t frame_id) {
+  std::lock_guard<std::mutex> guard(this->latch_);
+  auto &history = this->frames_[frame_id];
+  if (history.evictable_) {
+    return;
+  }
+  if (history.accesses_.empty()) {
+    // A frame loaded without being pinned (e.g. by read-ahead) counts as accessed once when it is loaded.
+    history.accesses_.push_back(++this->current_timestamp_);
+  }
+  history.evictable_ = true;
+  InsertEvictable(history, frame_id);
+}
+
+auto LRUKReplacer::Size() -> size_t {
+  std::lock_guard<std::mutex> guard(this->latch_);
+  return this->history_.size() + this->cache_.size();
+}
+
+void LRUKReplacer::PeekVictims(size_t max_frames, std::vector<frame_id_t> *frame_ids) {
+  std::lock_guard<std::mutex> guard(this->latch_);
+  for (const auto *candidates : {&this->history_, &this->cache_}) {
+    for (auto iter = candidates->begin(); iter != candidates->end() && frame_ids->size() < max_frames; ++iter) {
+      frame_ids->push_back(iter->second);
+    }
+  }
+}
+
+}  // namespace bustub
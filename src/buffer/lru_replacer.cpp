@@ -61,4 +61,11 @@ void LRUReplacer::Unpin(frame_id_t frame_id) {
 
 auto LRUReplacer::Size() -> size_t { return this->lru_list_.size(); }
 
+void LRUReplacer::PeekVictims(size_t max_frames, std::vector<frame_id_t> *frame_ids) {
+  std::lock_guard<std::mutex> guard(this->latch_);
+  for (auto iter = this->lru_list_.rbegin(); iter != this->lru_list_.rend() && frame_ids->size() < max_frames; ++iter) {
+    frame_ids->push_back(*iter);
+  }
+}
+
 }  // namespace bustub
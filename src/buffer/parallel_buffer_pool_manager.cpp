@@ -12,15 +12,20 @@
 
 #include "buffer/parallel_buffer_pool_manager.h"
 
+#include <algorithm>
+
 namespace bustub {
 
 ParallelBufferPoolManager::ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                                                     LogManager *log_manager)
-    : num_instances_(num_instances), pool_size_(pool_size), starting_index_(0) {
+                                                     LogManager *log_manager, ReplacerPolicy replacer_policy,
+                                                     const std::vector<int> &numa_nodes)
+    : num_instances_(num_instances), pool_size_(pool_size), disk_manager_(disk_manager), starting_index_(0) {
   // Allocate and create individual BufferPoolManagerInstances
-  this->instances_ = new BufferPoolManager *[num_instances];
+  this->instances_ = new BufferPoolManagerInstance *[num_instances];
   for (size_t i = 0; i < num_instances; i++) {
-    this->instances_[i] = new BufferPoolManagerInstance(pool_size, num_instances, i, disk_manager, log_manager);
+    int numa_node = numa_nodes.empty() ? -1 : numa_nodes[i % numa_nodes.size()];
+    this->instances_[i] = new BufferPoolManagerInstance(pool_size, num_instances, i, disk_manager, log_manager,
+                                                        replacer_policy, numa_node);
   }
 }
 
@@ -34,7 +39,111 @@ ParallelBufferPoolManager::~ParallelBufferPoolManager() {
 
 auto ParallelBufferPoolManager::GetPoolSize() -> size_t {
   // Get size of all BufferPoolManagerInstances
-  return pool_size_ * num_instances_;
+  size_t pool_size = 0;
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    pool_size += this->instances_[i]->GetPoolSize();
+  }
+  return pool_size;
+}
+
+auto ParallelBufferPoolManager::Resize(size_t pool_size) -> bool {
+  size_t old_size = this->instances_[0]->GetPoolSize();
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    if (!this->instances_[i]->Resize(pool_size)) {
+      // Undo the instances already resized. Growing back after a shrink can't fail, and a grow only fails on a size
+      // out of range, which the first instance rejects already.
+      for (size_t j = 0; j < i; j++) {
+        this->instances_[j]->Resize(old_size);
+      }
+      return false;
+    }
+  }
+  return true;
+}
+
+auto ParallelBufferPoolManager::FetchPages(const page_id_t *page_ids, size_t num_pages, Page **pages) -> size_t {
+  std::vector<std::vector<size_t>> groups(this->num_instances_);
+  for (size_t i = 0; i < num_pages; i++) {
+    pages[i] = nullptr;
+    if (page_ids[i] != INVALID_PAGE_ID) {
+      groups[static_cast<uint32_t>(page_ids[i]) % this->num_instances_].push_back(i);
+    }
+  }
+  size_t fetched = 0;
+  std::vector<page_id_t> group_page_ids;
+  std::vector<Page *> group_pages;
+  for (size_t instance = 0; instance < this->num_instances_; instance++) {
+    const auto &group = groups[instance];
+    if (group.empty()) {
+      continue;
+    }
+    group_page_ids.resize(group.size());
+    group_pages.resize(group.size());
+    for (size_t g = 0; g < group.size(); g++) {
+      group_page_ids[g] = page_ids[group[g]];
+    }
+    fetched += this->instances_[instance]->FetchPages(group_page_ids.data(), group.size(), group_pages.data());
+    for (size_t g = 0; g < group.size(); g++) {
+      pages[group[g]] = group_pages[g];
+    }
+  }
+  return fetched;
+}
+
+auto ParallelBufferPoolManager::GetStats() -> BufferPoolStats {
+  BufferPoolStats stats;
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    stats += this->instances_[i]->GetStats();
+  }
+  return stats;
+}
+
+void ParallelBufferPoolManager::GetResidentPages(std::vector<page_id_t> *page_ids) {
+  std::vector<std::vector<page_id_t>> instance_page_ids(this->num_instances_);
+  size_t max_count = 0;
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    this->instances_[i]->GetResidentPages(&instance_page_ids[i]);
+    max_count = std::max(max_count, instance_page_ids[i].size());
+  }
+  for (size_t rank = 0; rank < max_count; rank++) {
+    for (const auto &ids : instance_page_ids) {
+      if (rank < ids.size()) {
+        page_ids->push_back(ids[rank]);
+      }
+    }
+  }
+}
+
+void ParallelBufferPoolManager::WarmUp(const std::vector<page_id_t> &page_ids) {
+  // Every instance keeps the page ids it owns.
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    this->instances_[i]->WarmUp(page_ids);
+  }
+}
+
+void ParallelBufferPoolManager::WaitForWarmUp() {
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    this->instances_[i]->WaitForWarmUp();
+  }
+}
+
+void ParallelBufferPoolManager::StartPageCleaner(size_t clean_target, std::chrono::milliseconds interval) {
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    this->instances_[i]->StartPageCleaner(clean_target, interval);
+  }
+}
+
+void ParallelBufferPoolManager::StopPageCleaner() {
+  for (size_t i = 0; i < this->num_instances_; i++) {
+    this->instances_[i]->StopPageCleaner();
+  }
+}
+
+void ParallelBufferPoolManager::Prefetch(page_id_t page_id) {
+  if (page_id == INVALID_PAGE_ID) {
+    return;
+  }
+  this->GetBufferPoolManager(page_id)->Prefetch(page_id);
 }
 
 auto ParallelBufferPoolManager::GetBufferPoolManager(page_id_t page_id) -> BufferPoolManager * {
@@ -62,6 +171,10 @@ auto ParallelBufferPoolManager::FlushPgImp(page_id_t page_id) -> bool {
 }
 
 auto ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) -> Page * {
+  return this->NewTablespacePgImp(page_id, DEFAULT_TABLESPACE_ID);
+}
+
+auto ParallelBufferPoolManager::NewTablespacePgImp(page_id_t *page_id, tablespace_id_t tablespace_id) -> Page * {
   // create new page. We will request page allocation in a round robin manner from the underlying
   // BufferPoolManagerInstances
   // 1.   From a starting index of the BPMIs, call NewPageImpl until either 1) success and return 2) looped around to
@@ -71,7 +184,7 @@ auto ParallelBufferPoolManager::NewPgImp(page_id_t *page_id) -> Page * {
   std::lock_guard<std::mutex> guard(this->latch_);
   for (size_t i = 0; i < this->num_instances_; i++) {
     BufferPoolManager *instance = this->GetBufferPoolManager(this->starting_index_);
-    Page *page = instance->NewPage(page_id);
+    Page *page = instance->NewPage(page_id, tablespace_id);
     this->starting_index_ = (this->starting_index_ + 1) % this->num_instances_;
     if (page != nullptr) {
       // LOG_DEBUG("create new page id %d in instance id %d", *page_id, this->starting_index_ - 1);
@@ -92,11 +205,11 @@ auto ParallelBufferPoolManager::DeletePgImp(page_id_t page_id) -> bool {
 }
 
 void ParallelBufferPoolManager::FlushAllPgsImp() {
-  // flush all pages from all BufferPoolManagerInstances
+  // flush all pages from all BufferPoolManagerInstances, with a single sync for all of them
   for (size_t i = 0; i < this->num_instances_; i++) {
-    BufferPoolManager *instance = this->GetBufferPoolManager(i);
-    instance->FlushAllPages();
+    this->instances_[i]->WriteDirtyPages();
   }
+  this->disk_manager_->Sync();
 }
 
 }  // namespace bustub
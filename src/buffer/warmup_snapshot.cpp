@@ -0,0 +1,59 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// warmup_snapshot.cpp
+//
+// Identification: src/buffer/warmup_snapshot.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/warmup_snapshot.h"
+
+#include <cstdio>
+#include <fstream>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+auto WarmupSnapshot::Write(const std::string &file_name, const std::vector<page_id_t> &page_ids) -> bool {
+  std::string tmp_file_name = file_name + ".tmp";
+  {
+    std::ofstream out(tmp_file_name, std::ios::binary | std::ios::trunc);
+    uint32_t magic = MAGIC;
+    uint64_t count = page_ids.size();
+    out.write(reinterpret_cast<const char *>(&magic), sizeof(magic));
+    out.write(reinterpret_cast<const char *>(&count), sizeof(count));
+    out.write(reinterpret_cast<const char *>(page_ids.data()), static_cast<std::streamsize>(count * sizeof(page_id_t)));
+    if (!out.good()) {
+      LOG_WARN("failed to write warm-up snapshot %s", tmp_file_name.c_str());
+      return false;
+    }
+  }
+  return std::rename(tmp_file_name.c_str(), file_name.c_str()) == 0;
+}
+
+auto WarmupSnapshot::Read(const std::string &file_name, std::vector<page_id_t> *page_ids) -> bool {
+  std::ifstream in(file_name, std::ios::binary | std::ios::ate);
+  if (!in.is_open()) {
+    return false;
+  }
+  auto file_size = static_cast<uint64_t>(in.tellg());
+  in.seekg(0);
+  uint32_t magic = 0;
+  uint64_t count = 0;
+  in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char *>(&count), sizeof(count));
+  if (!in.good() || magic != MAGIC || file_size != sizeof(magic) + sizeof(count) + count * sizeof(page_id_t)) {
+    LOG_WARN("%s is not a complete warm-up snapshot", file_name.c_str());
+    return false;
+  }
+  page_ids->resize(count);
+  in.read(reinterpret_cast<char *>(page_ids->data()), static_cast<std::streamsize>(count * sizeof(page_id_t)));
+  return in.good();
+}
+
+}  // namespace bustub
@@ -0,0 +1,85 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.cpp
+//
+// Identification: src/common/util/crc32c.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/crc32c.h"
+
+#include <array>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <nmmintrin.h>
+#endif
+
+namespace bustub {
+
+/** Reflected CRC32C polynomial. */
+static constexpr uint32_t CRC32C_POLY = 0x82f63b78;
+
+static auto MakeTable() -> std::array<uint32_t, 256> {
+  std::array<uint32_t, 256> table{};
+  for (uint32_t i = 0; i < 256; i++) {
+    uint32_t crc = i;
+    for (int bit = 0; bit < 8; bit++) {
+      crc = (crc & 1) != 0 ? (crc >> 1) ^ CRC32C_POLY : crc >> 1;
+    }
+    table[i] = crc;
+  }
+  return table;
+}
+
+static const std::array<uint32_t, 256> CRC32C_TABLE = MakeTable();
+
+auto Crc32cUtil::ComputeSoftware(const char *data, size_t size, uint32_t crc) -> uint32_t {
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = CRC32C_TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xff] ^ (crc >> 8);
+  }
+  return ~crc;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("sse4.2"))) static auto ComputeHardware(const char *data, size_t size, uint32_t crc)
+    -> uint32_t {
+  uint64_t crc64 = ~crc;
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    memcpy(&word, data + i, sizeof(word));
+    crc64 = _mm_crc32_u64(crc64, word);
+  }
+  auto crc32 = static_cast<uint32_t>(crc64);
+  for (; i < size; i++) {
+    crc32 = _mm_crc32_u8(crc32, static_cast<uint8_t>(data[i]));
+  }
+  return ~crc32;
+}
+#endif
+
+auto Crc32cUtil::IsHardwareAccelerated() -> bool {
+#if defined(__x86_64__)
+  static const bool has_sse42 = __builtin_cpu_supports("sse4.2");
+  return has_sse42;
+#else
+  return false;
+#endif
+}
+
+auto Crc32cUtil::Compute(const char *data, size_t size, uint32_t crc) -> uint32_t {
+#if defined(__x86_64__)
+  if (IsHardwareAccelerated()) {
+    return ComputeHardware(data, size, crc);
+  }
+#endif
+  return ComputeSoftware(data, size, crc);
+}
+
+}  // namespace bustub
@@ -0,0 +1,172 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz_codec.cpp
+//
+// Identification: src/common/util/lz_codec.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "common/util/lz_codec.h"
+
+#include <cstdint>
+#include <cstring>
+
+namespace bustub {
+
+static constexpr size_t MIN_MATCH = 4;
+/** The last bytes are always literals, so that a match never needs to look past the end of the input. */
+static constexpr size_t LAST_LITERALS = 5;
+static constexpr size_t MAX_OFFSET = 65535;
+static constexpr int HASH_BITS = 12;
+
+static inline auto Read32(const uint8_t *p) -> uint32_t {
+  uint32_t value;
+  memcpy(&value, p, sizeof(value));
+  return value;
+}
+
+static inline auto Hash(uint32_t sequence) -> uint32_t { return (sequence * 2654435761U) >> (32 - HASH_BITS); }
+
+/** Writes the length that did not fit into a token nibble as a run of 255s and a final byte. */
+static inline auto WriteLength(size_t length, uint8_t *out, const uint8_t *out_end) -> uint8_t * {
+  for (; length >= 255; length -= 255) {
+    if (out >= out_end) {
+      return nullptr;
+    }
+    *out++ = 255;
+  }
+  if (out >= out_end) {
+    return nullptr;
+  }
+  *out++ = static_cast<uint8_t>(length);
+  return out;
+}
+
+/** Emits one token: literals, then a match unless match_length is 0. */
+static auto WriteSequence(const uint8_t *literals, size_t literal_length, size_t offset, size_t match_length,
+                          uint8_t *out, const uint8_t *out_end) -> uint8_t * {
+  if (out >= out_end) {
+    return nullptr;
+  }
+  uint8_t *token = out++;
+  size_t match_code = match_length == 0 ? 0 : match_length - MIN_MATCH;
+  *token = static_cast<uint8_t>((literal_length < 15 ? literal_length : 15) << 4 | (match_code < 15 ? match_code : 15));
+  if (literal_length >= 15 && (out = WriteLength(literal_length - 15, out, out_end)) == nullptr) {
+    return nullptr;
+  }
+  if (static_cast<size_t>(out_end - out) < literal_length) {
+    return nullptr;
+  }
+  memcpy(out, literals, literal_length);
+  out += literal_length;
+  if (match_length == 0) {
+    return out;
+  }
+  if (out_end - out < 2) {
+    return nullptr;
+  }
+  *out++ = static_cast<uint8_t>(offset);
+  *out++ = static_cast<uint8_t>(offset >> 8);
+  if (match_code >= 15 && (out = WriteLength(match_code - 15, out, out_end)) == nullptr) {
+    return nullptr;
+  }
+  return out;
+}
+
+auto LzCodec::Compress(const char *src, size_t size, char *dst, size_t capacity) -> size_t {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  const uint8_t *out_end = out + capacity;
+  uint16_t table[1 << HASH_BITS] = {};
+
+  size_t anchor = 0;
+  size_t pos = 0;
+  while (size >= MIN_MATCH + LAST_LITERALS && pos + MIN_MATCH <= size - LAST_LITERALS) {
+    uint32_t sequence = Read32(in + pos);
+    uint32_t hash = Hash(sequence);
+    size_t candidate = table[hash];
+    table[hash] = static_cast<uint16_t>(pos);
+    if (candidate >= pos || pos - candidate > MAX_OFFSET || Read32(in + candidate) != sequence) {
+      pos++;
+      continue;
+    }
+    size_t length = MIN_MATCH;
+    while (pos + length < size - LAST_LITERALS && in[candidate + length] == in[pos + length]) {
+      length++;
+    }
+    out = WriteSequence(in + anchor, pos - anchor, pos - candidate, length, out, out_end);
+    if (out == nullptr) {
+      return 0;
+    }
+    pos += length;
+    anchor = pos;
+  }
+  out = WriteSequence(in + anchor, size - anchor, 0, 0, out, out_end);
+  return out == nullptr ? 0 : static_cast<size_t>(out - reinterpret_cast<uint8_t *>(dst));
+}
+
+/** Reads the rest of a length whose token nibble was 15; false if the input ends first. */
+static inline auto ReadLength(const uint8_t **in, const uint8_t *in_end, size_t *length) -> bool {
+  uint8_t byte;
+  do {
+    if (*in >= in_end) {
+      return false;
+    }
+    byte = *(*in)++;
+    *length += byte;
+  } while (byte == 255);
+  return true;
+}
+
+auto LzCodec::Decompress(const char *src, size_t size, char *dst, size_t capacity) -> size_t {
+  const auto *in = reinterpret_cast<const uint8_t *>(src);
+  const uint8_t *in_end = in + size;
+  auto *out = reinterpret_cast<uint8_t *>(dst);
+  auto *out_begin = out;
+  const uint8_t *out_end = out + capacity;
+
+  while (in < in_end) {
+    uint8_t token = *in++;
+    size_t literal_length = token >> 4;
+    if (literal_length == 15 && !ReadLength(&in, in_end, &literal_length)) {
+      return 0;
+    }
+    if (static_cast<size_t>(in_end - in) < literal_length || static_cast<size_t>(out_end - out) < literal_length) {
+      return 0;
+    }
+    memcpy(out, in, literal_length);
+    in += literal_length;
+    out += literal_length;
+    if (in == in_end) {
+      // The last sequence has no match.
+      break;
+    }
+    if (in_end - in < 2) {
+      return 0;
+    }
+    size_t offset = in[0] | static_cast<size_t>(in[1]) << 8;
+    in += 2;
+    size_t match_length = token & 15;
+    if (match_length == 15 && !ReadLength(&in, in_end, &match_length)) {
+      return 0;
+    }
+    match_length += MIN_MATCH;
+    if (offset == 0 || offset > static_cast<size_t>(out - out_begin) ||
+        static_cast<size_t>(out_end - out) < match_length) {
+      return 0;
+    }
+    // The match may overlap the bytes it produces, so copy forward one byte at a time.
+    const uint8_t *match = out - offset;
+    for (size_t i = 0; i < match_length; i++) {
+      out[i] = match[i];
+    }
+    out += match_length;
+  }
+  return static_cast<size_t>(out - out_begin);
+}
+
+}  // namespace bustub
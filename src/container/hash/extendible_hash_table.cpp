@@ -10,8 +10,10 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <iostream>
 #include <string>
+#include <thread>  // NOLINT
 #include <utility>
 #include <vector>
 
@@ -24,22 +26,37 @@ namespace bustub {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_TYPE::ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn)
+                                     const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                                     tablespace_id_t tablespace_id)
     : buffer_pool_manager_(buffer_pool_manager), comparator_(comparator), hash_fn_(std::move(hash_fn)) {
   //  implement me!
-  HashTableDirectoryPage *dir_page =
-      reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->NewPage(&directory_page_id_)->GetData());
+  HashTableDirectoryPage *dir_page = reinterpret_cast<HashTableDirectoryPage *>(
+      buffer_pool_manager_->NewPage(&directory_page_id_, tablespace_id)->GetData());
   dir_page->SetPageId(directory_page_id_);
   page_id_t first_bucket_page_id;
-  buffer_pool_manager_->NewPage(&first_bucket_page_id);
+  buffer_pool_manager_->NewPage(&first_bucket_page_id, tablespace_id);
   dir_page->SetBucketPageId(0, first_bucket_page_id);
   buffer_pool_manager_->UnpinPage(first_bucket_page_id, false);
   buffer_pool_manager_->UnpinPage(directory_page_id_, false);
 }
 
+template <typename KeyType, typename ValueType, typename KeyComparator>
+HASH_TABLE_TYPE::~ExtendibleHashTable() {
+  StopMaintenance();
+}
+
 /*****************************************************************************
  * HELPERS
  *****************************************************************************/
+/** @return the bits of x in reverse order */
+static auto ReverseBits(uint32_t x) -> uint32_t {
+  x = ((x >> 1) & 0x55555555U) | ((x & 0x55555555U) << 1);
+  x = ((x >> 2) & 0x33333333U) | ((x & 0x33333333U) << 2);
+  x = ((x >> 4) & 0x0f0f0f0fU) | ((x & 0x0f0f0f0fU) << 4);
+  x = ((x >> 8) & 0x00ff00ffU) | ((x & 0x00ff00ffU) << 8);
+  return (x >> 16) | (x << 16);
+}
+
 /**
  * Hash - simple helper to downcast MurmurHash's 64-bit hash to 32-bit
  * for extendible hashing.
@@ -59,20 +76,71 @@ inline auto HASH_TABLE_TYPE::KeyToDirectoryIndex(KeyType key, HashTableDirectory
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 inline auto HASH_TABLE_TYPE::KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t {
-  // LOG_INFO("%d", KeyToDirectoryIndex(key, dir_page));
-  return dir_page->GetBucketPageId(KeyToDirectoryIndex(key, dir_page));
+  return HashTableDirectory(buffer_pool_manager_, dir_page).GetBucketPageId(KeyToDirectoryIndex(key, dir_page));
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::FetchDirectoryPage(Page **page) -> HashTableDirectoryPage * {
+  Page *dir_pg = buffer_pool_manager_->FetchPage(directory_page_id_);
+  if (page != nullptr) {
+    *page = dir_pg;
+  }
+  return reinterpret_cast<HashTableDirectoryPage *>(dir_pg->GetData());
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::LatchDirectoryForWrite(Page **page) -> HashTableDirectoryPage * {
+  HashTableDirectoryPage *dir_page = FetchDirectoryPage(page);
+  table_latch_.WLock();
+  (*page)->WLatch();
+  return dir_page;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::UnlatchDirectoryForWrite(Page *page, bool is_dirty) {
+  page->WUnlatch();
+  table_latch_.WUnlock();
+  buffer_pool_manager_->UnpinPage(directory_page_id_, is_dirty);
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::FetchDirectoryPage() -> HashTableDirectoryPage * {
-  return reinterpret_cast<HashTableDirectoryPage *>(buffer_pool_manager_->FetchPage(directory_page_id_)->GetData());
+auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id, Page **page) -> HASH_TABLE_BUCKET_TYPE * {
+  Page *bucket_pg = buffer_pool_manager_->FetchPage(bucket_page_id);
+  assert(bucket_pg != nullptr);
+  if (page != nullptr) {
+    *page = bucket_pg;
+  }
+  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_pg->GetData());
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE * {
-  Page *page = buffer_pool_manager_->FetchPage(bucket_page_id);
-  assert(page != nullptr);
-  return reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(page->GetData());
+auto HASH_TABLE_TYPE::FetchKeyBucket(KeyType key, bool exclusive, Page **page) -> HASH_TABLE_BUCKET_TYPE * {
+  while (true) {
+    Page *dir_pg;
+    HashTableDirectoryPage *dir_page = FetchDirectoryPage(&dir_pg);
+    dir_pg->RLatch();
+    uint64_t version = directory_version_.load();
+    page_id_t bucket_page_id = KeyToPageId(key, dir_page);
+    // The pin keeps a merge from deleting the bucket once the directory latch is released.
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id, page);
+    dir_pg->RUnlatch();
+    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
+    if (exclusive) {
+      (*page)->WLatch();
+    } else {
+      (*page)->RLatch();
+    }
+    // A split or merge that latched the bucket first may have moved the key's pairs elsewhere.
+    if (directory_version_.load() == version) {
+      return bucket_page;
+    }
+    if (exclusive) {
+      (*page)->WUnlatch();
+    } else {
+      (*page)->RUnlatch();
+    }
+    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+  }
 }
 
 /*****************************************************************************
@@ -80,18 +148,11 @@ auto HASH_TABLE_TYPE::FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BU
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  reinterpret_cast<Page *>(dir_page)->RLatch();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-  reinterpret_cast<Page *>(bucket_page)->RLatch();
+  Page *bucket_pg;
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchKeyBucket(key, false, &bucket_pg);
   bool flag = bucket_page->GetValue(key, comparator_, result);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-  table_latch_.RUnlock();
-  reinterpret_cast<Page *>(dir_page)->RUnlatch();
-  reinterpret_cast<Page *>(bucket_page)->RUnlatch();
+  bucket_pg->RUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_pg->GetPageId(), false);
   return flag;
 }
 
@@ -100,126 +161,89 @@ auto HASH_TABLE_TYPE::GetValue(Transaction *transaction, const KeyType &key, std
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Insert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  reinterpret_cast<Page *>(dir_page)->RLatch();
-  uint32_t bucket_id = KeyToDirectoryIndex(key, dir_page);
-  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_id);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-  reinterpret_cast<Page *>(bucket_page)->WLatch();
-  // LOG_INFO("insert to bucket %d page %d", KeyToDirectoryIndex(key, dir_page), bucket_page_id);
-  // bucket full
-  if (bucket_page->IsFull()) {
-    // LOG_INFO("bucket %d is full try to split", KeyToDirectoryIndex(key, dir_page));
-    uint32_t ori_global_depth = dir_page->GetGlobalDepth();
-    uint8_t ori_local_depth = dir_page->GetLocalDepth(bucket_id);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    reinterpret_cast<Page *>(dir_page)->RUnlatch();
-    table_latch_.RUnlock();
-
-    table_latch_.WLock();
-    reinterpret_cast<Page *>(dir_page)->WLatch();
-    // reinterpret_cast<Page *>(bucket_page)->WLatch();
-    if (ori_global_depth == dir_page->GetGlobalDepth() && ori_local_depth == dir_page->GetLocalDepth(bucket_id)) {
-      return SplitInsert(transaction, key, value);
+  while (true) {
+    Page *bucket_pg;
+    HASH_TABLE_BUCKET_TYPE *bucket_page = FetchKeyBucket(key, true, &bucket_pg);
+    page_id_t bucket_page_id = bucket_pg->GetPageId();
+    bool full = bucket_page->IsFull();
+    bool inserted = !full && bucket_page->Insert(key, value, comparator_);
+    bucket_pg->WUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_id, inserted);
+    if (inserted) {
+      num_pairs_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!full) {
+      return inserted;
+    }
+    Page *dir_pg;
+    HashTableDirectoryPage *dir_page = LatchDirectoryForWrite(&dir_pg);
+    bool split = SplitBucket(dir_page, Hash(key));
+    UnlatchDirectoryForWrite(dir_pg, split);
+    // If all pairs stayed on the key's side of the split, the next round splits the bucket again.
+    if (!split) {
+      return false;
     }
-    LOG_DEBUG("during acquire table W Lock global/local depth changed");
-    // reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    reinterpret_cast<Page *>(dir_page)->WUnlatch();
-    table_latch_.WUnlock();
-    return Insert(transaction, key, value);
-  }
-  if (!bucket_page->Insert(key, value, comparator_)) {
-    // LOG_INFO("same key value pair");
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    reinterpret_cast<Page *>(dir_page)->RUnlatch();
-    table_latch_.RUnlock();
-    return false;
   }
-
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-  reinterpret_cast<Page *>(dir_page)->RUnlatch();
-  table_latch_.RUnlock();
-  return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
-auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  uint32_t global_depth = dir_page->GetGlobalDepth();
-  uint32_t bucket_index = KeyToDirectoryIndex(key, dir_page);
-  uint32_t local_depth = dir_page->GetLocalDepth(bucket_index);
-  // dir_page->PrintDirectory();
-  if (local_depth == global_depth) {
-    dir_page->IncrGlobalDepth();
-    // redir bucketpageid
-    LOG_INFO("increse global depth now %d", global_depth);
-    for (size_t i = 0; i < dir_page->Size() / 2; i++) {
-      // LOG_INFO("set bucket %d to page %d local depth %d", dir_page->GetImageIndex(i), dir_page->GetBucketPageId(i),
-      //          dir_page->GetLocalDepth(i));
-      dir_page->SetBucketPageId(dir_page->GetImageIndex(i), dir_page->GetBucketPageId(i));
-      dir_page->SetLocalDepth(dir_page->GetImageIndex(i), dir_page->GetLocalDepth(i));
+auto HASH_TABLE_TYPE::SplitBucket(HashTableDirectoryPage *dir_page, uint32_t hash) -> bool {
+  page_id_t bucket_page_id;
+  page_id_t image_page_id;
+  Page *bucket_pg;
+  Page *image_pg = nullptr;
+  HASH_TABLE_BUCKET_TYPE *bucket_page;
+  uint32_t high_bit;
+  {
+    HashTableDirectory directory(buffer_pool_manager_, dir_page);
+    uint32_t bucket_idx = hash & directory.GetGlobalDepthMask();
+    bucket_page_id = directory.GetBucketPageId(bucket_idx);
+    uint32_t local_depth = directory.GetLocalDepth(bucket_idx);
+    // Lookups don't hold the directory latch while they use a bucket, so the bucket stays latched from this check
+    // until its pairs are moved.
+    bucket_page = FetchBucketPage(bucket_page_id, &bucket_pg);
+    bucket_pg->WLatch();
+    // another insert may have split the bucket, or a remove made room, while no latch was held
+    bool full = bucket_page->IsFull();
+    if (full && local_depth == directory.GetGlobalDepth() && !directory.IncrGlobalDepth()) {
+      LOG_WARN("hash table directory can't grow past global depth %u", directory.GetGlobalDepth());
+    } else if (full) {
+      // buckets stay in the tablespace of the directory
+      image_pg = buffer_pool_manager_->NewPage(&image_page_id, TablespaceOf(directory_page_id_));
+      if (image_pg == nullptr) {
+        LOG_ERROR("buffer pool overflow");
+      }
     }
-  }
-  page_id_t new_page_id;
-  uint32_t new_bucket_id = dir_page->GetImageIndex(bucket_index);
-  Page *new_pg = buffer_pool_manager_->NewPage(&new_page_id);
-  if (new_pg == nullptr) {
-    LOG_ERROR("buffer pool overflow");
-    // buffer_pool_manager_->UnpinPage(new_page_id, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-    table_latch_.WUnlock();
-    return false;
-  }
-  // split bucket
-  // LOG_INFO("set new bucket id %d to page %d", new_bucket_id, new_page_id);
-  dir_page->SetBucketPageId(new_bucket_id, new_page_id);
-  dir_page->IncrLocalDepth(bucket_index);
-  dir_page->IncrLocalDepth(new_bucket_id);
-  // bool flag;
-  // dir_page->PrintDirectory();
-  //  split items
-  HASH_TABLE_BUCKET_TYPE *page = FetchBucketPage(bucket_page_id);
-  reinterpret_cast<Page *>(page)->WLatch();
-  HASH_TABLE_BUCKET_TYPE *new_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(new_pg->GetData());
-  new_pg->WLatch();
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    ValueType value1 = page->ValueAt(i);
-    KeyType key1 = page->KeyAt(i);
-    uint32_t id = KeyToDirectoryIndex(key1, dir_page);
-    if (id == new_bucket_id) {
-      page->RemoveAt(i);
-      new_page->Insert(key1, value1, comparator_);
+    if (image_pg == nullptr) {
+      bucket_pg->WUnlatch();
+      buffer_pool_manager_->UnpinPage(bucket_page_id, false);
+      return !full;
+    }
+    image_pg->WLatch();
+    // The bucket's slots are those congruent to bucket_idx modulo 2^local_depth. The ones with the bit of the new local
+    // depth set now point to the split image.
+    high_bit = 1U << local_depth;
+    for (uint32_t i = bucket_idx & (high_bit - 1); i < directory.Size(); i += high_bit) {
+      directory.SetLocalDepth(i, local_depth + 1);
+      if ((i & high_bit) != 0) {
+        directory.SetBucketPageId(i, image_page_id);
+      }
     }
+    directory_version_++;
   }
-  // LOG_INFO("try to reinsert");
-  // new_page->PrintBucket();
-  // page->PrintBucket();
-  page_id_t id = KeyToPageId(key, dir_page);
-  if (id == new_page_id) {
-    new_page->Insert(key, value, comparator_);
-  } else if (id == bucket_page_id) {
-    page->Insert(key, value, comparator_);
-  } else {
-    table_latch_.WUnlock();
-    LOG_ERROR("error split");
-    return false;
+  num_buckets_++;
+  maintained_pairs_ = UINT64_MAX;
+  auto *image_page = reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(image_pg->GetData());
+  for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+    if (bucket_page->IsReadable(i) && (Hash(bucket_page->KeyAt(i)) & high_bit) != 0) {
+      image_page->Insert(bucket_page->KeyAt(i), bucket_page->ValueAt(i), comparator_);
+      bucket_page->RemoveAt(i);
+    }
   }
+  image_pg->WUnlatch();
+  bucket_pg->WUnlatch();
+  buffer_pool_manager_->UnpinPage(image_page_id, true);
   buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-  buffer_pool_manager_->UnpinPage(new_page_id, true);
-  reinterpret_cast<Page *>(page)->WUnlatch();
-  new_pg->WUnlatch();
-  reinterpret_cast<Page *>(dir_page)->WUnlatch();
-  table_latch_.WUnlock();
   return true;
 }
 
@@ -228,93 +252,292 @@ auto HASH_TABLE_TYPE::SplitInsert(Transaction *transaction, const KeyType &key,
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_TYPE::Remove(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool {
-  table_latch_.RLock();
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  reinterpret_cast<Page *>(dir_page)->RLatch();
-  uint32_t bucket_id = KeyToDirectoryIndex(key, dir_page);
-  page_id_t bucket_page_id = dir_page->GetBucketPageId(bucket_id);
-  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id);
-  reinterpret_cast<Page *>(bucket_page)->WLatch();
-  if (!bucket_page->Remove(key, value, comparator_)) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    reinterpret_cast<Page *>(dir_page)->RUnlatch();
-    table_latch_.RUnlock();
+  Page *bucket_pg;
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchKeyBucket(key, true, &bucket_pg);
+  page_id_t bucket_page_id = bucket_pg->GetPageId();
+  bool removed = bucket_page->Remove(key, value, comparator_);
+  bool empty = removed && bucket_page->IsEmpty();
+  bucket_pg->WUnlatch();
+  buffer_pool_manager_->UnpinPage(bucket_page_id, removed);
+  if (!removed) {
     return false;
   }
-  if (bucket_page->IsEmpty()) {
-    LOG_INFO("bucket %d is empty try to merge", KeyToDirectoryIndex(key, dir_page));
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-    uint32_t ori_global_depth = dir_page->GetGlobalDepth();
-    uint8_t ori_local_depth = dir_page->GetLocalDepth(bucket_id);
-    reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-    reinterpret_cast<Page *>(dir_page)->RUnlatch();
-    table_latch_.RUnlock();
-
-    table_latch_.WLock();
-    reinterpret_cast<Page *>(dir_page)->WLatch();
-    if (ori_global_depth == dir_page->GetGlobalDepth() && ori_local_depth == dir_page->GetLocalDepth(bucket_id)) {
-      Merge(transaction, key, value);
-      return true;
-    }
-    LOG_DEBUG("during require W Lock global/local depth changed");
-    reinterpret_cast<Page *>(dir_page)->WUnlatch();
-    table_latch_.WUnlock();
-    return Remove(transaction, key, value);
+  num_pairs_.fetch_sub(1, std::memory_order_relaxed);
+  if (empty) {
+    merges_avoided_++;
   }
-  buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-  buffer_pool_manager_->UnpinPage(bucket_page_id, true);
-  reinterpret_cast<Page *>(bucket_page)->WUnlatch();
-  reinterpret_cast<Page *>(dir_page)->RUnlatch();
-  table_latch_.RUnlock();
+  if (!MaintenanceDue()) {
+    return true;
+  }
+  std::unique_lock<std::mutex> lock(maintenance_latch_);
+  if (maintenance_running_) {
+    // the maintenance thread runs the pass, not the caller
+    maintenance_requested_ = true;
+    lock.unlock();
+    maintenance_cv_.notify_one();
+    return true;
+  }
+  lock.unlock();
+  RunMaintenance();
   return true;
 }
 
 /*****************************************************************************
- * MERGE
+ * MAINTENANCE
  *****************************************************************************/
 template <typename KeyType, typename ValueType, typename KeyComparator>
-void HASH_TABLE_TYPE::Merge(Transaction *transaction, const KeyType &key, const ValueType &value) {
-  HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  uint32_t bucket_id = KeyToDirectoryIndex(key, dir_page);
-  page_id_t bucket_page_id = KeyToPageId(key, dir_page);
-  uint32_t image_bucket_id = dir_page->GetImageIndex(bucket_id);
-  page_id_t image_bucket_page_id = dir_page->GetBucketPageId(image_bucket_id);
-  // dir_page->PrintDirectory();
-  if (!dir_page->DoMerge(bucket_id, image_bucket_id)) {
-    buffer_pool_manager_->UnpinPage(directory_page_id_, false);
-    buffer_pool_manager_->UnpinPage(bucket_page_id, false);
-    buffer_pool_manager_->UnpinPage(image_bucket_page_id, false);
-    reinterpret_cast<Page *>(dir_page)->WUnlatch();
-    table_latch_.WUnlock();
+void HASH_TABLE_TYPE::StartMaintenance(std::chrono::milliseconds interval) {
+  std::lock_guard<std::mutex> guard(maintenance_latch_);
+  if (maintenance_running_) {
     return;
   }
-  LOG_DEBUG("successful merge bucket %d and image %d now local depth %d", bucket_id, image_bucket_id,
-            dir_page->GetLocalDepth(bucket_id));
-  // dir_page->PrintDirectory();
-  // shrink
-SHRINK:
-  if (dir_page->CanShrink()) {
-    dir_page->DecrGlobalDepth();
-    LOG_INFO("shrink to global depth %d", dir_page->GetGlobalDepth());
-    for (size_t i = 0; i < dir_page->Size(); i++) {
-      page_id_t page_id = dir_page->GetBucketPageId(i);
-      HASH_TABLE_BUCKET_TYPE *page = FetchBucketPage(page_id);
-      reinterpret_cast<Page *>(page)->RLatch();
-      if (page->IsEmpty()) {
-        dir_page->DoMerge(i, dir_page->GetImageIndex(i));
+  maintenance_interval_ = interval;
+  maintenance_running_ = true;
+  maintenance_thread_ = std::thread(&HASH_TABLE_TYPE::RunMaintenanceThread, this);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::StopMaintenance() {
+  {
+    std::lock_guard<std::mutex> guard(maintenance_latch_);
+    maintenance_running_ = false;
+  }
+  maintenance_cv_.notify_one();
+  if (maintenance_thread_.joinable()) {
+    maintenance_thread_.join();
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_TYPE::RunMaintenanceThread() {
+  std::unique_lock<std::mutex> lock(maintenance_latch_);
+  while (maintenance_running_) {
+    maintenance_cv_.wait_for(lock, maintenance_interval_,
+                             [this] { return maintenance_requested_ || !maintenance_running_; });
+    if (!maintenance_running_) {
+      break;
+    }
+    maintenance_requested_ = false;
+    lock.unlock();
+    if (MaintenanceDue() || num_unreclaimed_pages_.load(std::memory_order_relaxed) > 0) {
+      RunMaintenance();
+    }
+    lock.lock();
+  }
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::MaintenanceDue() -> bool {
+  uint64_t num_pairs = num_pairs_.load(std::memory_order_relaxed);
+  uint64_t num_buckets = num_buckets_.load(std::memory_order_relaxed);
+  return num_buckets > 1 && num_pairs * 100 < LOW_FILL_PERCENT * num_buckets * BUCKET_ARRAY_SIZE &&
+         num_pairs <= maintained_pairs_.load(std::memory_order_relaxed) / 2;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::RunMaintenance() -> size_t {
+  Page *dir_pg;
+  HashTableDirectoryPage *dir_page = LatchDirectoryForWrite(&dir_pg);
+  size_t merges = 0;
+  {
+    // No slot points to these pages anymore; the lookups that had them pinned are gone by now, or by a later pass.
+    auto deleted = std::remove_if(unreclaimed_pages_.begin(), unreclaimed_pages_.end(),
+                                  [this](page_id_t page_id) { return buffer_pool_manager_->DeletePage(page_id); });
+    unreclaimed_pages_.erase(deleted, unreclaimed_pages_.end());
+    HashTableDirectory directory(buffer_pool_manager_, dir_page);
+    for (uint32_t i = 0; i < directory.Size(); i++) {
+      // each bucket is visited at its first slot; a merged bucket may merge again with its new split image
+      if ((i >> directory.GetLocalDepth(i)) != 0) {
+        continue;
       }
-      buffer_pool_manager_->UnpinPage(page_id, false);
-      reinterpret_cast<Page *>(page)->RUnlatch();
+      while (MergeBucket(&directory, i)) {
+        merges++;
+      }
+    }
+    while (merges > 0 && directory.CanShrink()) {
+      directory.DecrGlobalDepth();
     }
-    dir_page->PrintDirectory();
-    goto SHRINK;
+    num_unreclaimed_pages_ = unreclaimed_pages_.size();
   }
-  buffer_pool_manager_->UnpinPage(directory_page_id_, true);
-  reinterpret_cast<Page *>(dir_page)->WUnlatch();
-  table_latch_.WUnlock();
+  maintained_pairs_ = num_pairs_.load();
+  UnlatchDirectoryForWrite(dir_pg, merges > 0);
+  return merges;
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::MergeBucket(HashTableDirectory *directory, uint32_t bucket_idx) -> bool {
+  uint32_t local_depth = directory->GetLocalDepth(bucket_idx);
+  if (local_depth == 0) {
+    return false;
+  }
+  uint32_t high_bit = 1U << (local_depth - 1);
+  uint32_t image_idx = bucket_idx ^ high_bit;
+  if (directory->GetLocalDepth(image_idx) != local_depth) {
+    return false;
+  }
+  page_id_t bucket_page_id = directory->GetBucketPageId(bucket_idx);
+  page_id_t image_page_id = directory->GetBucketPageId(image_idx);
+  // Both buckets stay latched until the directory no longer points to the emptier one, so that no lookup misses the
+  // pairs moved out of it.
+  Page *bucket_pg;
+  Page *image_pg;
+  HASH_TABLE_BUCKET_TYPE *bucket_page = FetchBucketPage(bucket_page_id, &bucket_pg);
+  HASH_TABLE_BUCKET_TYPE *image_page = FetchBucketPage(image_page_id, &image_pg);
+  bucket_pg->WLatch();
+  image_pg->WLatch();
+  uint32_t bucket_size = bucket_page->NumReadable();
+  uint32_t image_size = image_page->NumReadable();
+  bool merge = (bucket_size + image_size) * 100 <= MERGE_FILL_PERCENT * BUCKET_ARRAY_SIZE;
+  bool keep_bucket = bucket_size >= image_size;
+  if (merge) {
+    HASH_TABLE_BUCKET_TYPE *from = keep_bucket ? image_page : bucket_page;
+    HASH_TABLE_BUCKET_TYPE *to = keep_bucket ? bucket_page : image_page;
+    for (uint32_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
+      if (from->IsReadable(i)) {
+        to->Insert(from->KeyAt(i), from->ValueAt(i), comparator_);
+      }
+    }
+    page_id_t merged_page_id = keep_bucket ? bucket_page_id : image_page_id;
+    for (uint32_t i = bucket_idx & (high_bit - 1); i < directory->Size(); i += high_bit) {
+      directory->SetLocalDepth(i, local_depth - 1);
+      directory->SetBucketPageId(i, merged_page_id);
+    }
+    directory_version_++;
+  }
+  image_pg->WUnlatch();
+  bucket_pg->WUnlatch();
+  buffer_pool_manager_->UnpinPage(image_page_id, merge && !keep_bucket);
+  buffer_pool_manager_->UnpinPage(bucket_page_id, merge && keep_bucket);
+  if (!merge) {
+    return false;
+  }
+  num_buckets_--;
+  merges_++;
+  // No slot points to the emptied bucket anymore, so its page id and disk space are reused. Lookups that pinned it
+  // before the directory changed unpin it as soon as they see the new version; until then, the next pass retries.
+  page_id_t empty_page_id = keep_bucket ? image_page_id : bucket_page_id;
+  if (!buffer_pool_manager_->DeletePage(empty_page_id)) {
+    unreclaimed_pages_.push_back(empty_page_id);
+  }
+  return true;
+}
+
+/*****************************************************************************
+ * BULK LOAD
+ *****************************************************************************/
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_TYPE::BulkLoad(Transaction *transaction, const std::vector<std::pair<KeyType, ValueType>> &pairs)
+    -> bool {
+  // Sorted by their bit-reversed hashes, the pairs whose hashes end in the same bits, which is those of a bucket, are
+  // next to each other at every local depth.
+  std::vector<std::pair<uint32_t, size_t>> order(pairs.size());
+  for (size_t i = 0; i < pairs.size(); i++) {
+    order[i] = {ReverseBits(Hash(pairs[i].first)), i};
+  }
+  std::sort(order.begin(), order.end());
+
+  // A bucket holds order[begin, end), the pairs whose hashes end in the local_depth bits of suffix.
+  struct Partition {
+    size_t begin_;
+    size_t end_;
+    uint32_t suffix_;
+    uint32_t local_depth_;
+  };
+  std::vector<Partition> partitions;
+  std::vector<Partition> pending{{0, order.size(), 0, 0}};
+  uint32_t global_depth = 0;
+  while (!pending.empty()) {
+    Partition partition = pending.back();
+    pending.pop_back();
+    if (partition.end_ - partition.begin_ <= BUCKET_ARRAY_SIZE) {
+      partitions.push_back(partition);
+      global_depth = std::max(global_depth, partition.local_depth_);
+      continue;
+    }
+    if (partition.local_depth_ == HashTableDirectory::MAX_GLOBAL_DEPTH) {
+      LOG_WARN("can't bulk load, more pairs share a hash than fit into a bucket");
+      return false;
+    }
+    uint32_t reversed_bit = 31 - partition.local_depth_;
+    size_t middle = std::partition_point(order.begin() + partition.begin_, order.begin() + partition.end_,
+                                         [reversed_bit](const std::pair<uint32_t, size_t> &entry) {
+                                           return ((entry.first >> reversed_bit) & 1) == 0;
+                                         }) -
+                    order.begin();
+    // the upper half goes first, so partitions come out in the order of the pairs
+    pending.push_back({middle, partition.end_, partition.suffix_ | (1U << partition.local_depth_),
+                       partition.local_depth_ + 1});
+    pending.push_back({partition.begin_, middle, partition.suffix_, partition.local_depth_ + 1});
+  }
+
+  // duplicate pairs are dropped, as Insert would
+  uint64_t num_pairs = 0;
+  auto fill_bucket = [&](HASH_TABLE_BUCKET_TYPE *bucket_page, const Partition &partition) {
+    for (size_t i = partition.begin_; i < partition.end_; i++) {
+      const auto &[key, value] = pairs[order[i].second];
+      num_pairs += bucket_page->Insert(key, value, comparator_) ? 1 : 0;
+    }
+  };
+
+  Page *dir_pg;
+  HashTableDirectoryPage *dir_page = LatchDirectoryForWrite(&dir_pg);
+  bool loaded;
+  {
+    HashTableDirectory directory(buffer_pool_manager_, dir_page);
+    std::vector<page_id_t> bucket_page_ids(partitions.size(), INVALID_PAGE_ID);
+    bucket_page_ids[0] = directory.GetBucketPageId(0);
+    // The first bucket stays latched until the directory points to all buckets, so that no insert slips in.
+    Page *first_bucket_pg;
+    HASH_TABLE_BUCKET_TYPE *first_bucket_page = FetchBucketPage(bucket_page_ids[0], &first_bucket_pg);
+    first_bucket_pg->WLatch();
+    bool empty = directory.GetGlobalDepth() == 0 && first_bucket_page->IsEmpty();
+    loaded = empty;
+    while (loaded && directory.GetGlobalDepth() < global_depth) {
+      loaded = directory.IncrGlobalDepth();
+    }
+    // Buckets stay in the tablespace of the directory. The first bucket is filled last, so that the table is still
+    // empty if a page can't be allocated.
+    for (size_t i = 1; loaded && i < partitions.size(); i++) {
+      Page *bucket_pg = buffer_pool_manager_->NewPage(&bucket_page_ids[i], TablespaceOf(directory_page_id_));
+      if (bucket_pg == nullptr) {
+        LOG_ERROR("buffer pool overflow");
+        bucket_page_ids[i] = INVALID_PAGE_ID;
+        loaded = false;
+        break;
+      }
+      fill_bucket(reinterpret_cast<HASH_TABLE_BUCKET_TYPE *>(bucket_pg->GetData()), partitions[i]);
+      buffer_pool_manager_->UnpinPage(bucket_page_ids[i], true);
+    }
+    if (loaded) {
+      fill_bucket(first_bucket_page, partitions[0]);
+      // The partitions' suffixes pick their slots; the slots are then written in order, one leaf after another.
+      std::vector<uint32_t> slot_partitions(directory.Size());
+      for (uint32_t p = 0; p < partitions.size(); p++) {
+        for (uint32_t i = partitions[p].suffix_; i < directory.Size(); i += 1U << partitions[p].local_depth_) {
+          slot_partitions[i] = p;
+        }
+      }
+      for (uint32_t i = 0; i < directory.Size(); i++) {
+        directory.SetBucketPageId(i, bucket_page_ids[slot_partitions[i]]);
+        directory.SetLocalDepth(i, partitions[slot_partitions[i]].local_depth_);
+      }
+      directory_version_++;
+      num_pairs_ = num_pairs;
+      num_buckets_ = partitions.size();
+      maintained_pairs_ = UINT64_MAX;
+    } else if (empty) {
+      for (size_t i = 1; i < partitions.size() && bucket_page_ids[i] != INVALID_PAGE_ID; i++) {
+        buffer_pool_manager_->DeletePage(bucket_page_ids[i]);
+      }
+      while (directory.CanShrink()) {
+        directory.DecrGlobalDepth();
+      }
+    }
+    first_bucket_pg->WUnlatch();
+    buffer_pool_manager_->UnpinPage(bucket_page_ids[0], loaded);
+  }
+  UnlatchDirectoryForWrite(dir_pg, true);
+  return loaded;
 }
 
 /*****************************************************************************
@@ -337,7 +560,7 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_TYPE::VerifyIntegrity() {
   table_latch_.RLock();
   HashTableDirectoryPage *dir_page = FetchDirectoryPage();
-  dir_page->VerifyIntegrity();
+  HashTableDirectory(buffer_pool_manager_, dir_page).VerifyIntegrity();
   assert(buffer_pool_manager_->UnpinPage(directory_page_id_, false, nullptr));
   table_latch_.RUnlock();
 }
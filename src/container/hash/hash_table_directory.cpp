@@ -0,0 +1,233 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_table_directory.cpp
+//
+// Identification: src/container/hash/hash_table_directory.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "container/hash/hash_table_directory.h"
+
+#include <algorithm>
+#include <cassert>
+#include <unordered_map>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+HashTableDirectory::HashTableDirectory(BufferPoolManager *buffer_pool_manager, HashTableDirectoryPage *root)
+    : buffer_pool_manager_(buffer_pool_manager), root_(root) {}
+
+HashTableDirectory::~HashTableDirectory() { ReleaseLeaf(); }
+
+auto HashTableDirectory::GetBucketPageId(uint32_t bucket_idx) -> page_id_t {
+  return PageOf(bucket_idx, false)->GetBucketPageId(SlotOf(bucket_idx));
+}
+
+void HashTableDirectory::SetBucketPageId(uint32_t bucket_idx, page_id_t bucket_page_id) {
+  PageOf(bucket_idx, true)->SetBucketPageId(SlotOf(bucket_idx), bucket_page_id);
+}
+
+auto HashTableDirectory::GetLocalDepth(uint32_t bucket_idx) -> uint32_t {
+  return PageOf(bucket_idx, false)->GetLocalDepth(SlotOf(bucket_idx));
+}
+
+void HashTableDirectory::SetLocalDepth(uint32_t bucket_idx, uint8_t local_depth) {
+  HashTableDirectoryPage *page = PageOf(bucket_idx, true);
+  if (page == root_) {
+    root_->SetLocalDepth(bucket_idx, local_depth);
+    return;
+  }
+  if (local_depth < page->GetLocalDepth(SlotOf(bucket_idx))) {
+    leaf_depth_lowered_ = true;
+  } else if (local_depth > root_->GetLocalDepth(leaf_idx_)) {
+    root_->SetLocalDepth(leaf_idx_, local_depth);
+  }
+  page->SetLocalDepth(SlotOf(bucket_idx), local_depth);
+}
+
+auto HashTableDirectory::IncrGlobalDepth() -> bool {
+  uint32_t global_depth = GetGlobalDepth();
+  if (global_depth >= MAX_GLOBAL_DEPTH) {
+    return false;
+  }
+  if (global_depth < DIRECTORY_MAX_DEPTH) {
+    for (uint32_t i = 0; i < Size(); i++) {
+      root_->SetBucketPageId(i + Size(), root_->GetBucketPageId(i));
+      root_->SetLocalDepth(i + Size(), root_->GetLocalDepth(i));
+    }
+    root_->IncrGlobalDepth();
+    return true;
+  }
+  ReleaseLeaf();
+  tablespace_id_t tablespace_id = TablespaceOf(root_->GetPageId());
+  if (global_depth == DIRECTORY_MAX_DEPTH) {
+    // The root's slots become both leaves, and the root lists them.
+    page_id_t leaf_page_ids[2];
+    for (uint32_t i = 0; i < 2; i++) {
+      Page *page = buffer_pool_manager_->NewPage(&leaf_page_ids[i], tablespace_id);
+      if (page == nullptr) {
+        for (uint32_t j = 0; j < i; j++) {
+          buffer_pool_manager_->DeletePage(leaf_page_ids[j]);
+        }
+        return false;
+      }
+      auto *leaf = reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
+      *leaf = *root_;
+      leaf->SetPageId(leaf_page_ids[i]);
+      buffer_pool_manager_->UnpinPage(leaf_page_ids[i], true);
+    }
+    uint32_t max_local_depth = 0;
+    for (uint32_t i = 0; i < DIRECTORY_ARRAY_SIZE; i++) {
+      max_local_depth = std::max(max_local_depth, root_->GetLocalDepth(i));
+    }
+    for (uint32_t i = 0; i < 2; i++) {
+      root_->SetBucketPageId(i, leaf_page_ids[i]);
+      root_->SetLocalDepth(i, max_local_depth);
+    }
+    root_->IncrGlobalDepth();
+    return true;
+  }
+  // Leaf i + num_leaves is a copy of leaf i.
+  uint32_t num_leaves = 1U << (global_depth - DIRECTORY_MAX_DEPTH);
+  for (uint32_t i = 0; i < num_leaves; i++) {
+    page_id_t leaf_page_id;
+    Page *page = buffer_pool_manager_->NewPage(&leaf_page_id, tablespace_id);
+    if (page == nullptr) {
+      for (uint32_t j = 0; j < i; j++) {
+        buffer_pool_manager_->DeletePage(root_->GetBucketPageId(num_leaves + j));
+      }
+      return false;
+    }
+    Page *original = buffer_pool_manager_->FetchPage(root_->GetBucketPageId(i));
+    assert(original != nullptr);
+    auto *leaf = reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
+    *leaf = *reinterpret_cast<HashTableDirectoryPage *>(original->GetData());
+    leaf->SetPageId(leaf_page_id);
+    buffer_pool_manager_->UnpinPage(original->GetPageId(), false);
+    buffer_pool_manager_->UnpinPage(leaf_page_id, true);
+    root_->SetBucketPageId(num_leaves + i, leaf_page_id);
+    root_->SetLocalDepth(num_leaves + i, root_->GetLocalDepth(i));
+  }
+  root_->IncrGlobalDepth();
+  return true;
+}
+
+void HashTableDirectory::DecrGlobalDepth() {
+  uint32_t global_depth = GetGlobalDepth();
+  if (global_depth <= DIRECTORY_MAX_DEPTH) {
+    root_->DecrGlobalDepth();
+    return;
+  }
+  ReleaseLeaf();
+  uint32_t num_leaves = 1U << (global_depth - DIRECTORY_MAX_DEPTH);
+  if (num_leaves == 2) {
+    // Both leaves hold the same slots now, so the first one becomes the root again.
+    page_id_t root_page_id = root_->GetPageId();
+    lsn_t root_lsn = root_->GetLSN();
+    page_id_t leaf_page_ids[] = {root_->GetBucketPageId(0), root_->GetBucketPageId(1)};
+    Page *page = buffer_pool_manager_->FetchPage(leaf_page_ids[0]);
+    assert(page != nullptr);
+    *root_ = *reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
+    root_->SetPageId(root_page_id);
+    root_->SetLSN(root_lsn);
+    buffer_pool_manager_->UnpinPage(leaf_page_ids[0], false);
+    for (page_id_t leaf_page_id : leaf_page_ids) {
+      buffer_pool_manager_->DeletePage(leaf_page_id);
+    }
+    return;
+  }
+  for (uint32_t i = num_leaves / 2; i < num_leaves; i++) {
+    buffer_pool_manager_->DeletePage(root_->GetBucketPageId(i));
+  }
+  root_->DecrGlobalDepth();
+}
+
+auto HashTableDirectory::CanShrink() -> bool {
+  if (!HasLeaves()) {
+    return GetGlobalDepth() > 0 && root_->CanShrink();
+  }
+  ReleaseLeaf();
+  uint32_t num_leaves = 1U << (GetGlobalDepth() - DIRECTORY_MAX_DEPTH);
+  for (uint32_t i = 0; i < num_leaves; i++) {
+    if (root_->GetLocalDepth(i) >= GetGlobalDepth()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void HashTableDirectory::VerifyIntegrity() {
+  if (!HasLeaves()) {
+    root_->VerifyIntegrity();
+    return;
+  }
+  std::unordered_map<page_id_t, uint32_t> page_id_to_count;
+  std::unordered_map<page_id_t, uint32_t> page_id_to_ld;
+  uint32_t max_local_depth = 0;
+  for (uint32_t i = 0; i < Size(); i++) {
+    page_id_t page_id = GetBucketPageId(i);
+    uint32_t local_depth = GetLocalDepth(i);
+    assert(local_depth <= GetGlobalDepth());
+    ++page_id_to_count[page_id];
+    auto [it, inserted] = page_id_to_ld.emplace(page_id, local_depth);
+    if (!inserted && it->second != local_depth) {
+      LOG_WARN("Verify Integrity: curr_local_depth: %u, old_local_depth %u, for page_id: %d", local_depth, it->second,
+               page_id);
+      assert(it->second == local_depth);
+    }
+    max_local_depth = std::max(max_local_depth, local_depth);
+    if (SlotOf(i + 1) == 0) {
+      assert(leaf_->GetGlobalDepth() == DIRECTORY_MAX_DEPTH);
+      ReleaseLeaf();
+      assert(root_->GetLocalDepth(LeafOf(i)) == max_local_depth);
+      max_local_depth = 0;
+    }
+  }
+  for (auto [page_id, count] : page_id_to_count) {
+    uint32_t required_count = 1U << (GetGlobalDepth() - page_id_to_ld[page_id]);
+    if (count != required_count) {
+      LOG_WARN("Verify Integrity: curr_count: %u, required_count %u, for page_id: %d", count, required_count, page_id);
+      assert(count == required_count);
+    }
+  }
+}
+
+auto HashTableDirectory::PageOf(uint32_t bucket_idx, bool is_dirty) -> HashTableDirectoryPage * {
+  if (!HasLeaves()) {
+    return root_;
+  }
+  if (leaf_ == nullptr || leaf_idx_ != LeafOf(bucket_idx)) {
+    ReleaseLeaf();
+    leaf_idx_ = LeafOf(bucket_idx);
+    Page *page = buffer_pool_manager_->FetchPage(root_->GetBucketPageId(leaf_idx_));
+    assert(page != nullptr);
+    leaf_ = reinterpret_cast<HashTableDirectoryPage *>(page->GetData());
+  }
+  leaf_dirty_ = leaf_dirty_ || is_dirty;
+  return leaf_;
+}
+
+void HashTableDirectory::ReleaseLeaf() {
+  if (leaf_ == nullptr) {
+    return;
+  }
+  if (leaf_depth_lowered_) {
+    uint32_t max_local_depth = 0;
+    for (uint32_t i = 0; i < DIRECTORY_ARRAY_SIZE; i++) {
+      max_local_depth = std::max(max_local_depth, leaf_->GetLocalDepth(i));
+    }
+    root_->SetLocalDepth(leaf_idx_, max_local_depth);
+  }
+  buffer_pool_manager_->UnpinPage(leaf_->GetPageId(), leaf_dirty_);
+  leaf_ = nullptr;
+  leaf_dirty_ = false;
+  leaf_depth_lowered_ = false;
+}
+
+}  // namespace bustub
@@ -14,9 +14,13 @@
 
 #include <list>
 #include <mutex>  // NOLINT
+#include <string>
 #include <unordered_map>
+#include <vector>
 
+#include "buffer/buffer_pool_stats.h"
 #include "buffer/lru_replacer.h"
+#include "buffer/warmup_snapshot.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
 #include "storage/page/page.h"
@@ -69,6 +73,16 @@ class BufferPoolManager {
     return result;
   }
 
+  /**
+   * Creates a new page in a tablespace, see TablespaceDiskManager.
+   * @param[out] page_id id of created page
+   * @param tablespace_id the tablespace the page goes to
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto NewPage(page_id_t *page_id, tablespace_id_t tablespace_id) -> Page * {
+    return NewTablespacePgImp(page_id, tablespace_id);
+  }
+
   /** Grading function. Do not modify! */
   auto DeletePage(page_id_t page_id, bufferpool_callback_fn callback = nullptr) -> bool {
     GradingCallback(callback, CallbackType::BEFORE, page_id);
@@ -87,6 +101,101 @@ class BufferPoolManager {
   /** @return size of the buffer pool */
   virtual auto GetPoolSize() -> size_t = 0;
 
+  /**
+   * Fetches several pages at once. Like FetchPage for each of them, but an implementation can pin the resident pages
+   * without its latch and then serve all misses under a single latch acquisition and a single batched disk read.
+   * @param page_ids ids of the pages to fetch; duplicates are pinned once per occurrence
+   * @param num_pages number of pages to fetch
+   * @param[out] pages the pinned pages, in the order of page_ids; nullptr for a page that could not be fetched
+   * @return the number of pages that were fetched
+   */
+  virtual auto FetchPages(const page_id_t *page_ids, size_t num_pages, Page **pages) -> size_t {
+    size_t fetched = 0;
+    for (size_t i = 0; i < num_pages; i++) {
+      pages[i] = FetchPgImp(page_ids[i]);
+      fetched += pages[i] != nullptr ? 1 : 0;
+    }
+    return fetched;
+  }
+
+  /**
+   * Unpins several pages at once, see UnpinPage.
+   * @param page_ids ids of the pages to unpin
+   * @param num_pages number of pages to unpin
+   * @param is_dirty for each page, true if it was modified
+   * @return false if any of the unpins failed
+   */
+  virtual auto UnpinPages(const page_id_t *page_ids, size_t num_pages, const bool *is_dirty) -> bool {
+    bool unpinned = true;
+    for (size_t i = 0; i < num_pages; i++) {
+      unpinned = UnpinPgImp(page_ids[i], is_dirty[i]) && unpinned;
+    }
+    return unpinned;
+  }
+
+  /**
+   * Hints that a page will be fetched soon. If the page is not resident it is read in the background and left
+   * unpinned in the pool, so a later FetchPage is a hit. The default implementation ignores the hint.
+   * @param page_id id of the page to read ahead
+   */
+  virtual void Prefetch(page_id_t page_id) {}
+
+  /**
+   * Hints that the pages [first_page_id, first_page_id + num_pages) will be fetched soon, see Prefetch.
+   * @param first_page_id id of the first page to read ahead
+   * @param num_pages number of consecutive page ids to read ahead
+   */
+  virtual void PrefetchRange(page_id_t first_page_id, size_t num_pages) {
+    for (size_t i = 0; i < num_pages; i++) {
+      Prefetch(first_page_id + static_cast<page_id_t>(i));
+    }
+  }
+
+  /**
+   * Lists the pages that are resident in the pool, hottest first. The default implementation lists none.
+   * @param[out] page_ids the resident page ids are appended here
+   */
+  virtual void GetResidentPages(std::vector<page_id_t> *page_ids) {}
+
+  /**
+   * Starts loading pages into free frames in the background, to warm up a cold pool. The default implementation
+   * ignores the request.
+   * @param page_ids the pages to load, hottest first
+   */
+  virtual void WarmUp(const std::vector<page_id_t> &page_ids) {}
+
+  /**
+   * Collects the counters of the pool and a histogram of how often its resident pages were pinned. The default
+   * implementation reports nothing.
+   * @return a copy of the current statistics
+   */
+  virtual auto GetStats() -> BufferPoolStats { return {}; }
+
+  /**
+   * Writes the resident page ids to a warm-up snapshot file, see WarmupSnapshot.
+   * @param file_name the sidecar file
+   * @return false if the file could not be written
+   */
+  auto DumpWarmupSnapshot(const std::string &file_name) -> bool {
+    std::vector<page_id_t> page_ids;
+    GetResidentPages(&page_ids);
+    return WarmupSnapshot::Write(file_name, page_ids);
+  }
+
+  /**
+   * Starts warming up the pool from a snapshot written by DumpWarmupSnapshot, see WarmUp.
+   * @param file_name the sidecar file
+   * @return false if there is no usable snapshot
+   */
+  auto LoadWarmupSnapshot(const std::string &file_name) -> bool {
+    std::vector<page_id_t> page_ids;
+    if (!WarmupSnapshot::Read(file_name, &page_ids)) {
+      return false;
+    }
+    WarmUp(page_ids);
+    return true;
+  }
+
  protected:
   /**
    * Grading function. Do not modify!
@@ -130,6 +239,14 @@ class BufferPoolManager {
    */
   virtual auto NewPgImp(page_id_t *page_id) -> Page * = 0;
 
+  /**
+   * Creates a new page in the buffer pool, with a page id of the given tablespace.
+   * @param[out] page_id id of created page
+   * @param tablespace_id the tablespace of the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  virtual auto NewTablespacePgImp(page_id_t *page_id, tablespace_id_t tablespace_id) -> Page * = 0;
+
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
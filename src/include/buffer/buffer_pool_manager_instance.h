@@ -12,11 +12,20 @@
 
 #pragma once
 
+#include <array>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <deque>
 #include <list>
-#include <mutex>  // NOLINT
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
+#include <thread>        // NOLINT
 #include <unordered_map>
 
 #include "buffer/buffer_pool_manager.h"
+#include "buffer/clock_replacer.h"
+#include "buffer/frame_arena.h"
+#include "buffer/lru_k_replacer.h"
 #include "buffer/lru_replacer.h"
 #include "recovery/log_manager.h"
 #include "storage/disk/disk_manager.h"
@@ -26,6 +35,10 @@ namespace bustub {
 
 /**
  * BufferPoolManager reads disk pages to and from its internal buffer pool.
+ *
+ * If the disk manager has its file open read-only, the pool copies nothing: a frame's Page points into the disk
+ * manager's mapping of the file, and only the bookkeeping (pin count, latch, replacer state) lives in the pool. New
+ * and deleted pages are refused in that mode.
  */
 class BufferPoolManagerInstance : public BufferPoolManager {
  public:
@@ -34,8 +47,10 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param pool_size the size of the buffer pool
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_policy the replacement policy used to pick victim frames
    */
-  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr);
+  BufferPoolManagerInstance(size_t pool_size, DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerPolicy replacer_policy = ReplacerPolicy::LRU);
   /**
    * Creates a new BufferPoolManagerInstance.
    * @param pool_size the size of the buffer pool
@@ -43,9 +58,12 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    * @param instance_index index of this BPI in the parallel BPM
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_policy the replacement policy used to pick victim frames
+   * @param numa_node the NUMA node to allocate the frames on, or -1 for the default placement
    */
   BufferPoolManagerInstance(size_t pool_size, uint32_t num_instances, uint32_t instance_index,
-                            DiskManager *disk_manager, LogManager *log_manager = nullptr);
+                            DiskManager *disk_manager, LogManager *log_manager = nullptr,
+                            ReplacerPolicy replacer_policy = ReplacerPolicy::LRU, int numa_node = -1);
 
   /**
    * Destroys an existing BufferPoolManagerInstance.
@@ -55,10 +73,104 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override { return pool_size_; }
 
+  /**
+   * Changes the number of frames while the pool is in use. Growing adds free frames. Shrinking writes back and evicts
+   * the pages in the frames past new_size, and gives their memory back; it fails if one of them is pinned, before
+   * evicting any of them.
+   * @param new_size the new number of frames, between 1 and BUFFER_POOL_MAX_GROWTH times the initial pool size
+   * @return false if new_size is out of range or a page that has to be evicted is pinned
+   */
+  auto Resize(size_t new_size) -> bool;
+
   /** @return pointer to all the pages in the buffer pool */
   auto GetPages() -> Page * { return pages_; }
 
+  /**
+   * Writes every dirty page back in DiskManager::WritePages batches, sorted by page id, without syncing. FlushAllPages
+   * is this followed by DiskManager::Sync; a parallel pool writes all its instances first and then syncs once.
+   */
+  void WriteDirtyPages();
+
+  /**
+   * Starts the background page cleaner. Every interval, or sooner when an eviction had to write back a dirty victim,
+   * the cleaner writes back the dirty, unpinned pages among the clean_target coldest frames of the replacer. Misses
+   * then mostly find clean victims and do not pay for a disk write while holding the latch.
+   * @param clean_target how many of the coldest frames the cleaner tries to keep clean
+   * @param interval how long the cleaner sleeps between rounds
+   */
+  void StartPageCleaner(size_t clean_target, std::chrono::milliseconds interval);
+
+  /** Stops and joins the page cleaner thread, if it is running. */
+  void StopPageCleaner();
+
+  /** @return the number of evictions that found a clean victim */
+  auto GetCleanVictimCount() const -> uint64_t {
+    return counters_.Get(BufferPoolCounters::EVICTIONS) - counters_.Get(BufferPoolCounters::DIRTY_EVICTIONS);
+  }
+
+  /** @return the number of evictions that had to write back a dirty victim */
+  auto GetDirtyVictimCount() const -> uint64_t { return counters_.Get(BufferPoolCounters::DIRTY_EVICTIONS); }
+
+  /** @return the number of pages written back by the page cleaner */
+  auto GetCleanedPageCount() const -> uint64_t { return cleaned_pages_; }
+
+  /**
+   * Fetches several pages of this instance. Resident pages are pinned without the latch; the misses then share one
+   * latch acquisition, get their frames together, and are read with one DiskManager::ReadPages call.
+   * @param page_ids ids of the pages to fetch
+   * @param num_pages number of pages to fetch
+   * @param[out] pages the pinned pages, nullptr where no frame was available
+   * @return the number of pages that were fetched
+   */
+  auto FetchPages(const page_id_t *page_ids, size_t num_pages, Page **pages) -> size_t override;
+
+  /**
+   * Collects the counters of this instance. The counters are read without stopping the pool and the access histogram
+   * is built by walking the frames under the latch, so on a busy pool the two can be a few accesses apart.
+   * @return a copy of the current statistics
+   */
+  auto GetStats() -> BufferPoolStats override;
+
+  /**
+   * Queues page_id for the background reader, which starts on the first call. Pages that are resident, that do not
+   * exist yet, or that would overflow the queue are ignored.
+   * @param page_id id of the page to read ahead
+   */
+  void Prefetch(page_id_t page_id) override;
+
+  /** @return the number of pages the background reader brought into the pool */
+  auto GetPrefetchedPageCount() const -> uint64_t { return prefetched_pages_; }
+
+  /**
+   * Lists the resident pages of this instance: pinned pages first, then the replacer's frames from hottest to coldest.
+   * @param[out] page_ids the resident page ids are appended here
+   */
+  void GetResidentPages(std::vector<page_id_t> *page_ids) override;
+
+  /**
+   * Starts a warm-up thread, replacing any running one. It keeps the hottest pool-size pages of page_ids that belong
+   * to this instance, reads them in page id order so that the reads are sequential, and then replays the snapshot
+   * order into the replacer from coldest to hottest. Warm-up only fills free frames and never evicts, so it can run
+   * while the pool serves requests.
+   * @param page_ids the pages to load, hottest first
+   */
+  void WarmUp(const std::vector<page_id_t> &page_ids) override;
+
+  /** Blocks until the warm-up thread, if any, is done. */
+  void WaitForWarmUp();
+
+  /** @return the number of pages loaded by warm-up */
+  auto GetWarmedPageCount() const -> uint64_t { return warmed_pages_; }
+
  protected:
+  /**
+   * Creates the replacer for a replacement policy.
+   * @param replacer_policy the replacement policy
+   * @param pool_size the number of frames the replacer tracks
+   * @return a new replacer owned by the caller
+   */
+  static auto CreateReplacer(ReplacerPolicy replacer_policy, size_t pool_size) -> Replacer *;
+
   /**
    * Fetch the requested page from the buffer pool.
    * @param page_id id of page to be fetched
@@ -84,14 +196,25 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   /**
    * Creates a new page in the buffer pool.
    * @param[out] page_id id of created page
-   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   * @return nullptr if no new pages could be created or the file is read-only, otherwise pointer to new page
    */
   auto NewPgImp(page_id_t *page_id) -> Page * override;
 
+  /**
+   * Creates a new page in a tablespace of the disk manager.
+   * @param[out] page_id id of created page
+   * @param tablespace_id the tablespace of the page
+   * @return nullptr if no new pages could be created, the tablespace has run out of page ids or the file is read-only,
+   * otherwise pointer to new page
+   * @throws Exception if the disk manager has no such tablespace
+   */
+  auto NewTablespacePgImp(page_id_t *page_id, tablespace_id_t tablespace_id) -> Page * override;
+
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
-   * @return false if the page exists but could not be deleted, true if the page didn't exist or deletion succeeded
+   * @return false if the page exists but could not be deleted or the file is read-only, true if the page didn't exist
+   * or deletion succeeded
    */
   auto DeletePgImp(page_id_t page_id) -> bool override;
 
@@ -101,18 +224,20 @@ class BufferPoolManagerInstance : public BufferPoolManager {
   void FlushAllPgsImp() override;
 
   /**
-   * Allocate a page on disk.∂
-   * @return the id of the allocated page
+   * Allocate a page on disk. A page deallocated earlier is reused before the file is extended.
+   * @param tablespace_id the tablespace to allocate the page in
+   * @return the id of the allocated page, or INVALID_PAGE_ID if the tablespace has run out of page ids
    */
-  auto AllocatePage() -> page_id_t;
+  auto AllocatePage(tablespace_id_t tablespace_id) -> page_id_t;
 
   /**
-   * Deallocate a page on disk.
+   * Deallocate a page on disk, handing it to the disk manager's free page map.
    * @param page_id id of the page to deallocate
    */
-  void DeallocatePage(__attribute__((unused)) page_id_t page_id) {
-    // This is a no-nop right now without a more complex data structure to track deallocated pages
-  }
+  void DeallocatePage(page_id_t page_id);
+
+  /** @return false if the page was neither handed out by this instance nor written, so reading it would make it up */
+  auto MayExist(page_id_t page_id) -> bool;
 
   /**
    * Validate that the page_id being used is accessible to this BPI. This can be used in all of the functions to
@@ -121,30 +246,196 @@ class BufferPoolManagerInstance : public BufferPoolManager {
    */
   void ValidatePageId(page_id_t page_id) const;
 
-  auto ReplacePage(frame_id_t *frame_id);
+  /**
+   * Pick a frame for a new resident page, either from the free list or by evicting a victim from the replacer.
+   * A dirty victim is written back before its frame is handed out. Must be called with latch_ held.
+   * @param[out] frame_id the frame that is now free for use
+   * @return false if every frame is pinned
+   */
+  auto ReplacePage(frame_id_t *frame_id) -> bool;
+
+  /**
+   * Hit path of FetchPgImp. Looks the page up under its page table shard's read latch and pins it with a CAS, so
+   * concurrent hits never touch latch_. Only pinning an unpinned page takes the shard latch in exclusive mode, so that
+   * the pin and the replacer update are atomic with respect to the last unpin.
+   * @param page_id id of the page to pin
+   * @param touch false to pin for a write-back: the access is not counted and the frame keeps its replacer position
+   * @return the pinned page, or nullptr if the page is not resident
+   */
+  auto PinResidentPage(page_id_t page_id, bool touch = true) -> Page *;
 
-  /** Number of pages in the buffer pool. */
-  const size_t pool_size_;
+  /**
+   * Writes a pinned page back if it is dirty. The page is copied under its read latch, with the dirty flag cleared
+   * first so that a concurrent modification marks it dirty again, and the copy is written without any latch held.
+   * @param page_id id of the page
+   * @param page the page, pinned by the caller until this returns
+   * @return true if the page was dirty and has been written
+   */
+  auto WriteBackPage(page_id_t page_id, Page *page) -> bool;
+
+  /**
+   * Claims a pinned page for writing it back, waiting while another write of it is in flight. FlushPage, the page
+   * cleaner and WriteDirtyPages all claim a page before they copy it, so an older copy can never reach the disk after a
+   * newer one and leave a clean frame with stale bytes on disk. Evictions need no claim: they only write frames that
+   * are unpinned and out of the page table.
+   * @param page the page to claim
+   */
+  void BeginWriteBack(Page *page);
+
+  /** Releases a page claimed with BeginWriteBack, after its copy is written. */
+  void EndWriteBack(Page *page);
+
+  /** Body of the page cleaner thread. */
+  void RunPageCleaner();
+
+  /**
+   * One page cleaner round: writes back the dirty, unpinned pages among the clean_target_ coldest frames. Each page is
+   * pinned without telling the replacer, so its position is kept, and written with WriteBackPage.
+   * @return the number of pages written back
+   */
+  auto CleanColdFrames() -> size_t;
+
+  /** Body of the background reader thread; drains prefetch_queue_. */
+  void RunPrefetcher();
+
+  /** Loads the pages of a warm-up, see WarmUp. */
+  void RunWarmUp(std::vector<page_id_t> page_ids);
+
+  /** Asks the warm-up thread to stop and joins it. */
+  void StopWarmUp();
+
+  /**
+   * Reads a page into a free or victim frame and leaves it unpinned in the replacer.
+   * @param page_id id of the page to load
+   * @param free_frame_only if true, only use a free frame and never evict
+   * @return true if the page was read, false if it was resident already or there was no frame for it
+   */
+  auto LoadPage(page_id_t page_id, bool free_frame_only = false) -> bool;
+
+  /**
+   * Points the frame at the page in the disk manager's mapping of a read-only file, so that the page is never copied.
+   * Otherwise points the frame back at its own memory, which the caller has to read the page into.
+   * @return true if the frame now maps the page
+   */
+  auto MapFrame(frame_id_t frame_id, page_id_t page_id) -> bool;
+
+  /**
+   * Reads a page into a frame that was just taken from the free list or the replacer, or maps it, and verifies its
+   * checksum. If the page is corrupt, the frame goes back to the free list before the exception propagates.
+   * Must hold latch_.
+   * @throws Exception of type CORRUPTION if the page does not match its checksum
+   */
+  void ReadFrame(frame_id_t frame_id, page_id_t page_id);
+
+  /**
+   * Evicts a page id that was just allocated for reuse but is still resident, without writing it back. Must hold
+   * latch_.
+   * @return false if the page is pinned, so the id can't be used yet
+   */
+  auto DropStalePage(page_id_t page_id) -> bool;
+
+  /** Puts a claimed frame that did not get a page back on the free list. Must hold latch_. */
+  void ReleaseFrame(frame_id_t frame_id);
+
+  /** Stops and joins the background reader thread, if it is running. */
+  void StopPrefetcher();
+
+  /**
+   * Frees a frame for Resize, writing its page back if it is dirty. The page must be unpinned and already out of the
+   * page table. Must hold latch_.
+   */
+  void EvictFrame(frame_id_t frame_id);
+
+  /**
+   * Takes latch_. An uncontended acquire costs a try_lock; only a thread that has to wait reads the clock, and it
+   * adds the time it waited to the latch wait counters.
+   * @return the held latch
+   */
+  auto AcquireLatch() -> std::unique_lock<std::mutex>;
+
+  /** @return true if page_id currently has a frame */
+  auto IsResident(page_id_t page_id) -> bool;
+
+  /** Number of shards the page table is split into. */
+  static constexpr size_t PAGE_TABLE_SHARDS = 64;
+  /** Most pages WriteDirtyPages copies before writing them as one batch. */
+  static constexpr size_t WRITE_BACK_BATCH_PAGES = 64;
+
+  /** A copy of a page being written back, aligned like a frame so that an O_DIRECT disk manager can write it. */
+  struct alignas(DIRECT_IO_ALIGNMENT) PageBuffer {
+    char data_[PAGE_SIZE];
+  };
+
+  /**
+   * A slice of the page table. Hits only take the shard latch in shared mode; installing or removing a mapping takes
+   * it in exclusive mode, which is also what makes "pin_count_ == 0" a stable eviction check.
+   */
+  struct alignas(64) PageTableShard {
+    std::shared_mutex latch_;
+    std::unordered_map<page_id_t, frame_id_t> map_;
+  };
+
+  /** @return the page table shard responsible for page_id */
+  inline auto ShardOf(page_id_t page_id) -> PageTableShard & {
+    return page_table_[static_cast<uint32_t>(page_id) / num_instances_ % PAGE_TABLE_SHARDS];
+  }
+
+  /** Number of pages in the buffer pool. Frames [0, pool_size_) are in use; it only changes under latch_. */
+  std::atomic<size_t> pool_size_;
   /** How many instances are in the parallel BPM (if present, otherwise just 1 BPI) */
   const uint32_t num_instances_ = 1;
   /** Index of this BPI in the parallel BPM (if present, otherwise just 0) */
   const uint32_t instance_index_ = 0;
-  /** Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_ */
-  std::atomic<page_id_t> next_page_id_ = instance_index_;
+  /**
+   * Each BPI maintains its own counter for page_ids to hand out, must ensure they mod back to its instance_index_.
+   * There is one counter per tablespace, starting at the tablespace's first page id that does.
+   */
+  std::array<std::atomic<page_id_t>, MAX_TABLESPACES> next_page_ids_;
 
-  /** Array of buffer pool pages. */
+  /** Memory of the frames: page data in a huge-page arena, Page bookkeeping in a separate array. */
+  FrameArena frame_arena_;
+  /** Array of buffer pool pages, owned by frame_arena_. */
   Page *pages_;
   /** Pointer to the disk manager. */
   DiskManager *disk_manager_ __attribute__((__unused__));
   /** Pointer to the log manager. */
   LogManager *log_manager_ __attribute__((__unused__));
-  /** Page table for keeping track of buffer pool pages. */
-  std::unordered_map<page_id_t, frame_id_t> page_table_;
+  /** Page table for keeping track of buffer pool pages, sharded by page id. */
+  std::array<PageTableShard, PAGE_TABLE_SHARDS> page_table_;
   /** Replacer to find unpinned pages for replacement. */
   Replacer *replacer_;
   /** List of free pages. */
   std::list<frame_id_t> free_list_;
-  /** This latch protects shared data structures. We recommend updating this comment to describe what it protects. */
+  /**
+   * This latch serializes everything that changes which page lives in which frame: misses, evictions, new pages and
+   * deletes. It protects free_list_. Hits, unpins and flushes of resident pages do not take it.
+   */
   std::mutex latch_;
+  /** Hit, miss, eviction, flush and latch wait counters, sharded by thread, see GetStats. */
+  BufferPoolCounters counters_;
+
+  /** The page cleaner thread, see StartPageCleaner. */
+  std::thread cleaner_thread_;
+  /** Protects cleaner_running_ and lets the cleaner sleep on cleaner_cv_. */
+  std::mutex cleaner_latch_;
+  std::condition_variable cleaner_cv_;
+  bool cleaner_running_{false};
+  size_t clean_target_{0};
+  std::chrono::milliseconds cleaner_interval_{0};
+  std::atomic<uint64_t> cleaned_pages_{0};
+
+  /** The background reader thread, see Prefetch. */
+  std::thread prefetch_thread_;
+  /** Protects prefetch_queue_ and prefetch_running_. */
+  std::mutex prefetch_latch_;
+  std::condition_variable prefetch_cv_;
+  std::deque<page_id_t> prefetch_queue_;
+  bool prefetch_running_{false};
+  std::atomic<uint64_t> prefetched_pages_{0};
+
+  /** The warm-up thread, see WarmUp. */
+  std::thread warmup_thread_;
+  std::atomic<bool> warmup_running_{false};
+  std::atomic<uint64_t> warmed_pages_{0};
 };
 }  // namespace bustub
@@ -0,0 +1,138 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// buffer_pool_stats.h
+//
+// Identification: src/include/buffer/buffer_pool_stats.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+
+#include "common/config.h"
+
+namespace bustub {
+
+class BufferPoolManager;
+
+/** A point-in-time copy of the counters of a buffer pool. */
+struct BufferPoolStats {
+  /** Number of buckets in access_histogram_. */
+  static constexpr size_t HISTOGRAM_BUCKETS = 16;
+
+  /** Fetches served from a resident page. */
+  uint64_t hits_{0};
+  /** Fetches that read the page from disk. */
+  uint64_t misses_{0};
+  /** Pages evicted to make room, clean or dirty. */
+  uint64_t evictions_{0};
+  /** Evictions that had to write the victim back first. */
+  uint64_t dirty_evictions_{0};
+  /** Pages written back by FlushPage, FlushAllPages or the page cleaner. */
+  uint64_t flushes_{0};
+  /** Fetches that missed, waited for the pool latch, and then found the page brought in by another thread. */
+  uint64_t pin_waits_{0};
+  /** Times the pool latch was contended, and the total time spent waiting for it. */
+  uint64_t latch_waits_{0};
+  uint64_t latch_wait_ns_{0};
+  /**
+   * Resident pages by the number of times they were pinned since they were read in: bucket 0 counts pages that were
+   * never pinned, bucket i pages pinned [2^(i-1), 2^i) times, and the last bucket everything above.
+   */
+  std::array<uint64_t, HISTOGRAM_BUCKETS> access_histogram_{};
+
+  /** @return hits / (hits + misses), or 0 without any fetch */
+  auto HitRatio() const -> double;
+
+  /** @return the histogram bucket for a page pinned access_count times */
+  static auto HistogramBucket(uint32_t access_count) -> size_t;
+
+  /** Adds the counters of another pool, e.g. to sum up the instances of a parallel pool. */
+  auto operator+=(const BufferPoolStats &other) -> BufferPoolStats &;
+
+  /** @return a one-line human readable summary */
+  auto ToString() const -> std::string;
+};
+
+/**
+ * BufferPoolCounters are the live counters behind BufferPoolStats. They are sharded by thread: each thread adds to the
+ * cache line of its own shard with relaxed atomics, so counting a hit does not write a line that other threads write
+ * too. Reading sums the shards.
+ */
+class BufferPoolCounters {
+ public:
+  enum Counter {
+    HITS,
+    MISSES,
+    EVICTIONS,
+    DIRTY_EVICTIONS,
+    FLUSHES,
+    PIN_WAITS,
+    LATCH_WAITS,
+    LATCH_WAIT_NS,
+    NUM_COUNTERS
+  };
+
+  /** Adds n to a counter. */
+  inline void Add(Counter counter, uint64_t n = 1) {
+    shards_[ThreadShard()].counters_[counter].fetch_add(n, std::memory_order_relaxed);
+  }
+
+  /** @return the current value of a counter */
+  auto Get(Counter counter) const -> uint64_t;
+
+  /** Copies every counter into stats; the histogram is left alone. */
+  void Fill(BufferPoolStats *stats) const;
+
+ private:
+  static constexpr size_t NUM_SHARDS = 32;
+
+  struct alignas(64) Shard {
+    std::array<std::atomic<uint64_t>, NUM_COUNTERS> counters_{};
+  };
+
+  /** @return the shard of the calling thread, assigned round-robin on its first call */
+  static auto ThreadShard() -> size_t;
+
+  std::array<Shard, NUM_SHARDS> shards_;
+};
+
+/**
+ * BufferPoolStatsDumper logs the statistics of a buffer pool at a fixed interval from a background thread, until it
+ * is destroyed.
+ */
+class BufferPoolStatsDumper {
+ public:
+  /**
+   * Starts dumping.
+   * @param buffer_pool_manager the pool to report on, which must outlive the dumper
+   * @param interval time between two dumps
+   */
+  BufferPoolStatsDumper(BufferPoolManager *buffer_pool_manager, std::chrono::milliseconds interval);
+
+  /** Stops and joins the dump thread. */
+  ~BufferPoolStatsDumper();
+
+ private:
+  void Run();
+
+  BufferPoolManager *buffer_pool_manager_;
+  std::chrono::milliseconds interval_;
+  std::thread thread_;
+  std::mutex latch_;
+  std::condition_variable cv_;
+  bool running_{true};
+};
+
+}  // namespace bustub
@@ -12,8 +12,7 @@
 
 #pragma once
 
-#include <list>
-#include <mutex>  // NOLINT
+#include <atomic>
 #include <vector>
 
 #include "buffer/replacer.h"
@@ -23,6 +22,10 @@ namespace bustub {
 
 /**
  * ClockReplacer implements the clock replacement policy, which approximates the Least Recently Used policy.
+ *
+ * Every frame has one byte of state in a fixed array: not in the replacer, in the replacer with its reference bit set,
+ * or in the replacer with the bit cleared. Pin and Unpin are a single atomic operation on that byte, and Victim sweeps
+ * the array with an atomic clock hand, so no call takes a latch or allocates.
  */
 class ClockReplacer : public Replacer {
  public:
@@ -45,8 +48,21 @@ class ClockReplacer : public Replacer {
 
   auto Size() -> size_t override;
 
+  void PeekVictims(size_t max_frames, std::vector<frame_id_t> *frame_ids) override;
+
  private:
-  // TODO(student): implement me!
+  /** Frame is pinned or was never unpinned. */
+  static constexpr uint8_t ABSENT = 0;
+  /** Frame is evictable and was referenced since the hand last passed it. */
+  static constexpr uint8_t REFERENCED = 1;
+  /** Frame is evictable and the hand cleared its reference bit. */
+  static constexpr uint8_t UNREFERENCED = 2;
+
+  size_t num_pages_;
+  std::vector<std::atomic<uint8_t>> frames_;
+  /** Next frame to look at, modulo num_pages_. */
+  std::atomic<size_t> hand_{0};
+  std::atomic<size_t> size_{0};
 };
 
 }  // namespace bustub
@@ -0,0 +1,101 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena.h
+//
+// Identification: src/include/buffer/frame_arena.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "common/config.h"
+#include "storage/page/page.h"
+
+namespace bustub {
+
+/**
+ * FrameArena owns the memory of a buffer pool: the page data of every frame, and the Page objects holding their
+ * bookkeeping (page id, pin count, dirty flag, latch).
+ *
+ * The page data is one anonymous mapping aligned to and sized in 2 MiB huge pages. Explicit huge pages (MAP_HUGETLB)
+ * are used when the system has them reserved; otherwise the mapping asks for transparent huge pages. The Page objects
+ * live in a separate array, so the data of neighbouring frames is contiguous and the bookkeeping stays compact.
+ *
+ * If a NUMA node is given, the data is bound to that node with mbind(2) before it is first touched. When mbind is not
+ * available the memory falls back to the default first-touch placement.
+ *
+ * The address range is reserved for up to capacity frames, so the pool can grow in place and existing Page pointers
+ * stay valid. Memory of frames that are not in use is not committed until they are touched.
+ *
+ * Every frame starts at a multiple of PAGE_SIZE from a huge page boundary, so frames can be handed to O_DIRECT I/O.
+ */
+class FrameArena {
+ public:
+  /** Size and alignment of the data mapping. */
+  static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+  static_assert(PAGE_SIZE % DIRECT_IO_ALIGNMENT == 0 && HUGE_PAGE_SIZE % DIRECT_IO_ALIGNMENT == 0,
+                "frames must be aligned for O_DIRECT");
+
+  /**
+   * Maps the memory for a buffer pool.
+   * @param num_frames the number of frames
+   * @param numa_node the NUMA node to place the frame data on, or -1 for the default policy
+   * @param capacity the number of frames the arena can grow to, at least num_frames
+   */
+  explicit FrameArena(size_t num_frames, int numa_node = -1, size_t capacity = 0);
+
+  ~FrameArena();
+
+  FrameArena(const FrameArena &) = delete;
+  auto operator=(const FrameArena &) -> FrameArena & = delete;
+
+  /** @return the array of Page objects; frame i holds its data at GetData() + i * PAGE_SIZE */
+  inline auto GetPages() -> Page * { return pages_; }
+
+  /** @return the number of frames the arena can hold */
+  inline auto GetCapacity() -> size_t { return capacity_; }
+
+  /**
+   * Makes the first num_frames frames usable. Frames that were released before keep their Page object.
+   * @param num_frames the new number of frames, at most the capacity
+   */
+  void Grow(size_t num_frames);
+
+  /**
+   * Returns the memory of frames [first_frame, last_frame) to the operating system, where the kernel allows it. The
+   * frames stay valid, but their data is undefined when they are used again.
+   */
+  void Release(size_t first_frame, size_t last_frame);
+
+  /** @return the start of the frame data */
+  inline auto GetData() -> char * { return data_; }
+
+  /** @return true if the frame data is backed by explicitly reserved huge pages */
+  inline auto IsHugeTlb() -> bool { return huge_tlb_; }
+
+  /** @return true if the frame data was bound to the requested NUMA node */
+  inline auto IsNumaBound() -> bool { return numa_bound_; }
+
+ private:
+  /** Maps mapping_size_ bytes aligned to HUGE_PAGE_SIZE and sets data_. */
+  void MapData();
+
+  /** Binds the data mapping to numa_node. */
+  void BindToNode(int numa_node);
+
+  size_t capacity_;
+  /** Number of Page objects constructed so far. */
+  size_t num_constructed_{0};
+  /** Bytes of frame data for capacity_ frames, rounded up to HUGE_PAGE_SIZE. */
+  size_t mapping_size_;
+  char *data_{nullptr};
+  Page *pages_{nullptr};
+  bool huge_tlb_{false};
+  bool numa_bound_{false};
+};
+
+}  // namespace bustub
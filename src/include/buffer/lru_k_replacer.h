@@ -0,0 +1,93 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer.h
+//
+// Identification: src/include/buffer/lru_k_replacer.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <deque>
+#include <mutex>  // NOLINT
+#include <set>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "buffer/replacer.h"
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * LRUKReplacer implements the LRU-K replacement policy.
+ *
+ * The victim is the evictable frame whose K-th most recent access is furthest in the past (the largest backward
+ * K-distance). Frames with fewer than K accesses have an infinite backward K-distance and are evicted first, oldest
+ * first. A page touched once by a sequential scan therefore leaves before pages that are accessed repeatedly.
+ *
+ * Pin counts as an access. The buffer pool only pins a frame when its pin count goes from 0 to 1, so references made
+ * while a page stays pinned are one access. Accesses that come within correlated_period ticks of the frame's previous
+ * access (e.g. a scan fetching the same page once per tuple) are also folded into one access, which only moves its
+ * timestamp forward. A tick is one access to any frame.
+ */
+class LRUKReplacer : public Replacer {
+ public:
+  /**
+   * Create a new LRUKReplacer.
+   * @param num_pages the maximum number of pages the LRUKReplacer will be required to store
+   * @param k the number of most recent accesses to remember per frame
+   * @param correlated_period accesses at most this many ticks after the previous one count as the same access
+   */
+  LRUKReplacer(size_t num_pages, size_t k, uint64_t correlated_period = 0);
+
+  /**
+   * Destroys the LRUKReplacer.
+   */
+  ~LRUKReplacer() override;
+
+  auto Victim(frame_id_t *frame_id) -> bool override;
+
+  void Pin(frame_id_t frame_id) override;
+
+  void Unpin(frame_id_t frame_id) override;
+
+  auto Size() -> size_t override;
+
+  void PeekVictims(size_t max_frames, std::vector<frame_id_t> *frame_ids) override;
+
+ private:
+  /** Access history of one frame. */
+  struct FrameHistory {
+    /** Timestamps of the last (up to) K accesses, oldest first. */
+    std::deque<uint64_t> accesses_;
+    bool evictable_{false};
+  };
+
+  /** @return the key the frame is ordered by in history_ or cache_ */
+  auto EvictionKey(const FrameHistory &history, frame_id_t frame_id) const -> std::pair<uint64_t, frame_id_t>;
+
+  /** Adds an evictable frame to history_ or cache_. */
+  void InsertEvictable(const FrameHistory &history, frame_id_t frame_id);
+
+  /** Removes an evictable frame from history_ or cache_. */
+  void EraseEvictable(const FrameHistory &history, frame_id_t frame_id);
+
+  std::mutex latch_;
+  size_t k_;
+  uint64_t correlated_period_;
+  /** Logical clock, advanced on every access. */
+  uint64_t current_timestamp_{0};
+  std::unordered_map<frame_id_t, FrameHistory> frames_;
+  /** Evictable frames with fewer than k_ accesses, by oldest access. */
+  std::set<std::pair<uint64_t, frame_id_t>> history_;
+  /** Evictable frames with k_ accesses, by K-th most recent access. */
+  std::set<std::pair<uint64_t, frame_id_t>> cache_;
+};
+
+}  // namespace bustub
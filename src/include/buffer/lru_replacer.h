@@ -45,6 +45,8 @@ class LRUReplacer : public Replacer {
 
   auto Size() -> size_t override;
 
+  void PeekVictims(size_t max_frames, std::vector<frame_id_t> *frame_ids) override;
+
  private:
   // TODO(student): implement me!
   std::mutex latch_;
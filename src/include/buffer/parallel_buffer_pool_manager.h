@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <vector>
+
 #include "buffer/buffer_pool_manager.h"
 #include "buffer/buffer_pool_manager_instance.h"
 #include "recovery/log_manager.h"
@@ -28,9 +30,12 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    * @param pool_size the pool size of each BufferPoolManagerInstance
    * @param disk_manager the disk manager
    * @param log_manager the log manager (for testing only: nullptr = disable logging)
+   * @param replacer_policy the replacement policy of every BufferPoolManagerInstance
+   * @param numa_nodes NUMA node of each instance's frames, assigned round-robin; empty for the default placement
    */
   ParallelBufferPoolManager(size_t num_instances, size_t pool_size, DiskManager *disk_manager,
-                            LogManager *log_manager = nullptr);
+                            LogManager *log_manager = nullptr, ReplacerPolicy replacer_policy = ReplacerPolicy::LRU,
+                            const std::vector<int> &numa_nodes = {});
 
   /**
    * Destroys an existing ParallelBufferPoolManager.
@@ -40,6 +45,55 @@ class ParallelBufferPoolManager : public BufferPoolManager {
   /** @return size of the buffer pool */
   auto GetPoolSize() -> size_t override;
 
+  /**
+   * Resizes every BufferPoolManagerInstance to pool_size frames, see BufferPoolManagerInstance::Resize. The number of
+   * instances is fixed: every page id is owned by instance page_id % num_instances, on disk as well as in memory.
+   * @param pool_size the new pool size of each instance
+   * @return false if some instance could not be resized; every instance then keeps its old size
+   */
+  auto Resize(size_t pool_size) -> bool;
+
+  /**
+   * Fetches several pages, grouped by the instance that owns them so that each instance serves its share in one
+   * batch, see BufferPoolManagerInstance::FetchPages.
+   * @param page_ids ids of the pages to fetch
+   * @param num_pages number of pages to fetch
+   * @param[out] pages the pinned pages, in the order of page_ids
+   * @return the number of pages that were fetched
+   */
+  auto FetchPages(const page_id_t *page_ids, size_t num_pages, Page **pages) -> size_t override;
+
+  /** @return the statistics of all instances added up */
+  auto GetStats() -> BufferPoolStats override;
+
+  /**
+   * Lists the resident pages of all instances, hottest first, taking one page from each instance in turn.
+   * @param[out] page_ids the resident page ids are appended here
+   */
+  void GetResidentPages(std::vector<page_id_t> *page_ids) override;
+
+  /**
+   * Starts a warm-up on every instance, each with the pages it owns, see BufferPoolManagerInstance::WarmUp.
+   * @param page_ids the pages to load, hottest first
+   */
+  void WarmUp(const std::vector<page_id_t> &page_ids) override;
+
+  /** Blocks until every instance is done warming up. */
+  void WaitForWarmUp();
+
+  /**
+   * Starts a page cleaner on every BufferPoolManagerInstance, see BufferPoolManagerInstance::StartPageCleaner.
+   * @param clean_target how many of the coldest frames of each instance the cleaner tries to keep clean
+   * @param interval how long the cleaners sleep between rounds
+   */
+  void StartPageCleaner(size_t clean_target, std::chrono::milliseconds interval);
+
+  /** Stops the page cleaners of all instances. */
+  void StopPageCleaner();
+
+  /** Forwards the read-ahead hint to the instance responsible for page_id. */
+  void Prefetch(page_id_t page_id) override;
+
  protected:
   /**
    * @param page_id id of page
@@ -76,6 +130,14 @@ class ParallelBufferPoolManager : public BufferPoolManager {
    */
   auto NewPgImp(page_id_t *page_id) -> Page * override;
 
+  /**
+   * Creates a new page in a tablespace, in one of the instances, round robin like NewPgImp.
+   * @param[out] page_id id of created page
+   * @param tablespace_id the tablespace of the page
+   * @return nullptr if no new pages could be created, otherwise pointer to new page
+   */
+  auto NewTablespacePgImp(page_id_t *page_id, tablespace_id_t tablespace_id) -> Page * override;
+
   /**
    * Deletes a page from the buffer pool.
    * @param page_id id of page to be deleted
@@ -90,7 +152,8 @@ class ParallelBufferPoolManager : public BufferPoolManager {
 
   size_t num_instances_;
   size_t pool_size_;
-  BufferPoolManager **instances_;
+  BufferPoolManagerInstance **instances_;
+  DiskManager *disk_manager_;
   uint32_t starting_index_;
   std::mutex latch_;
 };
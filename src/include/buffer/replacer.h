@@ -12,10 +12,22 @@
 
 #pragma once
 
+#include <vector>
+
 #include "common/config.h"
 
 namespace bustub {
 
+/** Replacement policies a buffer pool instance can be created with. */
+enum class ReplacerPolicy {
+  /** Least recently unpinned frame first (LRUReplacer). */
+  LRU,
+  /** Largest backward K-distance first (LRUKReplacer), so one-off scans do not flush the hot set. */
+  LRU_K,
+  /** Clock sweep over reference bits (ClockReplacer), latch-free and allocation-free. */
+  CLOCK,
+};
+
 /**
  * Replacer is an abstract class that tracks page usage.
  */
@@ -45,6 +57,15 @@ class Replacer {
 
   /** @return the number of elements in the replacer that can be victimized */
   virtual auto Size() -> size_t = 0;
+
+  /**
+   * Lists the frames that Victim would pick next, coldest first, without removing them. Used by the page cleaner to
+   * find dirty frames worth writing back before they are evicted. Replacers that cannot predict their victims leave
+   * the list empty.
+   * @param max_frames the maximum number of frames to list
+   * @param[out] frame_ids the frames, coldest first
+   */
+  virtual void PeekVictims(size_t max_frames, std::vector<frame_id_t> *frame_ids) {}
 };
 
 }  // namespace bustub
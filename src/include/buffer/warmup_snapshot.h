@@ -0,0 +1,53 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// warmup_snapshot.h
+//
+// Identification: src/include/buffer/warmup_snapshot.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * WarmupSnapshot reads and writes the sidecar file that lists the pages resident in a buffer pool, so that a restarted
+ * pool can load them again before traffic asks for them.
+ *
+ * Format, native byte order:
+ * | Magic (4) | PageCount (8) | PageId1 (4) | PageId2 (4) | ... |
+ *
+ * Page ids are stored hottest first, in the order of the replacer.
+ */
+class WarmupSnapshot {
+ public:
+  /**
+   * Writes a snapshot. The file is written under a temporary name and renamed, so a crash never leaves a torn file.
+   * @param file_name the sidecar file
+   * @param page_ids the resident page ids, hottest first
+   * @return false if the file could not be written
+   */
+  static auto Write(const std::string &file_name, const std::vector<page_id_t> &page_ids) -> bool;
+
+  /**
+   * Reads a snapshot.
+   * @param file_name the sidecar file
+   * @param[out] page_ids the page ids, hottest first
+   * @return false if the file does not exist or is not a snapshot
+   */
+  static auto Read(const std::string &file_name, std::vector<page_id_t> *page_ids) -> bool;
+
+ private:
+  static constexpr uint32_t MAGIC = 0x55575442;  // "BTWU"
+};
+
+}  // namespace bustub
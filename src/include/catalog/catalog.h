@@ -44,9 +44,15 @@ struct TableInfo {
    * @param name The table name
    * @param table An owning pointer to the table heap
    * @param oid The unique OID for the table
+   * @param tablespace_id The tablespace the table's pages live in
    */
-  TableInfo(Schema schema, std::string name, std::unique_ptr<TableHeap> &&table, table_oid_t oid)
-      : schema_{std::move(schema)}, name_{std::move(name)}, table_{std::move(table)}, oid_{oid} {}
+  TableInfo(Schema schema, std::string name, std::unique_ptr<TableHeap> &&table, table_oid_t oid,
+            tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID)
+      : schema_{std::move(schema)},
+        name_{std::move(name)},
+        table_{std::move(table)},
+        oid_{oid},
+        tablespace_id_{tablespace_id} {}
   /** The table schema */
   Schema schema_;
   /** The table name */
@@ -55,6 +61,8 @@ struct TableInfo {
   std::unique_ptr<TableHeap> table_;
   /** The table OID */
   const table_oid_t oid_;
+  /** The tablespace the table's pages live in */
+  const tablespace_id_t tablespace_id_;
 };
 
 /**
@@ -69,15 +77,17 @@ struct IndexInfo {
    * @param index_oid The unique OID for the index
    * @param table_name The name of the table on which the index is created
    * @param key_size The size of the index key, in bytes
+   * @param tablespace_id The tablespace the index's pages live in
    */
   IndexInfo(Schema key_schema, std::string name, std::unique_ptr<Index> &&index, index_oid_t index_oid,
-            std::string table_name, size_t key_size)
+            std::string table_name, size_t key_size, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID)
       : key_schema_{std::move(key_schema)},
         name_{std::move(name)},
         index_{std::move(index)},
         index_oid_{index_oid},
         table_name_{std::move(table_name)},
-        key_size_{key_size} {}
+        key_size_{key_size},
+        tablespace_id_{tablespace_id} {}
   /** The schema for the index key */
   Schema key_schema_;
   /** The name of the index */
@@ -90,6 +100,8 @@ struct IndexInfo {
   std::string table_name_;
   /** The size of the index key, in bytes */
   const size_t key_size_;
+  /** The tablespace the index's pages live in */
+  const tablespace_id_t tablespace_id_;
 };
 
 /**
@@ -119,21 +131,23 @@ class Catalog {
    * @param txn The transaction in which the table is being created
    * @param table_name The name of the new table
    * @param schema The schema of the new table
+   * @param tablespace_id The tablespace to put the table in, which the disk manager must have
    * @return A (non-owning) pointer to the metadata for the table
    */
-  auto CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema) -> TableInfo * {
+  auto CreateTable(Transaction *txn, const std::string &table_name, const Schema &schema,
+                   tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID) -> TableInfo * {
     if (table_names_.count(table_name) != 0) {
       return NULL_TABLE_INFO;
     }
 
     // Construct the table heap
-    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn);
+    auto table = std::make_unique<TableHeap>(bpm_, lock_manager_, log_manager_, txn, tablespace_id);
 
     // Fetch the table OID for the new table
     const auto table_oid = next_table_oid_.fetch_add(1);
 
     // Construct the table information
-    auto meta = std::make_unique<TableInfo>(schema, table_name, std::move(table), table_oid);
+    auto meta = std::make_unique<TableInfo>(schema, table_name, std::move(table), table_oid, tablespace_id);
     auto *tmp = meta.get();
 
     // Update the internal tracking mechanisms
@@ -186,12 +200,14 @@ class Catalog {
    * @param key_attrs Key attributes
    * @param keysize Size of the key
    * @param hash_function The hash function for the index
+   * @param tablespace_id The tablespace to put the index in, which the disk manager must have
    * @return A (non-owning) pointer to the metadata of the new table
    */
   template <class KeyType, class ValueType, class KeyComparator>
   auto CreateIndex(Transaction *txn, const std::string &index_name, const std::string &table_name, const Schema &schema,
                    const Schema &key_schema, const std::vector<uint32_t> &key_attrs, std::size_t keysize,
-                   HashFunction<KeyType> hash_function) -> IndexInfo * {
+                   HashFunction<KeyType> hash_function, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID)
+      -> IndexInfo * {
     // Reject the creation request for nonexistent table
     if (table_names_.find(table_name) == table_names_.end()) {
       return NULL_INDEX_INFO;
@@ -214,22 +230,19 @@ class Catalog {
     // TODO(Kyle): We should update the API for CreateIndex
     // to allow specification of the index type itself, not
     // just the key, value, and comparator types
-    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(std::move(meta), bpm_,
-                                                                                               hash_function);
+    auto index = std::make_unique<ExtendibleHashTableIndex<KeyType, ValueType, KeyComparator>>(
+        std::move(meta), bpm_, hash_function, tablespace_id);
 
-    // Populate the index with all tuples in table heap
+    // Populate the index with all tuples in table heap before the catalog hands it out
     auto *table_meta = GetTable(table_name);
-    auto *heap = table_meta->table_.get();
-    for (auto tuple = heap->Begin(txn); tuple != heap->End(); ++tuple) {
-      index->InsertEntry(tuple->KeyFromTuple(schema, key_schema, key_attrs), tuple->GetRid(), txn);
-    }
+    index->BulkBuild(table_meta->table_.get(), schema, txn);
 
     // Get the next OID for the new index
     const auto index_oid = next_index_oid_.fetch_add(1);
 
     // Construct index information; IndexInfo takes ownership of the Index itself
-    auto index_info =
-        std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name, keysize);
+    auto index_info = std::make_unique<IndexInfo>(key_schema, index_name, std::move(index), index_oid, table_name,
+                                                  keysize, tablespace_id);
     auto *tmp = index_info.get();
 
     // Update internal tracking
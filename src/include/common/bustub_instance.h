@@ -23,17 +23,26 @@ namespace bustub {
 
 class BustubInstance {
  public:
-  explicit BustubInstance(const std::string &db_file_name) {
+  /**
+   * @param db_file_name the database file
+   * @param read_only open an existing database for reading only. The buffer pool then hands out pages that point into
+   * a memory mapping of the file instead of copying them, and nothing is written back, not even the warm-up snapshot.
+   */
+  explicit BustubInstance(const std::string &db_file_name, bool read_only = false) : read_only_(read_only) {
     enable_logging = false;
 
     // storage related
-    disk_manager_ = new DiskManager(db_file_name);
+    disk_manager_ = new DiskManager(db_file_name, read_only);
 
     // log related
     log_manager_ = new LogManager(disk_manager_);
 
     buffer_pool_manager_ = new BufferPoolManagerInstance(BUFFER_POOL_SIZE, disk_manager_, log_manager_);
 
+    // reload the pages that were resident at the last shutdown, in the background
+    warmup_file_name_ = db_file_name.substr(0, db_file_name.rfind('.')) + ".warm";
+    buffer_pool_manager_->LoadWarmupSnapshot(warmup_file_name_);
+
     // txn related
     lock_manager_ = new LockManager();
     transaction_manager_ = new TransactionManager(lock_manager_, log_manager_);
@@ -48,6 +57,9 @@ class BustubInstance {
     }
     delete checkpoint_manager_;
     delete log_manager_;
+    if (!read_only_) {
+      buffer_pool_manager_->DumpWarmupSnapshot(warmup_file_name_);
+    }
     delete buffer_pool_manager_;
     delete lock_manager_;
     delete transaction_manager_;
@@ -60,6 +72,10 @@ class BustubInstance {
   TransactionManager *transaction_manager_;
   LogManager *log_manager_;
   CheckpointManager *checkpoint_manager_;
+  /** Sidecar file listing the resident pages, written at shutdown and read at startup. */
+  std::string warmup_file_name_;
+  /** True if the database was opened read-only. */
+  bool read_only_;
 };
 
 }  // namespace bustub
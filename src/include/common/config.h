@@ -16,11 +16,19 @@
 #include <chrono>  // NOLINT
 #include <cstdint>
 
+/** The page size is set at build time, see BUSTUB_PAGE_SIZE in CMakeLists.txt. */
+#ifndef BUSTUB_PAGE_SIZE
+#define BUSTUB_PAGE_SIZE 4096
+#endif
+
 namespace bustub {
 
 /** Cycle detection is performed every CYCLE_DETECTION_INTERVAL milliseconds. */
 extern std::chrono::milliseconds cycle_detection_interval;
 
+/** The maintenance thread of a hash table index checks whether a pass is due every HASH_TABLE_MAINTENANCE_INTERVAL. */
+extern std::chrono::milliseconds hash_table_maintenance_interval;
+
 /** True if logging should be enabled, false otherwise. */
 extern std::atomic<bool> enable_logging;
 
@@ -31,10 +39,23 @@ static constexpr int INVALID_PAGE_ID = -1;                                    //
 static constexpr int INVALID_TXN_ID = -1;                                     // invalid transaction id
 static constexpr int INVALID_LSN = -1;                                        // invalid log sequence number
 static constexpr int HEADER_PAGE_ID = 0;                                      // the header page id
-static constexpr int PAGE_SIZE = 4096;                                        // size of a data page in byte
+static constexpr int PAGE_SIZE = BUSTUB_PAGE_SIZE;                            // size of a data page in byte
 static constexpr int BUFFER_POOL_SIZE = 10;                                   // size of buffer pool
 static constexpr int LOG_BUFFER_SIZE = ((BUFFER_POOL_SIZE + 1) * PAGE_SIZE);  // size of a log buffer in byte
+static constexpr size_t BUFFER_POOL_MAX_GROWTH = 8;                           // max Resize factor of a buffer pool
 static constexpr int BUCKET_SIZE = 50;                                        // size of extendible hash bucket
+static constexpr size_t LRUK_REPLACER_K = 2;                                  // accesses remembered by LRU-K
+static constexpr uint64_t LRUK_CORRELATED_PERIOD = 8;                         // LRU-K correlated reference period
+static constexpr uint32_t ASYNC_IO_QUEUE_DEPTH = 64;                          // max I/Os in flight per disk manager
+static constexpr size_t DIRECT_IO_ALIGNMENT = 4096;                           // buffer alignment for O_DIRECT
+static constexpr size_t DB_FILE_GROWTH_CHUNK = 256;                           // pages preallocated at a time
+
+static constexpr int DEFAULT_TABLESPACE_ID = 0;                           // the tablespace of the main db file
+static constexpr int TABLESPACE_PAGE_BITS = 24;                           // page id bits within a tablespace
+static constexpr int MAX_TABLESPACES = 1 << (31 - TABLESPACE_PAGE_BITS);  // tablespaces a page id can name
+
+static_assert(PAGE_SIZE >= 4096 && PAGE_SIZE <= 65536 && (PAGE_SIZE & (PAGE_SIZE - 1)) == 0,
+              "BUSTUB_PAGE_SIZE must be a power of two from 4096 to 65536");
 
 using frame_id_t = int32_t;    // frame id type
 using page_id_t = int32_t;     // page id type
@@ -42,5 +63,21 @@ using txn_id_t = int32_t;      // transaction id type
 using lsn_t = int32_t;         // log sequence number type
 using slot_offset_t = size_t;  // slot offset type
 using oid_t = uint16_t;
+using tablespace_id_t = int32_t;  // tablespace id type
+
+/**
+ * The page id space is split into tablespaces, each a range of 2^TABLESPACE_PAGE_BITS page ids stored in its own file.
+ * The high bits of a page id name its tablespace, the low bits the page within the tablespace's file.
+ *
+ * That caps every tablespace, the default one included, at 2^TABLESPACE_PAGE_BITS pages: 64 GiB of 4 KiB pages. Once a
+ * tablespace has no free page ids left, NewPage returns nullptr for it, as when the buffer pool is full.
+ * @return the tablespace of a valid page id
+ */
+static constexpr auto TablespaceOf(page_id_t page_id) -> tablespace_id_t { return page_id >> TABLESPACE_PAGE_BITS; }
+
+/** @return the first page id of a tablespace */
+static constexpr auto FirstPageIdOf(tablespace_id_t tablespace_id) -> page_id_t {
+  return tablespace_id << TABLESPACE_PAGE_BITS;
+}
 
 }  // namespace bustub
@@ -0,0 +1,41 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// crc32c.h
+//
+// Identification: src/include/common/util/crc32c.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bustub {
+
+/**
+ * CRC32C (Castagnoli), the checksum of iSCSI and ext4. On x86-64 CPUs with SSE4.2 it is computed with the crc32
+ * instruction, eight bytes at a time; elsewhere with a lookup table.
+ */
+class Crc32cUtil {
+ public:
+  /**
+   * @param data the bytes to checksum
+   * @param size the number of bytes
+   * @param crc the checksum of the bytes before data, to checksum a buffer in pieces
+   * @return the checksum of the bytes
+   */
+  static auto Compute(const char *data, size_t size, uint32_t crc = 0) -> uint32_t;
+
+  /** @return true if Compute uses the SSE4.2 crc32 instruction */
+  static auto IsHardwareAccelerated() -> bool;
+
+  /** The table based implementation, exposed to check the hardware one against it. */
+  static auto ComputeSoftware(const char *data, size_t size, uint32_t crc = 0) -> uint32_t;
+};
+
+}  // namespace bustub
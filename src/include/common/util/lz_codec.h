@@ -0,0 +1,53 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lz_codec.h
+//
+// Identification: src/include/common/util/lz_codec.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstddef>
+
+namespace bustub {
+
+/**
+ * LzCodec is a small LZ77 compressor for pages, in the LZ4 block format: a sequence of tokens, each a run of
+ * literals followed by a match of at least 4 bytes up to 64 KiB back. It favours speed over ratio: a single hash
+ * probe per position and no entropy coding.
+ */
+class LzCodec {
+ public:
+  /**
+   * @param size the number of bytes to compress
+   * @return the size of the largest output Compress can produce for size bytes
+   */
+  static constexpr auto MaxCompressedSize(size_t size) -> size_t { return size + size / 255 + 16; }
+
+  /**
+   * Compresses a buffer of at most 64 KiB.
+   * @param src the bytes to compress
+   * @param size the number of bytes
+   * @param[out] dst the compressed bytes
+   * @param capacity the size of dst
+   * @return the compressed size, or 0 if it does not fit into capacity
+   */
+  static auto Compress(const char *src, size_t size, char *dst, size_t capacity) -> size_t;
+
+  /**
+   * Decompresses what Compress produced. Corrupt input never reads or writes out of bounds.
+   * @param src the compressed bytes
+   * @param size the compressed size
+   * @param[out] dst the decompressed bytes
+   * @param capacity the size of dst
+   * @return the decompressed size, or 0 if the input is corrupt or does not fit into capacity
+   */
+  static auto Decompress(const char *src, size_t size, char *dst, size_t capacity) -> size_t;
+};
+
+}  // namespace bustub
@@ -12,13 +12,20 @@
 
 #pragma once
 
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <mutex>               // NOLINT
 #include <queue>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "buffer/buffer_pool_manager.h"
 #include "concurrency/transaction.h"
 #include "container/hash/hash_function.h"
+#include "container/hash/hash_table_directory.h"
 #include "storage/page/hash_table_bucket_page.h"
 #include "storage/page/hash_table_directory_page.h"
 
@@ -30,6 +37,16 @@ namespace bustub {
  * Implementation of extendible hash table that is backed by a buffer pool
  * manager. Non-unique keys are supported. Supports insert and delete. The
  * table grows/shrinks dynamically as buckets become full/empty.
+ *
+ * Lookups, inserts and removes read-latch the directory only to find and pin the key's bucket, then latch the bucket
+ * alone. Splits and merges write-latch the directory and the buckets they change, and bump the directory version, so
+ * that an operation which latched a bucket after the directory changed under it starts over.
+ *
+ * Remove never merges on its own account. Buckets are merged by maintenance passes, which run once the table's fill
+ * factor drops below LOW_FILL_PERCENT: on a background thread if StartMaintenance was called, in which case the Remove
+ * that noticed only schedules the pass, otherwise on the Remove that noticed. A pass only merges buckets that together
+ * fill at most MERGE_FILL_PERCENT of a bucket, so a merged bucket takes as many inserts again before it splits, and a
+ * delete-heavy workload does not thrash between splits and merges.
  */
 template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTable {
@@ -40,9 +57,14 @@ class ExtendibleHashTable {
    * @param buffer_pool_manager buffer pool manager to be used
    * @param comparator comparator for keys
    * @param hash_fn the hash function
+   * @param tablespace_id the tablespace of the hash table's pages
    */
   explicit ExtendibleHashTable(const std::string &name, BufferPoolManager *buffer_pool_manager,
-                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn);
+                               const KeyComparator &comparator, HashFunction<KeyType> hash_fn,
+                               tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
+
+  /** Stops the maintenance thread, if it is running. */
+  ~ExtendibleHashTable();
 
   /**
    * Inserts a key-value pair into the hash table.
@@ -74,6 +96,45 @@ class ExtendibleHashTable {
    */
   auto GetValue(Transaction *transaction, const KeyType &key, std::vector<ValueType> *result) -> bool;
 
+  /**
+   * Fills an empty hash table with many pairs at once. The pairs are partitioned by the low bits of their hashes into
+   * as few buckets as hold them, the directory grows to its final depth up front, and each bucket page is written once,
+   * in the order of the partitions.
+   *
+   * @param transaction the current transaction
+   * @param pairs the key-value pairs to insert
+   * @return false if the table isn't empty, more pairs share a hash than fit into a bucket, or no page could be
+   * allocated; the table is left empty then
+   */
+  auto BulkLoad(Transaction *transaction, const std::vector<std::pair<KeyType, ValueType>> &pairs) -> bool;
+
+  /**
+   * Starts the background maintenance thread. Every interval, or sooner when a remove schedules a pass, the thread
+   * runs a maintenance pass if one is due, or if pages of merged buckets wait to be deleted. Removes then only
+   * schedule passes instead of running them.
+   *
+   * @param interval how long the thread sleeps between checks
+   */
+  void StartMaintenance(std::chrono::milliseconds interval);
+
+  /** Stops and joins the maintenance thread, if it is running. */
+  void StopMaintenance();
+
+  /**
+   * One maintenance pass: deletes the pages of merged buckets that earlier passes could not delete, merges every
+   * bucket with its split image while the two together fill at most MERGE_FILL_PERCENT of a bucket, then shrinks the
+   * directory as far as it can. The directory is write-latched for the whole pass.
+   *
+   * @return the number of merges
+   */
+  auto RunMaintenance() -> size_t;
+
+  /** @return the number of removes that emptied a bucket and left it for maintenance instead of merging it */
+  auto GetMergesAvoided() const -> uint64_t { return merges_avoided_; }
+
+  /** @return the number of merges done by maintenance passes */
+  auto GetMergeCount() const -> uint64_t { return merges_; }
+
   /**
    * Returns the global depth.  Do not touch.
    */
@@ -113,7 +174,8 @@ class ExtendibleHashTable {
   inline auto KeyToDirectoryIndex(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
 
   /**
-   * Get the bucket page_id corresponding to a key.
+   * Get the bucket page_id corresponding to a key. With a two-level directory this pins the leaf holding the key's
+   * slot for the duration of the call.
    *
    * @param key the key for lookup
    * @param dir_page a pointer to the hash table's directory page
@@ -122,53 +184,122 @@ class ExtendibleHashTable {
   inline auto KeyToPageId(KeyType key, HashTableDirectoryPage *dir_page) -> uint32_t;
 
   /**
-   * Fetches the directory page from the buffer pool manager.
+   * Fetches the directory's root page from the buffer pool manager.
+   *
+   * @param[out] page if not null, the buffer pool page holding the root, whose latch guards the whole directory
+   * @return a pointer to the directory page
+   */
+  auto FetchDirectoryPage(Page **page = nullptr) -> HashTableDirectoryPage *;
+
+  /**
+   * Fetches the directory page and latches it for a split, merge or bulk load. table_latch_ is taken as well, which
+   * keeps GetGlobalDepth and VerifyIntegrity out while the directory changes.
    *
+   * @param[out] page the directory's page, to be passed to UnlatchDirectoryForWrite
    * @return a pointer to the directory page
    */
-  auto FetchDirectoryPage() -> HashTableDirectoryPage *;
+  auto LatchDirectoryForWrite(Page **page) -> HashTableDirectoryPage *;
+
+  /**
+   * Releases the latches taken by LatchDirectoryForWrite and unpins the directory page.
+   *
+   * @param page the directory's page
+   * @param is_dirty whether the directory changed
+   */
+  void UnlatchDirectoryForWrite(Page *page, bool is_dirty);
 
   /**
    * Fetches the a bucket page from the buffer pool manager using the bucket's page_id.
    *
    * @param bucket_page_id the page_id to fetch
+   * @param[out] page if not null, the buffer pool page holding the bucket, whose latch guards it
    * @return a pointer to a bucket page
    */
-  auto FetchBucketPage(page_id_t bucket_page_id) -> HASH_TABLE_BUCKET_TYPE *;
+  auto FetchBucketPage(page_id_t bucket_page_id, Page **page = nullptr) -> HASH_TABLE_BUCKET_TYPE *;
 
   /**
-   * Performs insertion with an optional bucket splitting.
+   * Fetches and latches the bucket a key maps to, starting over if a split or merge changed the directory before the
+   * bucket was latched.
    *
-   * @param transaction a pointer to the current transaction
-   * @param key the key to insert
-   * @param value the value to insert
-   * @return whether or not the insertion was successful
+   * @param key the key for lookup
+   * @param exclusive true to write-latch the bucket, false to read-latch it
+   * @param[out] page the buffer pool page holding the bucket, pinned and latched
+   * @return a pointer to the bucket page
    */
-  auto SplitInsert(Transaction *transaction, const KeyType &key, const ValueType &value) -> bool;
+  auto FetchKeyBucket(KeyType key, bool exclusive, Page **page) -> HASH_TABLE_BUCKET_TYPE *;
 
   /**
-   * Optionally merges an empty bucket into it's pair.  This is called by Remove,
-   * if Remove makes a bucket empty.
+   * Splits the bucket that a hash maps to if it is still full, moving the pairs whose hash has the bit of the new
+   * local depth set into a new bucket.
    *
-   * There are three conditions under which we skip the merge:
-   * 1. The bucket is no longer empty.
+   * @param dir_page the directory's root page, latched for writing
+   * @param hash the hash of the key to insert
+   * @return false if the directory can't grow or no page could be allocated
+   */
+  auto SplitBucket(HashTableDirectoryPage *dir_page, uint32_t hash) -> bool;
+
+  /**
+   * Merges the bucket of a slot with its split image: the pairs of the emptier bucket move into the other one, and the
+   * emptier one is deleted. There are three conditions under which we skip the merge:
+   * 1. The buckets together fill more than MERGE_FILL_PERCENT of a bucket.
    * 2. The bucket has local depth 0.
    * 3. The bucket's local depth doesn't match its split image's local depth.
    *
-   * @param transaction a pointer to the current transaction
-   * @param key the key that was removed
-   * @param value the value that was removed
+   * @param directory the directory, with its root page latched for writing
+   * @param bucket_idx a slot of the bucket
+   * @return true if the buckets were merged
    */
-  void Merge(Transaction *transaction, const KeyType &key, const ValueType &value);
+  auto MergeBucket(HashTableDirectory *directory, uint32_t bucket_idx) -> bool;
+
+  /**
+   * A pass is due if the table's fill factor is below LOW_FILL_PERCENT and the table has at most half the pairs it had
+   * after the last pass, or none at all. The second condition keeps a table whose buckets can't be merged from
+   * running a pass on every remove.
+   *
+   * @return true if a maintenance pass is due
+   */
+  auto MaintenanceDue() -> bool;
+
+  /** Body of the maintenance thread. */
+  void RunMaintenanceThread();
+
+  /** Maintenance is due once the pairs fill less than this percentage of the buckets. */
+  static constexpr uint64_t LOW_FILL_PERCENT = 25;
+  /** Two buckets are merged if their pairs fill at most this percentage of one bucket. */
+  static constexpr uint64_t MERGE_FILL_PERCENT = 50;
 
   // member variables
   page_id_t directory_page_id_;
   BufferPoolManager *buffer_pool_manager_;
   KeyComparator comparator_;
 
-  // Readers includes inserts and removes, writers are splits and merges
-  ReaderWriterLatch table_latch_;
   HashFunction<KeyType> hash_fn_;
+  // Incremented whenever a split or merge repoints directory slots, with the directory latched for writing
+  std::atomic<uint64_t> directory_version_{0};
+  // Readers are GetGlobalDepth and VerifyIntegrity, writers are splits, merges and bulk loads; point operations only
+  // latch the directory page
+  ReaderWriterLatch table_latch_;
+
+  // the fill factor is num_pairs_ / (num_buckets_ * BUCKET_ARRAY_SIZE)
+  std::atomic<uint64_t> num_pairs_{0};
+  std::atomic<uint64_t> num_buckets_{1};
+  // num_pairs_ after the last maintenance pass; raised again by splits
+  std::atomic<uint64_t> maintained_pairs_{UINT64_MAX};
+  std::atomic<uint64_t> merges_avoided_{0};
+  std::atomic<uint64_t> merges_{0};
+  // pages of merged buckets that a lookup still had pinned; protected by the directory's write latch
+  std::vector<page_id_t> unreclaimed_pages_;
+  std::atomic<size_t> num_unreclaimed_pages_{0};
+
+  /** The maintenance thread, see StartMaintenance. */
+  std::thread maintenance_thread_;
+  /** Protects maintenance_running_ and maintenance_requested_, and lets the maintenance thread sleep on them. */
+  std::mutex maintenance_latch_;
+  std::condition_variable maintenance_cv_;
+  bool maintenance_running_{false};
+  /** Set by a Remove that found a pass due, cleared by the thread when it starts the pass. */
+  bool maintenance_requested_{false};
+  std::chrono::milliseconds maintenance_interval_{0};
 };
 
 }  // namespace bustub
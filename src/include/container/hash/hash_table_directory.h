@@ -0,0 +1,133 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// hash_table_directory.h
+//
+// Identification: src/include/container/hash/hash_table_directory.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include "buffer/buffer_pool_manager.h"
+#include "common/macros.h"
+#include "storage/page/hash_table_directory_page.h"
+
+namespace bustub {
+
+/**
+ * HashTableDirectory gives access to the slots of an extendible hash table's directory by slot index, whether the
+ * directory is its root page alone or, past DIRECTORY_MAX_DEPTH, spread over leaf pages listed in the root (see
+ * HashTableDirectoryPage). It grows the directory into leaves and shrinks it back into the root page.
+ *
+ * A lookup in a two-level directory pins one leaf besides the root. The leaf fetched last stays pinned until a slot of
+ * another leaf is needed or this object is destroyed, so walking slots in order fetches each leaf once. Leaves have no
+ * latches of their own; the root page's latch, held by the caller, guards the whole directory.
+ */
+class HashTableDirectory {
+ public:
+  /**
+   * The largest global depth of a two-level directory; inserts that would split past it fail. A third level would cost
+   * a second extra pin per lookup, so the cap stays: 18 with 4 KiB pages, about 62M GenericKey<8> pairs. Each doubling
+   * of BUSTUB_PAGE_SIZE raises it by 2, e.g. to 20 and about 500M pairs with 8 KiB pages.
+   */
+  static constexpr uint32_t MAX_GLOBAL_DEPTH = 2 * DIRECTORY_MAX_DEPTH;
+
+  /**
+   * @param buffer_pool_manager the buffer pool holding the directory's pages
+   * @param root the directory's root page, pinned and latched by the caller while this object lives; the caller
+   * unpins it as dirty after changing the directory
+   */
+  HashTableDirectory(BufferPoolManager *buffer_pool_manager, HashTableDirectoryPage *root);
+
+  /** Unpins the leaf fetched last. */
+  ~HashTableDirectory();
+
+  DISALLOW_COPY_AND_MOVE(HashTableDirectory);
+
+  /** @return the global depth of the directory */
+  auto GetGlobalDepth() -> uint32_t { return root_->GetGlobalDepth(); }
+
+  /** @return mask of global_depth 1's and the rest 0's (with 1's from LSB upwards) */
+  auto GetGlobalDepthMask() -> uint32_t { return root_->GetGlobalDepthMask(); }
+
+  /** @return the number of slots, 2^global_depth */
+  auto Size() -> uint32_t { return 1U << GetGlobalDepth(); }
+
+  /** @return true if the slots are in leaf pages rather than in the root */
+  auto HasLeaves() -> bool { return GetGlobalDepth() > DIRECTORY_MAX_DEPTH; }
+
+  /**
+   * @param bucket_idx the slot index
+   * @return the page id of the bucket the slot points to
+   */
+  auto GetBucketPageId(uint32_t bucket_idx) -> page_id_t;
+
+  /**
+   * @param bucket_idx the slot index
+   * @param bucket_page_id the page id of the bucket the slot points to
+   */
+  void SetBucketPageId(uint32_t bucket_idx, page_id_t bucket_page_id);
+
+  /**
+   * @param bucket_idx the slot index
+   * @return the local depth of the bucket the slot points to
+   */
+  auto GetLocalDepth(uint32_t bucket_idx) -> uint32_t;
+
+  /**
+   * @param bucket_idx the slot index
+   * @param local_depth the local depth of the bucket the slot points to
+   */
+  void SetLocalDepth(uint32_t bucket_idx, uint8_t local_depth);
+
+  /**
+   * Doubles the directory; slot i + Size() becomes a copy of slot i. Past DIRECTORY_MAX_DEPTH this allocates a copy of
+   * every leaf, in the tablespace of the root.
+   * @return false if the directory is at MAX_GLOBAL_DEPTH or no page could be allocated; the directory is unchanged
+   */
+  auto IncrGlobalDepth() -> bool;
+
+  /** Halves the directory, deleting the leaves no longer needed. Only call it if CanShrink. */
+  void DecrGlobalDepth();
+
+  /** @return true if every local depth is below the global depth, so the directory can be halved */
+  auto CanShrink() -> bool;
+
+  /**
+   * Verify the invariants of HashTableDirectoryPage::VerifyIntegrity over all slots, and for a two-level directory
+   * that the root has the largest local depth of each leaf.
+   */
+  void VerifyIntegrity();
+
+ private:
+  /**
+   * @param bucket_idx the slot index
+   * @param is_dirty true if the slot is about to be changed
+   * @return the page holding the slot, at index bucket_idx % DIRECTORY_ARRAY_SIZE
+   */
+  auto PageOf(uint32_t bucket_idx, bool is_dirty) -> HashTableDirectoryPage *;
+
+  /** Unpins the leaf fetched last, first updating its largest local depth in the root if it may have dropped. */
+  void ReleaseLeaf();
+
+  /** @return the index of a slot within its page */
+  static auto SlotOf(uint32_t bucket_idx) -> uint32_t { return bucket_idx & (DIRECTORY_ARRAY_SIZE - 1); }
+
+  /** @return the index of the leaf holding a slot */
+  static auto LeafOf(uint32_t bucket_idx) -> uint32_t { return bucket_idx >> DIRECTORY_MAX_DEPTH; }
+
+  BufferPoolManager *buffer_pool_manager_;
+  HashTableDirectoryPage *root_;
+  // the leaf fetched last, or nullptr, and its index in the root
+  HashTableDirectoryPage *leaf_{nullptr};
+  uint32_t leaf_idx_{0};
+  bool leaf_dirty_{false};
+  // a local depth in leaf_ was lowered, so the largest one recorded in the root may be too large
+  bool leaf_depth_lowered_{false};
+};
+
+}  // namespace bustub
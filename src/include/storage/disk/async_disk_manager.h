@@ -0,0 +1,213 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.h
+//
+// Identification: src/include/storage/disk/async_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <sys/uio.h>
+
+#include <atomic>
+#include <condition_variable>  // NOLINT
+#include <deque>
+#include <functional>
+#include <mutex>  // NOLINT
+#include <string>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * AsyncDiskManager does page I/O with pread/pwrite semantics on a raw file descriptor, with up to queue_depth reads
+ * and writes in flight at once. Requests go to an io_uring; on kernels without io_uring (or where it is not
+ * permitted) a pool of I/O threads issues plain pread/pwrite calls instead. The log file is still handled by
+ * DiskManager.
+ *
+ * In direct I/O mode the file is opened with O_DIRECT, so pages are cached only by the buffer pool. O_DIRECT needs
+ * buffers aligned to DIRECT_IO_ALIGNMENT; buffer pool frames are, and any other buffer goes through an aligned bounce
+ * buffer. A file system that rejects O_DIRECT gets buffered I/O instead.
+ *
+ * The synchronous DiskManager API is kept: ReadPage and WritePage submit a request and wait for it, and ReadPages
+ * submits all its reads before waiting, so a batch of buffer pool misses is read in parallel.
+ */
+class AsyncDiskManager : public DiskManager {
+ public:
+  /**
+   * Called when a request completes, on the completion thread. It must not wait for other I/O of this disk manager.
+   * The argument is false if the I/O failed.
+   */
+  using Callback = std::function<void(bool)>;
+
+  /**
+   * Creates a new asynchronous disk manager.
+   * @param db_file the file name of the database file to write to
+   * @param queue_depth the maximum number of requests in flight; submitting more blocks until one completes
+   * @param use_io_uring false to always use the I/O thread fallback
+   * @param direct_io true to bypass the kernel page cache with O_DIRECT, where the file system supports it
+   */
+  explicit AsyncDiskManager(const std::string &db_file, uint32_t queue_depth = ASYNC_IO_QUEUE_DEPTH,
+                            bool use_io_uring = true, bool direct_io = false);
+
+  ~AsyncDiskManager() override;
+
+  /** Waits for the requests in flight, stops the I/O threads and closes the files. */
+  void ShutDown() override;
+
+  /**
+   * Reads a page in the background. A page past the end of the file reads as zeros. A page that does not match its
+   * checksum is reported to the callback as a failed read.
+   * @param page_id id of the page
+   * @param[out] page_data output buffer, which must stay valid until the callback ran
+   * @param callback called once the read is done
+   */
+  void ReadPageAsync(page_id_t page_id, char *page_data, Callback callback);
+
+  /**
+   * Writes a page in the background.
+   * @param page_id id of the page
+   * @param page_data page data, which must stay valid and unchanged until the callback ran
+   * @param callback called once the write is done
+   */
+  void WritePageAsync(page_id_t page_id, const char *page_data, Callback callback);
+
+  /** Blocks until no request is in flight. */
+  void WaitForAll();
+
+  /** Synchronous write: submits the write and waits for it. */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /** Synchronous read: submits the read and waits for it. */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** Submits all reads at once and waits for all of them. */
+  void ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages) override;
+
+  /** Submits one vectored write per run of consecutive page ids, all at once, and waits for all of them. */
+  void WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages) override;
+
+  /** Waits for the requests in flight and makes the file's data durable with fdatasync. */
+  void Sync() override;
+
+  /** Waits for the requests in flight before truncating the trailing free pages. */
+  auto TruncateFreeTail() -> size_t override;
+
+  /** @return true if requests go through io_uring, false if through the I/O thread fallback */
+  auto IsIoUring() const -> bool { return ring_fd_ >= 0; }
+
+  /** @return true if the file is open with O_DIRECT */
+  auto IsDirectIo() const -> bool { return direct_io_; }
+
+  /** @return the number of requests whose buffer was not aligned for O_DIRECT and had to be copied */
+  auto GetNumBouncedIos() const -> uint64_t { return bounced_ios_; }
+
+ private:
+  /**
+   * One read or write in flight. It covers one page in data_, or, for a vectored write, the consecutive pages from
+   * page_id_ on in iovecs_ and data_ is null.
+   */
+  struct Request {
+    bool is_read_;
+    page_id_t page_id_;
+    char *data_;
+    Callback callback_;
+    /** Aligned copy of the data for O_DIRECT, or null if the data is used as is. */
+    char *bounce_{nullptr};
+    std::vector<iovec> iovecs_{};
+    /** For a write, the checksum of each page, computed on submission while the data is known to be unchanged. */
+    std::vector<uint32_t> checksums_{};
+    /** For a read, verify the checksum on completion; the synchronous reads verify in the caller instead. */
+    bool verify_{false};
+  };
+
+  /** @return the number of pages a request covers */
+  static auto NumPages(const Request *request) -> size_t {
+    return request->iovecs_.empty() ? 1 : request->iovecs_.size();
+  }
+
+  /** @return where byte offset of the request's data is, in the bounce buffer, the page buffer or the iovecs */
+  static auto DataAt(const Request *request, size_t offset) -> char * {
+    if (request->bounce_ != nullptr) {
+      return request->bounce_ + offset;
+    }
+    if (request->iovecs_.empty()) {
+      return request->data_ + offset;
+    }
+    return static_cast<char *>(request->iovecs_[offset / PAGE_SIZE].iov_base) + offset % PAGE_SIZE;
+  }
+
+  /** @return true if the request is issued as a vectored write */
+  static auto IsVectored(const Request *request) -> bool {
+    return request->bounce_ == nullptr && !request->iovecs_.empty();
+  }
+
+  /** Opens the database file, with O_DIRECT if asked for and supported. */
+  void OpenFile(const std::string &db_file, bool direct_io);
+
+  /**
+   * Gives a request an aligned bounce buffer if it needs one; a write's data is copied into it. A vectored write with
+   * an unaligned page is bounced as a whole and then written as one contiguous buffer.
+   */
+  void AlignBuffer(Request *request);
+
+  /** Sets up the io_uring; leaves ring_fd_ at -1 if the kernel refuses. */
+  auto SetUpRing(uint32_t queue_depth) -> bool;
+
+  /** Hands a batch of requests to the ring or the I/O threads, waiting for free slots as needed. */
+  void Submit(const std::vector<Request *> &requests);
+
+  /** Reports the result of a request to its callback and frees its slot. */
+  void Complete(Request *request, int64_t result);
+
+  /** Body of the completion thread when io_uring is in use. */
+  void RunCompletions();
+
+  /** Body of an I/O thread of the fallback. */
+  void RunWorker();
+
+  /** Waits for all requests in flight and stops the threads. Idempotent. */
+  void Stop();
+
+  const uint32_t queue_depth_;
+  int db_fd_{-1};
+  bool direct_io_{false};
+  std::atomic<uint64_t> bounced_ios_{0};
+
+  /** io_uring file descriptor and its mapped rings, -1 when the fallback is used. */
+  int ring_fd_{-1};
+  void *sq_ring_{nullptr};
+  void *cq_ring_{nullptr};
+  size_t sq_ring_size_{0};
+  size_t cq_ring_size_{0};
+  void *sqes_{nullptr};
+  size_t sqes_size_{0};
+  uint32_t *sq_tail_{nullptr};
+  uint32_t *sq_mask_{nullptr};
+  uint32_t *sq_array_{nullptr};
+  uint32_t *cq_head_{nullptr};
+  uint32_t *cq_tail_{nullptr};
+  uint32_t *cq_mask_{nullptr};
+  void *cqes_{nullptr};
+
+  /** Protects the submission ring, pending_ and in_flight_. */
+  std::mutex latch_;
+  /** Signalled when a request completes. */
+  std::condition_variable completed_cv_;
+  /** Signalled when the fallback has new pending_ requests. */
+  std::condition_variable pending_cv_;
+  size_t in_flight_{0};
+  std::deque<Request *> pending_;
+  bool stopping_{false};
+  std::vector<std::thread> threads_;
+};
+
+}  // namespace bustub
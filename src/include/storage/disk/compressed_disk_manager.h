@@ -0,0 +1,144 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager.h
+//
+// Identification: src/include/storage/disk/compressed_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <atomic>
+#include <mutex>  // NOLINT
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * CompressedDiskManager compresses every page with LzCodec before writing it, so that compressible pages take less
+ * I/O and disk space. ReadPage decompresses, so the buffer pool still sees plain pages.
+ *
+ * The db file becomes an extent file made of COMPRESSED_SECTOR_SIZE sectors. A page is stored in as many consecutive
+ * sectors as its compressed form needs, at most PAGE_SIZE / COMPRESSED_SECTOR_SIZE, in which case it is stored
+ * uncompressed. An indirection table maps each page id to its extent; it is kept in memory and persisted in a
+ * "<db>.ext" sidecar by Sync and ShutDown.
+ *
+ * Every write goes to a fresh extent: a free one of the right size, or the end of the file. The old extent is freed
+ * once the table that no longer points at it is durable, and only then reused, so a crash leaves the persisted table
+ * pointing at the old, intact extent.
+ *
+ * Sync writes only the table entries that changed since the last Sync, in place. An entry is 16 bytes at a 16 byte
+ * aligned offset, so it never spans two disk sectors and is written as a whole.
+ *
+ * Format of the sidecar, native byte order:
+ * | Magic (4) | Reserved (12) | Sector (8) | CompressedSize (4) | Reserved (4) | Sector (8) | ... |
+ *
+ * Entry i belongs to page id i. A compressed size of 0 means the page was never written; so does a page id past the
+ * last entry.
+ */
+class CompressedDiskManager : public DiskManager {
+ public:
+  /** Size of the allocation unit of the extent file. */
+  static constexpr size_t COMPRESSED_SECTOR_SIZE = 512;
+  /** The number of sectors of an uncompressed page. */
+  static constexpr size_t SECTORS_PER_PAGE = PAGE_SIZE / COMPRESSED_SECTOR_SIZE;
+
+  /**
+   * Creates a new compressed disk manager.
+   * @param db_file the file name of the extent file
+   */
+  explicit CompressedDiskManager(const std::string &db_file);
+
+  ~CompressedDiskManager() override;
+
+  /** Persists the indirection table and closes the files. */
+  void ShutDown() override;
+
+  /** Compresses the page and writes it to its extent. */
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  /** Reads the page's extent and decompresses it. A page that was never written reads as zeros. */
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** Reads the pages one extent at a time. */
+  void ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages) override;
+
+  /** Writes the pages one extent at a time. */
+  void WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages) override;
+
+  /**
+   * Makes the extents durable, then the table entries that changed, and releases the extents freed since the last
+   * Sync. The entries are written without holding the extent latch, so page I/O goes on meanwhile.
+   */
+  void Sync() override;
+
+  /** @return one more than the largest page id written */
+  auto GetNumPages() -> size_t override;
+
+  /**
+   * Frees the extents of the pages in the free page map, so that other pages can reuse the space. The extent file
+   * does not shrink, see the class comment.
+   * @return the number of pages whose extents were freed
+   */
+  auto TruncateFreeTail() -> size_t override;
+
+  /** @return the total size of the pages as stored, in bytes */
+  auto GetStoredBytes() -> size_t;
+
+  /** @return the number of page writes that stored the page uncompressed */
+  auto GetNumUncompressedWrites() const -> uint64_t { return uncompressed_writes_; }
+
+ private:
+  struct Extent {
+    uint64_t sector_;
+    /** The compressed size in bytes, PAGE_SIZE for a page stored as is, 0 for no extent. */
+    uint32_t size_;
+  };
+
+  /** @return the number of sectors an extent of that many bytes takes */
+  static auto SectorsFor(size_t size) -> size_t { return (size + COMPRESSED_SECTOR_SIZE - 1) / COMPRESSED_SECTOR_SIZE; }
+
+  /** Finds an extent for a page of the given stored size and records it in the table. Must hold extent_latch_. */
+  auto PlaceExtent(page_id_t page_id, size_t size) -> Extent;
+
+  /** Frees an extent once the table no longer refers to it. Must hold extent_latch_. */
+  void FreeExtent(const Extent &extent);
+
+  /** Marks the table entry of the page as changed since the last Sync. Must hold extent_latch_. */
+  void MarkDirty(page_id_t page_id) { dirty_entries_.insert(page_id); }
+
+  /** Writes the given table entries to the sidecar and makes them durable. */
+  auto SaveEntries(const std::vector<std::pair<page_id_t, Extent>> &entries) -> bool;
+
+  /** Reads the indirection table and rebuilds the free extents from the gaps between the used ones. */
+  void LoadTable();
+
+  std::string table_name_;
+  int table_fd_{-1};
+  /** Serializes Syncs, so that an older table entry never overwrites a newer one. */
+  std::mutex table_sync_latch_;
+  /** Protects table_, dirty_entries_, free_extents_, pending_free_ and end_sector_. */
+  std::mutex extent_latch_;
+  /** The indirection table, indexed by page id. */
+  std::vector<Extent> table_;
+  /** The page ids whose table entries changed since the last Sync. */
+  std::set<page_id_t> dirty_entries_;
+  /** Free extents by their number of sectors, index 0 unused. */
+  std::vector<std::vector<uint64_t>> free_extents_;
+  /** Extents freed since the last Sync. */
+  std::vector<Extent> pending_free_;
+  /** The first sector past the last extent. */
+  uint64_t end_sector_{0};
+  std::atomic<uint64_t> uncompressed_writes_{0};
+};
+
+}  // namespace bustub
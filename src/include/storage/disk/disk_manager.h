@@ -14,46 +14,135 @@
 
 #include <atomic>
 #include <fstream>
-#include <future>  // NOLINT
-#include <mutex>   // NOLINT
+#include <future>        // NOLINT
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
 #include <string>
+#include <unordered_set>
+#include <vector>
 
 #include "common/config.h"
+#include "storage/disk/free_page_map.h"
 
 namespace bustub {
 
 /**
  * DiskManager takes care of the allocation and deallocation of pages within a database. It performs the reading and
  * writing of pages to and from disk, providing a logical file layer within the context of a database management system.
+ *
+ * Every page written gets a CRC32C checksum, kept out of the page in a "<db>.crc" sidecar file with one 4 byte entry
+ * per page id after a small header, since the page layouts use all of their bytes. Reads verify the checksum unless
+ * verification is turned off. An entry of 0 means the page has no checksum yet, e.g. because it was never written.
+ *
+ * The sidecar only holds checksums of data that is durable, so that a crash cannot make a good page fail its check.
+ * The first write of a page after a Sync zeroes the page's entry before it writes the data, and Sync writes the new
+ * checksums once the data they describe is durable. Until then, the checksums are only kept in memory, and after a
+ * crash in between, the page reads as unverified.
+ *
+ * The zeroes are not synced, so that no page write waits for an fsync. That is enough if the process dies, because
+ * the kernel still writes back both files. A power loss, though, can keep the new data and lose the zero. The header
+ * therefore names the boot that has the sidecar open, and ShutDown clears it. A sidecar left open by an earlier boot
+ * may hold stale entries: a page that does not match its entry then reads as unverified and gets a new checksum.
  */
 class DiskManager {
  public:
   /**
    * Creates a new disk manager that writes to the specified database file.
    * @param db_file the file name of the database file to write to
+   * @param read_only open an existing file read-only and map it into memory, see GetMappedPage
    */
-  explicit DiskManager(const std::string &db_file);
+  explicit DiskManager(const std::string &db_file, bool read_only = false);
 
-  ~DiskManager() = default;
+  virtual ~DiskManager();
 
   /**
    * Shut down the disk manager and close all the file resources.
    */
-  void ShutDown();
+  virtual void ShutDown();
 
   /**
    * Write a page to the database file.
    * @param page_id id of the page
    * @param page_data raw page data
    */
-  void WritePage(page_id_t page_id, const char *page_data);
+  virtual void WritePage(page_id_t page_id, const char *page_data);
 
   /**
-   * Read a page from the database file.
+   * Read a page from the database file. A page that was never written reads as zeros.
    * @param page_id id of the page
    * @param[out] page_data output buffer
    */
-  void ReadPage(page_id_t page_id, char *page_data);
+  virtual void ReadPage(page_id_t page_id, char *page_data);
+
+  /**
+   * Read several pages from the database file under one acquisition of the file latch. The pages are read in page id
+   * order, and each run of consecutive page ids is read with a single read call.
+   * @param page_ids ids of the pages
+   * @param[out] page_data one output buffer per page
+   * @param num_pages number of pages to read
+   */
+  virtual void ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages);
+
+  /**
+   * Write several pages to the database file as one batch. The pages are written in page id order, each run of
+   * consecutive page ids with a single write call. Like WritePage, this does not make the pages durable, see Sync.
+   * @param page_ids ids of the pages
+   * @param page_data the data of each page
+   * @param num_pages number of pages to write
+   */
+  virtual void WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages);
+
+  /**
+   * Make every page written so far durable with one fdatasync. Called at flush boundaries, so a batch of page writes
+   * pays for a single sync.
+   */
+  virtual void Sync();
+
+  /**
+   * Record that a page is no longer used, so that its id and disk space can be handed out again. The free page map
+   * is persisted by Sync and ShutDown, after the pages written so far are durable.
+   * @param page_id id of the page
+   */
+  virtual void DeallocatePage(page_id_t page_id);
+
+  /**
+   * Take a deallocated page for reuse.
+   * @param stride the number of buffer pool instances sharing the file
+   * @param offset the index of the allocating instance; the page id is congruent to it modulo stride
+   * @param tablespace_id the tablespace to take the page from
+   * @return the smallest free page id that fits, or INVALID_PAGE_ID if there is none
+   */
+  virtual auto AllocateFreePage(uint32_t stride, uint32_t offset, tablespace_id_t tablespace_id) -> page_id_t;
+
+  /** @return the number of deallocated pages waiting for reuse */
+  virtual auto GetNumFreePages() -> size_t;
+
+  /**
+   * @param page_id id of the page
+   * @return true if the page is deallocated and waiting for reuse
+   */
+  virtual auto IsFreePage(page_id_t page_id) -> bool;
+
+  /**
+   * @param tablespace_id id of a tablespace
+   * @return true if pages of the tablespace can be read and written; a single file only has DEFAULT_TABLESPACE_ID
+   */
+  virtual auto HasTablespace(tablespace_id_t tablespace_id) -> bool { return tablespace_id == DEFAULT_TABLESPACE_ID; }
+
+  /**
+   * @param page_id id of the page
+   * @return true if the page lies within its file, i.e. it may have been written
+   */
+  virtual auto HasPage(page_id_t page_id) -> bool {
+    return page_id >= 0 && static_cast<size_t>(page_id) < GetNumPages();
+  }
+
+  /**
+   * Compact the database file by truncating the run of free pages at its end. The pages stay free and are reused last,
+   * since allocation prefers the smallest id. Safe to call while the buffer pool is running.
+   * @return the number of pages cut off the file
+   */
+  virtual auto TruncateFreeTail() -> size_t;
 
   /**
    * Flush the entire log buffer into disk.
@@ -71,6 +160,44 @@ class DiskManager {
    */
   auto ReadLog(char *log_data, int size, int offset) -> bool;
 
+  /**
+   * Check a page that did not come through ReadPage, e.g. one in the read-only mapping, against its checksum. Does
+   * nothing if verification is off.
+   * @param page_id id of the page
+   * @param page_data the page's bytes
+   * @throws Exception of type CORRUPTION if the page does not match its checksum
+   */
+  void VerifyChecksum(page_id_t page_id, const char *page_data);
+
+  /**
+   * Turn checksum verification of reads on or off. Checksums are still written either way, so verification can be
+   * turned back on at any time; turning it off saves one CRC32C per page read on hot read paths.
+   * @param verify false to skip verification
+   */
+  void SetVerifyChecksums(bool verify) { verify_checksums_ = verify; }
+
+  /** @return the number of pages read that did not match their checksum */
+  auto GetNumChecksumFailures() const -> uint64_t { return checksum_failures_; }
+
+  /** @return true if the database file is open read-only, in which case writing a page throws */
+  auto IsReadOnly() const -> bool { return read_only_; }
+
+  /**
+   * In read-only mode the whole database file is mapped into memory, so a buffer pool can hand out pages that point
+   * into the mapping instead of copying them into its frames. The memory is mapped PROT_READ, writing to it faults.
+   * @param page_id id of the page
+   * @return the page's bytes in the mapping, or nullptr if the file is not mapped or the page lies past its end
+   */
+  auto GetMappedPage(page_id_t page_id) -> char * {
+    if (mapping_ == nullptr || page_id < 0 || (static_cast<size_t>(page_id) + 1) * PAGE_SIZE > mapping_size_) {
+      return nullptr;
+    }
+    return mapping_ + static_cast<size_t>(page_id) * PAGE_SIZE;
+  }
+
+  /** @return the number of whole pages the database file currently holds */
+  virtual auto GetNumPages() -> size_t;
+
   /** @return the number of disk flushes */
   auto GetNumFlushes() const -> int;
 
@@ -80,6 +207,12 @@ class DiskManager {
   /** @return the number of disk writes */
   auto GetNumWrites() const -> int;
 
+  /** @return the number of disk reads */
+  auto GetNumReads() const -> int;
+
+  /** @return the number of Sync calls */
+  auto GetNumSyncs() const -> int { return num_syncs_; }
+
   /**
    * Sets the future which is used to check for non-blocking flushes.
    * @param f the non-blocking flush check
@@ -89,16 +222,105 @@ class DiskManager {
   /** Checks if the non-blocking flush future was set. */
   inline auto HasFlushLogFuture() -> bool { return flush_log_f_ != nullptr; }
 
- private:
-  auto GetFileSize(const std::string &file_name) -> int;
+ protected:
+  auto GetFileSize(const std::string &file_name) -> int64_t;
+  /** Opens file_name_ for reading only and maps it. */
+  void OpenReadOnly();
+  /** Reads num_pages consecutive pages starting at first_page_id into buffer. Must hold db_io_latch_. */
+  void ReadRun(page_id_t first_page_id, size_t num_pages, char *buffer);
+  /**
+   * Writes num_pages pages to consecutive page ids starting at first_page_id, with one pwritev per IOV_MAX pages.
+   * Must hold db_io_latch_, so that no read sees half a page.
+   * @return false on an I/O error
+   */
+  auto WriteRun(page_id_t first_page_id, const char *const *page_data, size_t num_pages) -> bool;
+  /**
+   * Makes sure disk space is allocated up to and including last_page_id before it is written. The file grows in
+   * chunks of DB_FILE_GROWTH_CHUNK pages with fallocate, keeping the file size, so the extents of neighbouring pages
+   * are contiguous and a write rarely has to allocate.
+   */
+  void ReserveSpace(page_id_t last_page_id);
+  /** Writes the free page map to its sidecar file if it changed. */
+  void SaveFreePageMap();
+  /** @return the checksum stored for a page with this data; never 0, which marks a page without checksum */
+  static auto PageChecksum(const char *page_data) -> uint32_t;
+  /**
+   * Zeroes the sidecar entries of the pages that are about to be written for the first time since the last Sync,
+   * without syncing them, see the class comment. The caller holds checksum_epoch_latch_ in shared mode from this call
+   * until the data is written and StoreChecksums ran.
+   */
+  void UnverifyChecksums(const page_id_t *page_ids, size_t num_pages);
+  /**
+   * Records the checksums of num_pages consecutive pages that were just written, in memory; Sync persists them. Call it
+   * in the same critical section as the data write, so that two writers of a page cannot leave the checksum of one
+   * write next to the data of the other.
+   */
+  void StoreChecksums(page_id_t first_page_id, const uint32_t *checksums, size_t num_pages);
+  /**
+   * Starts a Sync: waits for the writes between UnverifyChecksums and StoreChecksums to finish, and takes the pages
+   * written since the last Sync. Their checksums go to the sidecar in SyncSidecars, once the data is durable.
+   * @return the pages written since the last Sync
+   */
+  auto TakeUnsyncedChecksums() -> std::vector<page_id_t>;
+  /**
+   * Compares a page with its stored checksum, counting and logging a mismatch.
+   * @return false on a mismatch, true if the page matches, has no checksum or verification is off
+   */
+  auto CheckChecksum(page_id_t page_id, const char *page_data) -> bool;
+  /**
+   * Opens the checksum sidecar and loads it, discarding it first if the db file is new. Unless read-only, the header
+   * then names this boot, see the class comment.
+   */
+  void OpenChecksumFile(bool db_file_is_new);
+  /**
+   * Writes the owner of the sidecar into its header and syncs it. Must hold checksum_latch_.
+   * @param boot_id the boot that has the sidecar open, or empty once it is shut down
+   */
+  void WriteChecksumHeader(const std::string &boot_id);
+  /** @return the id of the running boot, or "unknown" if the kernel doesn't tell */
+  static auto BootId() -> std::string;
+  /**
+   * Makes the sidecar files durable, after the pages they describe are. Writes the checksums of the pages taken by
+   * TakeUnsyncedChecksums, except those written again since.
+   * @param page_ids the pages written before the data was made durable
+   */
+  void SyncSidecars(const std::vector<page_id_t> &page_ids);
   // stream to write log file
   std::fstream log_io_;
   std::string log_name_;
   // stream to write db file
   std::fstream db_io_;
   std::string file_name_;
+  // sidecar file of the free page map
+  std::string free_map_name_;
+  FreePageMap free_page_map_;
+  std::mutex free_latch_;
+  // sidecar file of the page checksums, and the checksums by page id
+  std::string checksum_name_;
+  int checksum_fd_{-1};
+  std::vector<uint32_t> checksums_;
+  std::mutex checksum_latch_;
+  // pages written since the last Sync, whose sidecar entries are 0 or stale on disk; protected by checksum_latch_
+  std::unordered_set<page_id_t> unsynced_checksums_;
+  // held shared by writers from UnverifyChecksums until StoreChecksums, exclusively by TakeUnsyncedChecksums
+  std::shared_mutex checksum_epoch_latch_;
+  std::atomic<bool> verify_checksums_{true};
+  std::atomic<uint64_t> checksum_failures_{0};
+  // the sidecar was left open by an earlier boot, so its entries may be older than their pages
+  bool checksums_may_be_stale_{false};
   int num_flushes_;
-  int num_writes_;
+  std::atomic<int> num_writes_;
+  std::atomic<int> num_reads_;
+  std::atomic<int> num_syncs_{0};
+  // descriptor of the db file used for page writes, fdatasync and fallocate, which fstream does not offer
+  int sync_fd_{-1};
+  // bytes of the db file allocated by ReserveSpace
+  std::atomic<size_t> reserved_size_{0};
+  std::mutex reserve_latch_;
+  bool read_only_;
+  // read-only mapping of the whole db file, null unless read_only_
+  char *mapping_{nullptr};
+  size_t mapping_size_{0};
   bool flush_log_;
   std::future<void> *flush_log_f_;
   // With multiple buffer pool instances, need to protect file access
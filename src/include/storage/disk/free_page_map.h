@@ -0,0 +1,98 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_page_map.h
+//
+// Identification: src/include/storage/disk/free_page_map.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "common/config.h"
+
+namespace bustub {
+
+/**
+ * FreePageMap tracks the pages of a database file that were deallocated and may be handed out again. It is kept in
+ * memory, and persisted in a sidecar file, as a bitmap with one bit per page id, set if the page is free. Allocate
+ * finds the smallest free page a word of the bitmap at a time.
+ *
+ * Format, native byte order:
+ * | Magic (4) | NumBits (8) | Bitmap (NumBits / 8 rounded up) |
+ *
+ * The map is not thread safe; DiskManager serializes access to it.
+ */
+class FreePageMap {
+ public:
+  /**
+   * Marks a page as free.
+   * @param page_id id of the page
+   */
+  void Free(page_id_t page_id);
+
+  /**
+   * Takes the smallest free page id that is congruent to offset modulo stride, which is how a parallel buffer pool
+   * spreads page ids over its instances.
+   * @param stride the number of buffer pool instances
+   * @param offset the index of the allocating instance
+   * @return the page id, or INVALID_PAGE_ID if no free page fits
+   */
+  auto Allocate(uint32_t stride, uint32_t offset) -> page_id_t;
+
+  /** @return true if the page is free */
+  auto IsFree(page_id_t page_id) const -> bool {
+    auto index = static_cast<size_t>(page_id);
+    return page_id >= 0 && index / WORD_BITS < words_.size() && (words_[index / WORD_BITS] & Bit(index)) != 0;
+  }
+
+  /** @return the number of free pages */
+  auto Size() const -> size_t { return num_free_; }
+
+  /**
+   * Finds the first page of the run of free pages that ends the file. The pages stay free; truncating the file only
+   * releases their space.
+   * @param num_pages the number of pages the file holds
+   * @return the number of pages the file needs once the trailing free pages are cut off
+   */
+  auto TrailingFreeStart(size_t num_pages) const -> size_t;
+
+  /**
+   * Writes the map if it changed since it was read or last written. The file is written and synced under a temporary
+   * name, renamed, and the directory synced, so a crash leaves either the old or the new file, never a torn one.
+   * @param file_name the sidecar file
+   * @return false if the file could not be written
+   */
+  auto Write(const std::string &file_name) -> bool;
+
+  /**
+   * Reads the map, replacing the pages tracked so far.
+   * @param file_name the sidecar file
+   * @return false if the file does not exist or is not a free page map
+   */
+  auto Read(const std::string &file_name) -> bool;
+
+ private:
+  static constexpr uint32_t MAGIC = 0x4d465442;  // "BTFM"
+  static constexpr size_t WORD_BITS = 64;
+
+  /** @return the bit of a page id within its word */
+  static auto Bit(size_t index) -> uint64_t { return uint64_t{1} << (index % WORD_BITS); }
+
+  /** The bitmap, bit i of word w is page id w * WORD_BITS + i. */
+  std::vector<uint64_t> words_;
+  /** No word before this one has a bit set. */
+  size_t first_word_{0};
+  size_t num_free_{0};
+  // true if the bitmap differs from the sidecar file
+  bool dirty_{false};
+};
+
+}  // namespace bustub
@@ -0,0 +1,114 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tablespace_disk_manager.h
+//
+// Identification: src/include/storage/disk/tablespace_disk_manager.h
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <string>
+#include <vector>
+
+#include "storage/disk/disk_manager.h"
+
+namespace bustub {
+
+/**
+ * TablespaceDiskManager spreads the page id space over several files. The high bits of a page id name its tablespace
+ * (see TablespaceOf); the default tablespace is the db file this disk manager was created with, and every other
+ * tablespace is a file with a disk manager of its own, added with AddTablespace. So hot indexes can live on a fast
+ * device and cold tables on bulk storage.
+ *
+ * Each file keeps its own latches, free page map and checksums, and an AsyncDiskManager brings its own I/O queue, so
+ * I/O to different tablespaces does not wait on each other. A tablespace's disk manager sees the page ids within the
+ * tablespace, starting at 0, so its file holds no gap for the page ids of the tablespaces before it.
+ *
+ * The log stays with the default tablespace.
+ */
+class TablespaceDiskManager : public DiskManager {
+ public:
+  /**
+   * Creates a disk manager with only the default tablespace.
+   * @param db_file the file name of the default tablespace
+   */
+  explicit TablespaceDiskManager(const std::string &db_file);
+
+  /**
+   * Adds a tablespace. Its pages are read and written through the given disk manager, e.g. an AsyncDiskManager for a
+   * file on a different device. Tablespaces are not removed again.
+   * @param tablespace_id id of the tablespace, from 1 to MAX_TABLESPACES - 1
+   * @param disk_manager the disk manager of the tablespace's file
+   * @throws Exception if the id is out of range or already taken
+   */
+  void AddTablespace(tablespace_id_t tablespace_id, std::unique_ptr<DiskManager> disk_manager);
+
+  /** @return true for the default tablespace and the added ones */
+  auto HasTablespace(tablespace_id_t tablespace_id) -> bool override;
+
+  /** Shuts down the disk managers of all tablespaces. */
+  void ShutDown() override;
+
+  void WritePage(page_id_t page_id, const char *page_data) override;
+
+  void ReadPage(page_id_t page_id, char *page_data) override;
+
+  /** Splits the pages by tablespace and reads each tablespace's pages as one batch. */
+  void ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages) override;
+
+  /** Splits the pages by tablespace and writes each tablespace's pages as one batch. */
+  void WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages) override;
+
+  /** Syncs every tablespace. */
+  void Sync() override;
+
+  void DeallocatePage(page_id_t page_id) override;
+
+  auto AllocateFreePage(uint32_t stride, uint32_t offset, tablespace_id_t tablespace_id) -> page_id_t override;
+
+  /** @return the number of free pages of all tablespaces */
+  auto GetNumFreePages() -> size_t override;
+
+  auto IsFreePage(page_id_t page_id) -> bool override;
+
+  /** @return the number of pages cut off the files of all tablespaces */
+  auto TruncateFreeTail() -> size_t override;
+
+  auto HasPage(page_id_t page_id) -> bool override;
+
+ private:
+  /**
+   * @return the disk manager of the page's tablespace, or nullptr for the default tablespace
+   * @throws Exception if the tablespace does not exist
+   */
+  auto DiskManagerOf(page_id_t page_id) -> DiskManager *;
+
+  /** @return the page id within its tablespace */
+  static auto LocalPageId(page_id_t page_id) -> page_id_t { return page_id & ((1 << TABLESPACE_PAGE_BITS) - 1); }
+
+  /**
+   * Splits a batch of pages by tablespace and calls fn once per tablespace, with the tablespace's disk manager (nullptr
+   * for the default one), the local page ids and the indexes of those pages in the batch.
+   */
+  void ForEachTablespace(
+      const page_id_t *page_ids, size_t num_pages,
+      const std::function<void(DiskManager *, const std::vector<page_id_t> &, const std::vector<size_t> &)> &fn);
+
+  /** The disk managers of the added tablespaces by id; entry 0, the default tablespace, stays null. */
+  std::array<std::atomic<DiskManager *>, MAX_TABLESPACES> tablespaces_{};
+  /** Owns the disk managers in tablespaces_. */
+  std::vector<std::unique_ptr<DiskManager>> owned_;
+  std::mutex tablespace_latch_;
+};
+
+}  // namespace bustub
@@ -20,6 +20,7 @@
 #include "container/hash/extendible_hash_table.h"
 #include "container/hash/hash_function.h"
 #include "storage/index/index.h"
+#include "storage/table/table_heap.h"
 
 namespace bustub {
 
@@ -29,7 +30,7 @@ template <typename KeyType, typename ValueType, typename KeyComparator>
 class ExtendibleHashTableIndex : public Index {
  public:
   ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata, BufferPoolManager *buffer_pool_manager,
-                           const HashFunction<KeyType> &hash_fn);
+                           const HashFunction<KeyType> &hash_fn, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
 
   ~ExtendibleHashTableIndex() override = default;
 
@@ -39,6 +40,15 @@ class ExtendibleHashTableIndex : public Index {
 
   void ScanKey(const Tuple &key, std::vector<RID> *result, Transaction *transaction) override;
 
+  /**
+   * Fills the empty index with the keys of all tuples of a table. The table is scanned by several threads and the
+   * entries are bulk loaded, see ExtendibleHashTable::BulkLoad; if that fails, they are inserted one by one.
+   * @param table_heap the indexed table
+   * @param schema the schema of the table's tuples
+   * @param transaction the transaction building the index
+   */
+  void BulkBuild(TableHeap *table_heap, const Schema &schema, Transaction *transaction);
+
  protected:
   // comparator for key
   KeyComparator comparator_;
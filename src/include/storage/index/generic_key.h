@@ -14,6 +14,7 @@
 
 #include <cstring>
 
+#include "common/util/hash_util.h"
 #include "storage/table/tuple.h"
 #include "type/value.h"
 
@@ -94,6 +95,16 @@ class GenericComparator {
     return 0;
   }
 
+  /** @return a hash of the key's columns; keys that compare equal have equal hashes */
+  inline auto Hash(const GenericKey<KeySize> &key) const -> hash_t {
+    hash_t hash = 0;
+    for (uint32_t i = 0; i < key_schema_->GetColumnCount(); i++) {
+      Value value = key.ToValue(key_schema_, i);
+      hash = HashUtil::CombineHashes(hash, value.IsNull() ? 0 : HashUtil::HashValue(&value));
+    }
+    return hash;
+  }
+
   GenericComparator(const GenericComparator &other) : key_schema_{other.key_schema_} {}
 
   // constructor
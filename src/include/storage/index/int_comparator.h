@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <cstdint>
+
 namespace bustub {
 
 /**
@@ -29,5 +31,8 @@ class IntComparator {
     }
     return 0;
   }
+
+  /** @return a hash of the key; keys that compare equal have equal hashes */
+  inline auto Hash(const int key) const -> uint64_t { return static_cast<uint32_t>(key); }
 };
 }  // namespace bustub
@@ -26,10 +26,17 @@ namespace bustub {
  *
  * Directory Page for extendible hash table.
  *
- * Directory format (size in byte):
+ * Directory format (size in byte), with N = DIRECTORY_ARRAY_SIZE:
  * --------------------------------------------------------------------------------------------
- * | LSN (4) | PageId(4) | GlobalDepth(4) | LocalDepths(512) | BucketPageIds(2048) | Free(1524)
+ * | LSN (4) | PageId(4) | GlobalDepth(4) | LocalDepths(N) | BucketPageIds(4 * N) | Free
  * --------------------------------------------------------------------------------------------
+ *
+ * With 4 KiB pages N is 512, so a single page directory has a global depth of at most 9 (DIRECTORY_MAX_DEPTH).
+ *
+ * A deeper directory has two levels: its slots are spread over leaf pages of this same format, leaf k holding slots
+ * k * N to (k + 1) * N - 1 with a global depth of DIRECTORY_MAX_DEPTH, and the root page has the real global depth
+ * and reuses BucketPageIds for the page ids of the leaves and LocalDepths for the largest local depth in each leaf.
+ * HashTableDirectory hides the difference.
  */
 class HashTableDirectoryPage {
  public:
@@ -195,4 +202,6 @@ class HashTableDirectoryPage {
   page_id_t bucket_page_ids_[DIRECTORY_ARRAY_SIZE];
 };
 
+static_assert(sizeof(HashTableDirectoryPage) <= PAGE_SIZE, "the hash table directory must fit into a page");
+
 }  // namespace bustub
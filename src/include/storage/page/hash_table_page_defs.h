@@ -32,13 +32,23 @@
  * Extendible Hashing Definitions
  */
 #define HASH_TABLE_BUCKET_TYPE HashTableBucketPage<KeyType, ValueType, KeyComparator>
-#define DIRECTORY_ARRAY_SIZE 512
+/**
+ * DIRECTORY_ARRAY_SIZE is the number of directory slots, a power of two. Each slot takes a local depth (1 byte) and a
+ * bucket page id (4 bytes), so PAGE_SIZE / 8 slots leave room for the directory page header at every page size.
+ */
+#define DIRECTORY_ARRAY_SIZE (PAGE_SIZE / 8)
+
+/**
+ * DIRECTORY_MAX_DEPTH is the largest global depth of a directory that fits into one page, log2(DIRECTORY_ARRAY_SIZE).
+ * A deeper directory is spread over leaf pages, see HashTableDirectory.
+ */
+#define DIRECTORY_MAX_DEPTH (__builtin_ctz(DIRECTORY_ARRAY_SIZE))
 
 /**
  * BUCKET_ARRAY_SIZE is the number of (key, value) pairs that can be stored in an extendible hashing bucket page.
  * It is an approximate calculation based on the size of MappingType (which is a std::pair of KeyType and ValueType).
- * For each key/value pair, we need two additional bits for occupied_ and readable_. 4 * (PAGE_SIZE - 4) / (4 * sizeof
- * (MappingType) + 1) = (PAGE_SIZE - 4)/(sizeof (MappingType) + 0.25) because 0.25 bytes = 2 bits is the space required
- * to maintain the occupied and readable flags for a key value pair.
+ * For each key/value pair, we need a fingerprint byte and two additional bits for occupied_ and readable_.
+ * 4 * PAGE_SIZE / (4 * sizeof (MappingType) + 5) = PAGE_SIZE / (sizeof (MappingType) + 1.25) because 1.25 bytes is the
+ * space required to maintain the fingerprint and the occupied and readable flags for a key value pair.
  */
-#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 1))
+#define BUCKET_ARRAY_SIZE (4 * PAGE_SIZE / (4 * sizeof(MappingType) + 5))
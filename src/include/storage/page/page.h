@@ -12,8 +12,10 @@
 
 #pragma once
 
+#include <atomic>
 #include <cstring>
 #include <iostream>
+#include <memory>
 
 #include "common/config.h"
 #include "common/rwlatch.h"
@@ -28,10 +30,11 @@ namespace bustub {
 class Page {
   // There is book-keeping information inside the page that should only be relevant to the buffer pool manager.
   friend class BufferPoolManagerInstance;
+  friend class FrameArena;
 
  public:
-  /** Constructor. Zeros out the page data. */
-  Page() { ResetMemory(); }
+  /** Constructor for a page outside the buffer pool. Allocates its own zeroed page data. */
+  Page() : owned_data_(new char[PAGE_SIZE]{}), data_(owned_data_.get()) {}
 
   /** Default destructor. */
   ~Page() = default;
@@ -78,14 +81,23 @@ class Page {
   /** Zeroes out the data that is held within the page. */
   inline void ResetMemory() { memset(data_, OFFSET_PAGE_START, PAGE_SIZE); }
 
+  /** Constructor for a buffer pool frame. The data belongs to the frame arena. */
+  explicit Page(char *data) : data_(data) {}
+
+  /** Backing storage of a page created outside the buffer pool, null for frames. */
+  std::unique_ptr<char[]> owned_data_;
   /** The actual data that is stored within a page. */
-  char data_[PAGE_SIZE]{};
+  char *data_;
   /** The ID of this page. */
   page_id_t page_id_ = INVALID_PAGE_ID;
-  /** The pin count of this page. */
-  int pin_count_ = 0;
+  /** The pin count of this page. Atomic so that buffer pool hits can pin without taking the pool latch. */
+  std::atomic<int> pin_count_ = 0;
+  /** How often the page was pinned since it was read in. Next to pin_count_, so counting adds no cache line write. */
+  std::atomic<uint32_t> access_count_ = 0;
   /** True if the page is dirty, i.e. it is different from its corresponding page on disk. */
-  bool is_dirty_ = false;
+  std::atomic<bool> is_dirty_ = false;
+  /** True while a copy of the page is being written back, so that at most one write of the page is in flight. */
+  std::atomic<bool> writing_back_ = false;
   /** Page latch. */
   ReaderWriterLatch rwlatch_;
 };
@@ -12,6 +12,8 @@
 
 #pragma once
 
+#include <functional>
+
 #include "buffer/buffer_pool_manager.h"
 #include "recovery/log_manager.h"
 #include "storage/page/table_page.h"
@@ -46,9 +48,10 @@ class TableHeap {
    * @param lock_manager the lock manager
    * @param log_manager the log manager
    * @param txn the creating transaction
+   * @param tablespace_id the tablespace of the table's pages
    */
   TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-            Transaction *txn);
+            Transaction *txn, tablespace_id_t tablespace_id = DEFAULT_TABLESPACE_ID);
 
   /**
    * Insert a tuple into the table. If the tuple is too large (>= page_size), return false.
@@ -105,6 +108,15 @@ class TableHeap {
   /** @return the end iterator of this table */
   auto End() -> TableIterator;
 
+  /**
+   * Read every tuple of the table with several threads, each taking the next page of the chain in turn.
+   * @param txn the transaction performing the scan
+   * @param num_threads the number of threads; one if logging is enabled, since the tuples' locks are then taken for
+   * txn, which isn't thread-safe
+   * @param fn called as fn(thread, tuple) for each tuple, in no particular order; concurrently for different threads
+   */
+  void ParallelScan(Transaction *txn, size_t num_threads, const std::function<void(size_t, const Tuple &)> &fn);
+
   /** @return the id of the first page of this table */
   inline auto GetFirstPageId() const -> page_id_t { return first_page_id_; }
 
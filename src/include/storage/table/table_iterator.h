@@ -32,7 +32,11 @@ class TableIterator {
   TableIterator(TableHeap *table_heap, RID rid, Transaction *txn);
 
   TableIterator(const TableIterator &other)
-      : table_heap_(other.table_heap_), tuple_(new Tuple(*other.tuple_)), txn_(other.txn_) {}
+      : table_heap_(other.table_heap_),
+        tuple_(new Tuple(*other.tuple_)),
+        txn_(other.txn_),
+        readahead_window_(other.readahead_window_),
+        readahead_end_(other.readahead_end_) {}
 
   ~TableIterator() { delete tuple_; }
 
@@ -54,13 +58,33 @@ class TableIterator {
     table_heap_ = other.table_heap_;
     *tuple_ = *other.tuple_;
     txn_ = other.txn_;
+    readahead_window_ = other.readahead_window_;
+    readahead_end_ = other.readahead_end_;
     return *this;
   }
 
  private:
+  /** Read-ahead window once a scan has been found to be sequential; doubled on every further sequential step. */
+  static constexpr size_t MIN_READAHEAD_PAGES = 4;
+  static constexpr size_t MAX_READAHEAD_PAGES = 64;
+
+  /**
+   * Called when the scan moves from cur_page_id to next_page_id. Asks the buffer pool to read the page after
+   * next_page_id in the background, and, while the table's pages have consecutive ids, a window of pages beyond it
+   * that grows adaptively.
+   * @param cur_page_id the page the scan is leaving
+   * @param next_page_id the page the scan is entering
+   * @param after_next_page_id the page that follows next_page_id in the table heap
+   */
+  void ReadAhead(page_id_t cur_page_id, page_id_t next_page_id, page_id_t after_next_page_id);
+
   TableHeap *table_heap_;
   Tuple *tuple_;
   Transaction *txn_;
+  /** Current read-ahead window in pages, 0 while the scan does not look sequential. */
+  size_t readahead_window_{0};
+  /** Pages before this id have already been requested from the buffer pool. */
+  page_id_t readahead_end_{INVALID_PAGE_ID};
 };
 
 }  // namespace bustub
@@ -0,0 +1,520 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager.cpp
+//
+// Identification: src/storage/disk/async_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+
+#include "common/exception.h"
+#include "common/logger.h"
+
+namespace bustub {
+
+/** Number of I/O threads of the fallback; more than this rarely helps a single file. */
+static constexpr uint32_t MAX_IO_THREADS = 16;
+
+static auto IoUringEnter(int ring_fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags) -> int {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+/**
+ * Some file systems accept O_DIRECT at open time and only fail the I/O, with EINVAL. A read at the end of a new file
+ * does no I/O at all, so the probe writes one aligned block past the end of the file, reads it back, and cuts the file
+ * back to its size. The pages already in the file are not touched.
+ */
+static auto ProbeDirectIo(int fd) -> bool {
+  struct stat stat_buf;
+  if (fstat(fd, &stat_buf) != 0) {
+    return false;
+  }
+  auto size = static_cast<size_t>(stat_buf.st_size);
+  auto offset = static_cast<off_t>((size + DIRECT_IO_ALIGNMENT - 1) / DIRECT_IO_ALIGNMENT * DIRECT_IO_ALIGNMENT);
+  void *probe = aligned_alloc(DIRECT_IO_ALIGNMENT, DIRECT_IO_ALIGNMENT);
+  memset(probe, 0, DIRECT_IO_ALIGNMENT);
+  auto length = static_cast<ssize_t>(DIRECT_IO_ALIGNMENT);
+  bool ok = pwrite(fd, probe, DIRECT_IO_ALIGNMENT, offset) == length &&
+            pread(fd, probe, DIRECT_IO_ALIGNMENT, offset) == length;
+  free(probe);
+  if (ftruncate(fd, stat_buf.st_size) != 0) {
+    LOG_WARN("can't cut the db file back after probing O_DIRECT: %s", strerror(errno));
+  }
+  return ok;
+}
+
+AsyncDiskManager::AsyncDiskManager(const std::string &db_file, uint32_t queue_depth, bool use_io_uring,
+                                   bool direct_io)
+    : DiskManager(db_file), queue_depth_(std::max<uint32_t>(queue_depth, 1)) {
+  OpenFile(db_file, direct_io);
+  if (use_io_uring && SetUpRing(queue_depth_)) {
+    threads_.emplace_back(&AsyncDiskManager::RunCompletions, this);
+  } else {
+    if (use_io_uring) {
+      LOG_WARN("io_uring is not available, falling back to I/O threads");
+    }
+    for (uint32_t i = 0; i < std::min(queue_depth_, MAX_IO_THREADS); i++) {
+      threads_.emplace_back(&AsyncDiskManager::RunWorker, this);
+    }
+  }
+}
+
+AsyncDiskManager::~AsyncDiskManager() { Stop(); }
+
+void AsyncDiskManager::ShutDown() {
+  Stop();
+  DiskManager::ShutDown();
+}
+
+void AsyncDiskManager::OpenFile(const std::string &db_file, bool direct_io) {
+  if (direct_io) {
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT | O_DIRECT, 0644);
+    if (db_fd_ >= 0) {
+      if (ProbeDirectIo(db_fd_)) {
+        direct_io_ = true;
+      } else {
+        close(db_fd_);
+        db_fd_ = -1;
+      }
+    }
+    if (!direct_io_) {
+      LOG_WARN("the file system does not support O_DIRECT, using buffered I/O");
+    }
+  }
+  if (db_fd_ < 0) {
+    db_fd_ = open(db_file.c_str(), O_RDWR | O_CREAT, 0644);
+  }
+  if (db_fd_ < 0) {
+    throw Exception("can't open db file");
+  }
+}
+
+void AsyncDiskManager::AlignBuffer(Request *request) {
+  if (!direct_io_) {
+    return;
+  }
+  bool aligned = true;
+  for (size_t i = 0; i < NumPages(request); i++) {
+    aligned = aligned && reinterpret_cast<uintptr_t>(DataAt(request, i * PAGE_SIZE)) % DIRECT_IO_ALIGNMENT == 0;
+  }
+  if (aligned) {
+    return;
+  }
+  size_t size = NumPages(request) * PAGE_SIZE;
+  auto *bounce = static_cast<char *>(aligned_alloc(DIRECT_IO_ALIGNMENT, size));
+  if (!request->is_read_) {
+    for (size_t i = 0; i < NumPages(request); i++) {
+      memcpy(bounce + i * PAGE_SIZE, DataAt(request, i * PAGE_SIZE), PAGE_SIZE);
+    }
+  }
+  request->bounce_ = bounce;
+  bounced_ios_++;
+}
+
+auto AsyncDiskManager::SetUpRing(uint32_t queue_depth) -> bool {
+  io_uring_params params;
+  memset(&params, 0, sizeof(params));
+  int ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, queue_depth, &params));
+  if (ring_fd < 0) {
+    return false;
+  }
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+  cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ =
+      mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+  cq_ring_ = single_mmap ? sq_ring_
+                         : mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd,
+                                IORING_OFF_CQ_RING);
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  sqes_ = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES);
+  if (sq_ring_ == MAP_FAILED || cq_ring_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+    if (sqes_ != MAP_FAILED) {
+      munmap(sqes_, sqes_size_);
+    }
+    if (cq_ring_ != MAP_FAILED && cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    if (sq_ring_ != MAP_FAILED) {
+      munmap(sq_ring_, sq_ring_size_);
+    }
+    sq_ring_ = cq_ring_ = sqes_ = nullptr;
+    close(ring_fd);
+    return false;
+  }
+  auto *sq = static_cast<char *>(sq_ring_);
+  auto *cq = static_cast<char *>(cq_ring_);
+  sq_tail_ = reinterpret_cast<uint32_t *>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<uint32_t *>(sq + params.sq_off.ring_mask);
+  sq_array_ = reinterpret_cast<uint32_t *>(sq + params.sq_off.array);
+  cq_head_ = reinterpret_cast<uint32_t *>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<uint32_t *>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<uint32_t *>(cq + params.cq_off.ring_mask);
+  cqes_ = cq + params.cq_off.cqes;
+  ring_fd_ = ring_fd;
+  return true;
+}
+
+void AsyncDiskManager::ReadPageAsync(page_id_t page_id, char *page_data, Callback callback) {
+  auto *request = new Request{true, page_id, page_data, std::move(callback)};
+  request->verify_ = true;
+  Submit({request});
+}
+
+void AsyncDiskManager::WritePageAsync(page_id_t page_id, const char *page_data, Callback callback) {
+  // The data is only read from, the pointer is shared with reads to keep a single request type.
+  Submit({new Request{false, page_id, const_cast<char *>(page_data), std::move(callback)}});
+}
+
+/**
+ * Lets a thread wait for a number of completions. The last one notifies under the latch, so the waiter can return and
+ * destroy the waiter as soon as it wakes up.
+ */
+class CompletionWaiter {
+ public:
+  explicit CompletionWaiter(size_t count) : remaining_(count) {}
+
+  void Done(bool ok) {
+    std::lock_guard<std::mutex> guard(latch_);
+    ok_ = ok_ && ok;
+    if (--remaining_ == 0) {
+      cv_.notify_all();
+    }
+  }
+
+  auto Wait() -> bool {
+    std::unique_lock<std::mutex> lock(latch_);
+    cv_.wait(lock, [this] { return remaining_ == 0; });
+    return ok_;
+  }
+
+ private:
+  std::mutex latch_;
+  std::condition_variable cv_;
+  size_t remaining_;
+  bool ok_{true};
+};
+
+void AsyncDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  CompletionWaiter waiter(1);
+  WritePageAsync(page_id, page_data, [&waiter](bool ok) { waiter.Done(ok); });
+  if (!waiter.Wait()) {
+    LOG_DEBUG("I/O error while writing");
+  }
+}
+
+void AsyncDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  CompletionWaiter waiter(1);
+  // VerifyChecksum below checks the page, so the request does not.
+  Submit({new Request{true, page_id, page_data, [&waiter](bool ok) { waiter.Done(ok); }}});
+  if (!waiter.Wait()) {
+    LOG_DEBUG("I/O error while reading");
+  }
+  VerifyChecksum(page_id, page_data);
+}
+
+void AsyncDiskManager::ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages) {
+  if (num_pages == 0) {
+    return;
+  }
+  CompletionWaiter waiter(num_pages);
+  std::vector<Request *> requests(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    requests[i] = new Request{true, page_ids[i], page_data[i], [&waiter](bool ok) { waiter.Done(ok); }};
+  }
+  Submit(requests);
+  if (!waiter.Wait()) {
+    LOG_DEBUG("I/O error while reading");
+  }
+  for (size_t i = 0; i < num_pages; i++) {
+    VerifyChecksum(page_ids[i], page_data[i]);
+  }
+}
+
+void AsyncDiskManager::WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages) {
+  std::vector<size_t> order(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [page_ids](size_t a, size_t b) { return page_ids[a] < page_ids[b]; });
+
+  std::vector<size_t> run_starts;
+  for (size_t i = 0; i < num_pages; i++) {
+    if (i == 0 || page_ids[order[i]] != page_ids[order[i - 1]] + 1 || i - run_starts.back() == IOV_MAX) {
+      run_starts.push_back(i);
+    }
+  }
+  if (run_starts.empty()) {
+    return;
+  }
+  CompletionWaiter waiter(run_starts.size());
+  std::vector<Request *> requests;
+  for (size_t r = 0; r < run_starts.size(); r++) {
+    size_t begin = run_starts[r];
+    size_t end = r + 1 < run_starts.size() ? run_starts[r + 1] : num_pages;
+    auto *request = new Request{false, page_ids[order[begin]], nullptr, [&waiter](bool ok) { waiter.Done(ok); }};
+    if (end - begin == 1) {
+      request->data_ = const_cast<char *>(page_data[order[begin]]);
+    } else {
+      for (size_t i = begin; i < end; i++) {
+        request->iovecs_.push_back({const_cast<char *>(page_data[order[i]]), PAGE_SIZE});
+      }
+    }
+    requests.push_back(request);
+  }
+  Submit(requests);
+  if (!waiter.Wait()) {
+    LOG_DEBUG("I/O error while writing");
+  }
+}
+
+void AsyncDiskManager::Sync() {
+  // Every write of the pages taken here was submitted, so WaitForAll covers them.
+  std::vector<page_id_t> unsynced_page_ids = TakeUnsyncedChecksums();
+  WaitForAll();
+  num_syncs_ += 1;
+  if (fdatasync(db_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  SyncSidecars(unsynced_page_ids);
+}
+
+auto AsyncDiskManager::TruncateFreeTail() -> size_t {
+  // a write still in flight could extend the file again after it was cut
+  WaitForAll();
+  return DiskManager::TruncateFreeTail();
+}
+
+void AsyncDiskManager::WaitForAll() {
+  std::unique_lock<std::mutex> lock(latch_);
+  completed_cv_.wait(lock, [this] { return in_flight_ == 0; });
+}
+
+void AsyncDiskManager::Submit(const std::vector<Request *> &requests) {
+  std::vector<page_id_t> write_page_ids;
+  for (auto *request : requests) {
+    if (!request->is_read_) {
+      for (size_t i = 0; i < NumPages(request); i++) {
+        request->checksums_.push_back(PageChecksum(DataAt(request, i * PAGE_SIZE)));
+        write_page_ids.push_back(request->page_id_ + static_cast<page_id_t>(i));
+      }
+    }
+    AlignBuffer(request);
+    if (!request->is_read_) {
+      ReserveSpace(request->page_id_ + static_cast<page_id_t>(NumPages(request)) - 1);
+    }
+  }
+  // Held until the writes count as in flight, so that a Sync either waits for them or leaves their pages unverified.
+  std::shared_lock<std::shared_mutex> epoch_guard(checksum_epoch_latch_, std::defer_lock);
+  if (!write_page_ids.empty()) {
+    epoch_guard.lock();
+    UnverifyChecksums(write_page_ids.data(), write_page_ids.size());
+  }
+  std::unique_lock<std::mutex> lock(latch_);
+  uint32_t prepared = 0;
+  auto enter = [this, &prepared] {
+    // Without SQPOLL the kernel consumes every prepared entry during the call, unless it is interrupted.
+    while (prepared > 0) {
+      int submitted = IoUringEnter(ring_fd_, prepared, 0, 0);
+      if (submitted < 0) {
+        if (errno == EINTR || errno == EAGAIN || errno == EBUSY) {
+          std::this_thread::yield();
+          continue;
+        }
+        throw Exception("io_uring_enter failed");
+      }
+      prepared -= static_cast<uint32_t>(submitted);
+    }
+  };
+  for (auto *request : requests) {
+    if (in_flight_ >= queue_depth_) {
+      enter();
+      completed_cv_.wait(lock, [this] { return in_flight_ < queue_depth_; });
+    }
+    in_flight_++;
+    if (ring_fd_ < 0) {
+      pending_.push_back(request);
+      pending_cv_.notify_one();
+      continue;
+    }
+    uint32_t tail = *sq_tail_;
+    uint32_t index = tail & *sq_mask_;
+    auto *sqe = &static_cast<io_uring_sqe *>(sqes_)[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = db_fd_;
+    sqe->off = static_cast<uint64_t>(request->page_id_) * PAGE_SIZE;
+    if (IsVectored(request)) {
+      sqe->opcode = IORING_OP_WRITEV;
+      sqe->addr = reinterpret_cast<uint64_t>(request->iovecs_.data());
+      sqe->len = request->iovecs_.size();
+    } else {
+      sqe->opcode = request->is_read_ ? IORING_OP_READ : IORING_OP_WRITE;
+      sqe->addr = reinterpret_cast<uint64_t>(DataAt(request, 0));
+      sqe->len = NumPages(request) * PAGE_SIZE;
+    }
+    sqe->user_data = reinterpret_cast<uint64_t>(request);
+    sq_array_[index] = index;
+    __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+    prepared++;
+  }
+  enter();
+}
+
+void AsyncDiskManager::Complete(Request *request, int64_t result) {
+  bool ok = result >= 0;
+  auto size = static_cast<int64_t>(NumPages(request) * PAGE_SIZE);
+  if (!ok) {
+    LOG_DEBUG("I/O error on page %d: %s", request->page_id_, strerror(static_cast<int>(-result)));
+  } else if (result < size) {
+    if (request->is_read_) {
+      // The file ends before the page does.
+      memset(DataAt(request, result), 0, size - result);
+    } else {
+      // A short write, finish it in place one page piece at a time.
+      while (ok && result < size) {
+        ssize_t written = pwrite(db_fd_, DataAt(request, result), PAGE_SIZE - result % PAGE_SIZE,
+                                 static_cast<off_t>(request->page_id_) * PAGE_SIZE + result);
+        ok = written > 0;
+        result += written;
+      }
+    }
+  }
+  if (request->bounce_ != nullptr) {
+    if (request->is_read_) {
+      memcpy(request->data_, request->bounce_, PAGE_SIZE);
+    }
+    free(request->bounce_);
+  }
+  if (request->is_read_) {
+    num_reads_ += 1;
+    if (ok && request->verify_) {
+      ok = CheckChecksum(request->page_id_, request->data_);
+    }
+  } else {
+    num_writes_ += static_cast<int>(NumPages(request));
+    if (ok) {
+      StoreChecksums(request->page_id_, request->checksums_.data(), request->checksums_.size());
+    }
+  }
+  if (request->callback_) {
+    request->callback_(ok);
+  }
+  delete request;
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    in_flight_--;
+  }
+  completed_cv_.notify_all();
+}
+
+void AsyncDiskManager::RunCompletions() {
+  std::vector<io_uring_cqe> cqes;
+  bool stop = false;
+  while (!stop) {
+    if (IoUringEnter(ring_fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      LOG_WARN("io_uring_enter failed while waiting for completions: %s", strerror(errno));
+    }
+    // Copy the entries out and release them first, so that callbacks may submit new requests.
+    uint32_t head = __atomic_load_n(cq_head_, __ATOMIC_RELAXED);
+    uint32_t tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+    cqes.clear();
+    for (; head != tail; head++) {
+      cqes.push_back(static_cast<io_uring_cqe *>(cqes_)[head & *cq_mask_]);
+    }
+    __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+    for (const auto &cqe : cqes) {
+      if (cqe.user_data == 0) {
+        // The no-op submitted by Stop.
+        stop = true;
+        continue;
+      }
+      Complete(reinterpret_cast<Request *>(cqe.user_data), cqe.res);
+    }
+  }
+}
+
+void AsyncDiskManager::RunWorker() {
+  std::unique_lock<std::mutex> lock(latch_);
+  while (true) {
+    pending_cv_.wait(lock, [this] { return stopping_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      return;
+    }
+    Request *request = pending_.front();
+    pending_.pop_front();
+    lock.unlock();
+    off_t offset = static_cast<off_t>(request->page_id_) * PAGE_SIZE;
+    ssize_t result;
+    if (IsVectored(request)) {
+      result = pwritev(db_fd_, request->iovecs_.data(), static_cast<int>(request->iovecs_.size()), offset);
+    } else if (request->is_read_) {
+      result = pread(db_fd_, DataAt(request, 0), PAGE_SIZE, offset);
+    } else {
+      result = pwrite(db_fd_, DataAt(request, 0), NumPages(request) * PAGE_SIZE, offset);
+    }
+    Complete(request, result < 0 ? -errno : result);
+    lock.lock();
+  }
+}
+
+void AsyncDiskManager::Stop() {
+  if (threads_.empty()) {
+    return;
+  }
+  WaitForAll();
+  {
+    std::lock_guard<std::mutex> guard(latch_);
+    stopping_ = true;
+    if (ring_fd_ >= 0) {
+      uint32_t tail = *sq_tail_;
+      uint32_t index = tail & *sq_mask_;
+      auto *sqe = &static_cast<io_uring_sqe *>(sqes_)[index];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_NOP;
+      sqe->user_data = 0;
+      sq_array_[index] = index;
+      __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+      while (IoUringEnter(ring_fd_, 1, 0, 0) < 0 && errno == EINTR) {
+      }
+    }
+  }
+  pending_cv_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+  threads_.clear();
+  if (ring_fd_ >= 0) {
+    munmap(sqes_, sqes_size_);
+    if (cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+    ring_fd_ = -1;
+  }
+  close(db_fd_);
+  db_fd_ = -1;
+}
+
+}  // namespace bustub
@@ -0,0 +1,319 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager.cpp
+//
+// Identification: src/storage/disk/compressed_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_disk_manager.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <utility>
+
+#include "common/exception.h"
+#include "common/logger.h"
+#include "common/util/lz_codec.h"
+
+namespace bustub {
+
+static constexpr uint32_t EXTENT_TABLE_MAGIC = 0x32585442;  // "BTX2"
+static constexpr size_t EXTENT_TABLE_HEADER_SIZE = 16;
+
+/** A table entry as stored in the sidecar, see the class comment. */
+struct ExtentTableEntry {
+  uint64_t sector_;
+  uint32_t size_;
+  uint32_t reserved_;
+};
+static_assert(sizeof(ExtentTableEntry) == 16, "a table entry must not span two disk sectors");
+
+CompressedDiskManager::CompressedDiskManager(const std::string &db_file)
+    : DiskManager(db_file), free_extents_(SECTORS_PER_PAGE + 1) {
+  table_name_ = db_file.substr(0, db_file.rfind('.')) + ".ext";
+  struct stat stat_buf;
+  if (sync_fd_ >= 0 && fstat(sync_fd_, &stat_buf) == 0 && stat_buf.st_size == 0) {
+    // a new extent file; a table left behind belongs to a file that is gone
+    table_fd_ = open(table_name_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    char header[EXTENT_TABLE_HEADER_SIZE] = {0};
+    memcpy(header, &EXTENT_TABLE_MAGIC, sizeof(EXTENT_TABLE_MAGIC));
+    if (table_fd_ < 0 || pwrite(table_fd_, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header))) {
+      throw Exception("can't create extent table " + table_name_);
+    }
+    return;
+  }
+  table_fd_ = open(table_name_.c_str(), O_RDWR);
+  LoadTable();
+}
+
+CompressedDiskManager::~CompressedDiskManager() {
+  if (table_fd_ >= 0) {
+    close(table_fd_);
+  }
+}
+
+void CompressedDiskManager::ShutDown() {
+  if (sync_fd_ >= 0) {
+    Sync();
+  }
+  if (table_fd_ >= 0) {
+    close(table_fd_);
+    table_fd_ = -1;
+  }
+  DiskManager::ShutDown();
+}
+
+void CompressedDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  char compressed[LzCodec::MaxCompressedSize(PAGE_SIZE)];
+  size_t size = LzCodec::Compress(page_data, PAGE_SIZE, compressed, sizeof(compressed));
+  const char *data = compressed;
+  if (size == 0 || SectorsFor(size) >= SECTORS_PER_PAGE) {
+    // not worth it: store the page as is
+    size = PAGE_SIZE;
+    data = page_data;
+    uncompressed_writes_++;
+  }
+  uint32_t checksum = PageChecksum(page_data);
+  std::shared_lock<std::shared_mutex> epoch_guard(checksum_epoch_latch_);
+  UnverifyChecksums(&page_id, 1);
+  std::scoped_lock scoped_extent_latch(extent_latch_);
+  Extent extent = PlaceExtent(page_id, size);
+  num_writes_ += 1;
+  if (pwrite(sync_fd_, data, size, static_cast<off_t>(extent.sector_ * COMPRESSED_SECTOR_SIZE)) !=
+      static_cast<ssize_t>(size)) {
+    LOG_DEBUG("I/O error while writing");
+    return;
+  }
+  StoreChecksums(page_id, &checksum, 1);
+}
+
+void CompressedDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  char compressed[PAGE_SIZE];
+  Extent extent{0, 0};
+  {
+    std::scoped_lock scoped_extent_latch(extent_latch_);
+    num_reads_ += 1;
+    if (page_id >= 0 && static_cast<size_t>(page_id) < table_.size()) {
+      extent = table_[page_id];
+    }
+    if (extent.size_ != 0 && pread(sync_fd_, extent.size_ == PAGE_SIZE ? page_data : compressed, extent.size_,
+                                   static_cast<off_t>(extent.sector_ * COMPRESSED_SECTOR_SIZE)) !=
+                                 static_cast<ssize_t>(extent.size_)) {
+      LOG_DEBUG("I/O error while reading");
+      extent.size_ = 0;
+    }
+  }
+  if (extent.size_ == 0) {
+    // never written
+    memset(page_data, 0, PAGE_SIZE);
+  } else if (extent.size_ != PAGE_SIZE &&
+             LzCodec::Decompress(compressed, extent.size_, page_data, PAGE_SIZE) != PAGE_SIZE) {
+    checksum_failures_++;
+    throw Exception(ExceptionType::CORRUPTION, "page " + std::to_string(page_id) + " does not decompress");
+  }
+  VerifyChecksum(page_id, page_data);
+}
+
+void CompressedDiskManager::ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages) {
+  for (size_t i = 0; i < num_pages; i++) {
+    ReadPage(page_ids[i], page_data[i]);
+  }
+}
+
+void CompressedDiskManager::WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages) {
+  for (size_t i = 0; i < num_pages; i++) {
+    WritePage(page_ids[i], page_data[i]);
+  }
+}
+
+void CompressedDiskManager::Sync() {
+  std::scoped_lock scoped_sync_latch(table_sync_latch_);
+  std::vector<page_id_t> unsynced_page_ids = TakeUnsyncedChecksums();
+  std::vector<std::pair<page_id_t, Extent>> entries;
+  std::vector<Extent> freed;
+  {
+    std::scoped_lock scoped_extent_latch(extent_latch_);
+    entries.reserve(dirty_entries_.size());
+    for (auto page_id : dirty_entries_) {
+      entries.emplace_back(page_id, table_[page_id]);
+    }
+    dirty_entries_.clear();
+    freed.swap(pending_free_);
+  }
+  num_syncs_ += 1;
+  // the extents must be durable before the entries pointing at them are
+  if (fdatasync(sync_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  if (!SaveEntries(entries)) {
+    // keep the freed extents, the table on disk may still point at them, and retry the entries on the next Sync
+    std::scoped_lock scoped_extent_latch(extent_latch_);
+    for (const auto &entry : entries) {
+      MarkDirty(entry.first);
+    }
+    pending_free_.insert(pending_free_.end(), freed.begin(), freed.end());
+    return;
+  }
+  SyncSidecars(unsynced_page_ids);
+  std::scoped_lock scoped_extent_latch(extent_latch_);
+  for (const auto &extent : freed) {
+    FreeExtent(extent);
+  }
+}
+
+auto CompressedDiskManager::GetNumPages() -> size_t {
+  std::scoped_lock scoped_extent_latch(extent_latch_);
+  size_t num_pages = table_.size();
+  while (num_pages > 0 && table_[num_pages - 1].size_ == 0) {
+    num_pages--;
+  }
+  return num_pages;
+}
+
+auto CompressedDiskManager::TruncateFreeTail() -> size_t {
+  std::vector<page_id_t> freed;
+  {
+    std::scoped_lock scoped_latches(extent_latch_, free_latch_);
+    for (size_t page_id = 0; page_id < table_.size(); page_id++) {
+      if (table_[page_id].size_ != 0 && free_page_map_.IsFree(static_cast<page_id_t>(page_id))) {
+        pending_free_.push_back(table_[page_id]);
+        table_[page_id] = {0, 0};
+        MarkDirty(static_cast<page_id_t>(page_id));
+        freed.push_back(static_cast<page_id_t>(page_id));
+      }
+    }
+  }
+  // the pages read as zeros from now on, which have no checksum
+  const uint32_t no_checksum = 0;
+  std::shared_lock<std::shared_mutex> epoch_guard(checksum_epoch_latch_);
+  UnverifyChecksums(freed.data(), freed.size());
+  for (auto page_id : freed) {
+    StoreChecksums(page_id, &no_checksum, 1);
+  }
+  return freed.size();
+}
+
+auto CompressedDiskManager::GetStoredBytes() -> size_t {
+  std::scoped_lock scoped_extent_latch(extent_latch_);
+  size_t bytes = 0;
+  for (const auto &extent : table_) {
+    bytes += extent.size_;
+  }
+  return bytes;
+}
+
+auto CompressedDiskManager::PlaceExtent(page_id_t page_id, size_t size) -> Extent {
+  auto index = static_cast<size_t>(page_id);
+  if (table_.size() <= index) {
+    table_.resize(index + 1, {0, 0});
+  }
+  Extent old = table_[index];
+  size_t sectors = SectorsFor(size);
+  Extent extent{0, static_cast<uint32_t>(size)};
+  // never in place: until the next Sync, the persisted table may point at the old extent
+  // the smallest free extent that is large enough, split if it is larger
+  size_t found = sectors;
+  while (found <= SECTORS_PER_PAGE && free_extents_[found].empty()) {
+    found++;
+  }
+  if (found <= SECTORS_PER_PAGE) {
+    extent.sector_ = free_extents_[found].back();
+    free_extents_[found].pop_back();
+    if (found > sectors) {
+      free_extents_[found - sectors].push_back(extent.sector_ + sectors);
+    }
+  } else {
+    extent.sector_ = end_sector_;
+    end_sector_ += sectors;
+  }
+  if (old.size_ != 0) {
+    pending_free_.push_back(old);
+  }
+  table_[index] = extent;
+  MarkDirty(page_id);
+  return extent;
+}
+
+void CompressedDiskManager::FreeExtent(const Extent &extent) {
+  free_extents_[SectorsFor(extent.size_)].push_back(extent.sector_);
+}
+
+auto CompressedDiskManager::SaveEntries(const std::vector<std::pair<page_id_t, Extent>> &entries) -> bool {
+  // one write per run of consecutive page ids; the entries come sorted
+  std::vector<ExtentTableEntry> run;
+  size_t begin = 0;
+  while (begin < entries.size()) {
+    size_t end = begin + 1;
+    while (end < entries.size() && entries[end].first == entries[end - 1].first + 1) {
+      end++;
+    }
+    run.clear();
+    for (size_t i = begin; i < end; i++) {
+      run.push_back({entries[i].second.sector_, entries[i].second.size_, 0});
+    }
+    size_t bytes = run.size() * sizeof(ExtentTableEntry);
+    auto offset = static_cast<off_t>(EXTENT_TABLE_HEADER_SIZE + entries[begin].first * sizeof(ExtentTableEntry));
+    if (pwrite(table_fd_, run.data(), bytes, offset) != static_cast<ssize_t>(bytes)) {
+      LOG_WARN("failed to write extent table %s", table_name_.c_str());
+      return false;
+    }
+    begin = end;
+  }
+  if (!entries.empty() && fdatasync(table_fd_) != 0) {
+    LOG_WARN("failed to sync extent table %s", table_name_.c_str());
+    return false;
+  }
+  return true;
+}
+
+void CompressedDiskManager::LoadTable() {
+  struct stat stat_buf;
+  if (table_fd_ < 0 || fstat(table_fd_, &stat_buf) != 0) {
+    throw Exception("can't open extent table " + table_name_ + " of a compressed db file");
+  }
+  auto file_size = static_cast<size_t>(stat_buf.st_size);
+  uint32_t magic = 0;
+  if (file_size < EXTENT_TABLE_HEADER_SIZE || pread(table_fd_, &magic, sizeof(magic), 0) != sizeof(magic) ||
+      magic != EXTENT_TABLE_MAGIC) {
+    throw Exception(table_name_ + " is not an extent table");
+  }
+  // a crash while the table grew may have left part of an entry behind, for a page whose write was not synced
+  size_t count = (file_size - EXTENT_TABLE_HEADER_SIZE) / sizeof(ExtentTableEntry);
+  std::vector<ExtentTableEntry> stored(count);
+  size_t bytes = count * sizeof(ExtentTableEntry);
+  if (bytes > 0 && pread(table_fd_, stored.data(), bytes, EXTENT_TABLE_HEADER_SIZE) != static_cast<ssize_t>(bytes)) {
+    throw Exception("can't read extent table " + table_name_);
+  }
+  table_.resize(count);
+  for (size_t i = 0; i < count; i++) {
+    table_[i] = {stored[i].sector_, stored[i].size_};
+  }
+
+  // Whatever lies between the used extents is free.
+  std::vector<std::pair<uint64_t, uint64_t>> used;
+  for (const auto &extent : table_) {
+    if (extent.size_ != 0) {
+      used.emplace_back(extent.sector_, extent.sector_ + SectorsFor(extent.size_));
+    }
+  }
+  std::sort(used.begin(), used.end());
+  uint64_t sector = 0;
+  for (const auto &[begin, end] : used) {
+    for (; sector < begin; sector += std::min<uint64_t>(SECTORS_PER_PAGE, begin - sector)) {
+      free_extents_[std::min<uint64_t>(SECTORS_PER_PAGE, begin - sector)].push_back(sector);
+    }
+    sector = std::max(sector, end);
+  }
+  end_sector_ = sector;
+}
+
+}  // namespace bustub
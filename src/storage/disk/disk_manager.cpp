@@ -10,34 +10,60 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <fcntl.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
 #include <cassert>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
 #include <cstring>
 #include <iostream>
-#include <mutex>  // NOLINT
+#include <mutex>         // NOLINT
+#include <shared_mutex>  // NOLINT
 #include <string>
 #include <thread>  // NOLINT
+#include <vector>
 
 #include "common/exception.h"
 #include "common/logger.h"
+#include "common/util/crc32c.h"
 #include "storage/disk/disk_manager.h"
 
 namespace bustub {
 
 static char *buffer_used;
+// bytes before the first entry of the checksum sidecar, which hold the id of the boot that has it open
+static constexpr size_t CHECKSUM_HEADER_SIZE = 64;
 
 /**
  * Constructor: open/create a single database file & log file
  * @input db_file: database file name
  */
-DiskManager::DiskManager(const std::string &db_file)
-    : file_name_(db_file), num_flushes_(0), num_writes_(0), flush_log_(false), flush_log_f_(nullptr) {
+DiskManager::DiskManager(const std::string &db_file, bool read_only)
+    : file_name_(db_file),
+      num_flushes_(0),
+      num_writes_(0),
+      num_reads_(0),
+      read_only_(read_only),
+      flush_log_(false),
+      flush_log_f_(nullptr) {
   std::string::size_type n = file_name_.rfind('.');
   if (n == std::string::npos) {
     LOG_DEBUG("wrong file format");
     return;
   }
   log_name_ = file_name_.substr(0, n) + ".log";
+  free_map_name_ = file_name_.substr(0, n) + ".fsm";
+  checksum_name_ = file_name_.substr(0, n) + ".crc";
+  buffer_used = nullptr;
+  if (read_only_) {
+    OpenReadOnly();
+    return;
+  }
 
   log_io_.open(log_name_, std::ios::binary | std::ios::in | std::ios::app | std::ios::out);
   // directory or file does not exist
@@ -55,8 +81,12 @@ DiskManager::DiskManager(const std::string &db_file)
 
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
   db_io_.open(db_file, std::ios::binary | std::ios::in | std::ios::out);
-  // directory or file does not exist
-  if (!db_io_.is_open()) {
+  bool db_file_is_new = !db_io_.is_open();
+  if (!db_file_is_new) {
+    free_page_map_.Read(free_map_name_);
+  } else {
+    // directory or file does not exist; a free page map left behind belongs to a file that is gone
+    std::remove(free_map_name_.c_str());
     db_io_.clear();
     // create a new file
     db_io_.open(db_file, std::ios::binary | std::ios::trunc | std::ios::out);
@@ -67,16 +97,145 @@ DiskManager::DiskManager(const std::string &db_file)
       throw Exception("can't open db file");
     }
   }
-  buffer_used = nullptr;
+  sync_fd_ = open(db_file.c_str(), O_RDWR);
+  OpenChecksumFile(db_file_is_new);
+}
+
+/**
+ * Open the checksum sidecar and load every checksum into memory, 4 bytes per page after the header
+ */
+void DiskManager::OpenChecksumFile(bool db_file_is_new) {
+  if (db_file_is_new) {
+    // checksums left behind belong to a file that is gone
+    std::remove(checksum_name_.c_str());
+  }
+  checksum_fd_ = read_only_ ? open(checksum_name_.c_str(), O_RDONLY)
+                            : open(checksum_name_.c_str(), O_RDWR | O_CREAT, 0644);
+  if (checksum_fd_ < 0) {
+    if (!read_only_) {
+      LOG_WARN("can't open %s, pages are not checksummed: %s", checksum_name_.c_str(), strerror(errno));
+    }
+    return;
+  }
+  struct stat stat_buf;
+  if (fstat(checksum_fd_, &stat_buf) != 0) {
+    return;
+  }
+  auto file_size = static_cast<size_t>(stat_buf.st_size);
+  char header[CHECKSUM_HEADER_SIZE] = {};
+  if (file_size >= CHECKSUM_HEADER_SIZE && pread(checksum_fd_, header, sizeof(header), 0) == sizeof(header)) {
+    std::string owner(header, strnlen(header, sizeof(header)));
+    // Left open by this boot, the process died but the kernel kept all of the sidecar's writes.
+    checksums_may_be_stale_ = !owner.empty() && (owner != BootId() || owner == "unknown");
+    if (checksums_may_be_stale_) {
+      LOG_WARN("%s was not shut down before a reboot, pages not matching their checksums are unverified",
+               file_name_.c_str());
+    }
+  }
+  checksums_.resize(file_size >= CHECKSUM_HEADER_SIZE ? (file_size - CHECKSUM_HEADER_SIZE) / sizeof(uint32_t) : 0);
+  size_t size = checksums_.size() * sizeof(uint32_t);
+  if (size > 0 && pread(checksum_fd_, checksums_.data(), size, CHECKSUM_HEADER_SIZE) != static_cast<ssize_t>(size)) {
+    LOG_WARN("failed to read %s, pages are not verified", checksum_name_.c_str());
+    checksums_.assign(checksums_.size(), 0);
+  }
+  if (!read_only_) {
+    std::scoped_lock scoped_checksum_latch(checksum_latch_);
+    WriteChecksumHeader(BootId());
+  }
+}
+
+void DiskManager::WriteChecksumHeader(const std::string &boot_id) {
+  char header[CHECKSUM_HEADER_SIZE] = {};
+  memcpy(header, boot_id.data(), std::min(boot_id.size(), sizeof(header) - 1));
+  if (pwrite(checksum_fd_, header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+      fdatasync(checksum_fd_) != 0) {
+    LOG_DEBUG("I/O error while writing the checksum header");
+  }
+}
+
+auto DiskManager::BootId() -> std::string {
+  static const std::string boot_id = [] {
+    std::ifstream boot_id_file("/proc/sys/kernel/random/boot_id");
+    std::string id;
+    if (!std::getline(boot_id_file, id) || id.empty()) {
+      id = "unknown";
+    }
+    return id;
+  }();
+  return boot_id;
+}
+
+/**
+ * Open an existing db file for reading only and map it; no log file is created
+ */
+void DiskManager::OpenReadOnly() {
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  db_io_.open(file_name_, std::ios::binary | std::ios::in);
+  sync_fd_ = open(file_name_.c_str(), O_RDONLY);
+  if (!db_io_.is_open() || sync_fd_ < 0) {
+    throw Exception("can't open db file read-only");
+  }
+  OpenChecksumFile(false);
+  struct stat stat_buf;
+  if (fstat(sync_fd_, &stat_buf) != 0 || stat_buf.st_size < PAGE_SIZE) {
+    // nothing to map; every page reads as zeros
+    return;
+  }
+  size_t mapping_size = static_cast<size_t>(stat_buf.st_size) / PAGE_SIZE * PAGE_SIZE;
+  void *mapping = mmap(nullptr, mapping_size, PROT_READ, MAP_SHARED, sync_fd_, 0);
+  if (mapping == MAP_FAILED) {
+    LOG_WARN("failed to map %s, pages are copied instead: %s", file_name_.c_str(), strerror(errno));
+    return;
+  }
+  mapping_ = static_cast<char *>(mapping);
+  mapping_size_ = mapping_size;
+}
+
+DiskManager::~DiskManager() {
+  if (mapping_ != nullptr) {
+    munmap(mapping_, mapping_size_);
+  }
+  if (sync_fd_ >= 0) {
+    close(sync_fd_);
+  }
+  if (checksum_fd_ >= 0) {
+    close(checksum_fd_);
+  }
 }
 
 /**
  * Close all file streams
  */
 void DiskManager::ShutDown() {
+  // The checksums written since the last Sync go to the sidecar, after the pages they describe are durable.
+  std::vector<page_id_t> unsynced_page_ids = TakeUnsyncedChecksums();
+  if (!unsynced_page_ids.empty() && sync_fd_ >= 0 && fdatasync(sync_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  SyncSidecars(unsynced_page_ids);
   {
     std::scoped_lock scoped_db_io_latch(db_io_latch_);
     db_io_.close();
+    if (mapping_ != nullptr) {
+      munmap(mapping_, mapping_size_);
+      mapping_ = nullptr;
+      mapping_size_ = 0;
+    }
+    if (sync_fd_ >= 0) {
+      close(sync_fd_);
+      sync_fd_ = -1;
+    }
+  }
+  {
+    std::scoped_lock scoped_checksum_latch(checksum_latch_);
+    if (checksum_fd_ >= 0) {
+      // every entry is current now
+      if (!read_only_) {
+        WriteChecksumHeader("");
+      }
+      close(checksum_fd_);
+      checksum_fd_ = -1;
+    }
   }
   log_io_.close();
 }
@@ -85,19 +244,21 @@ void DiskManager::ShutDown() {
  * Write the contents of the specified page into disk file
  */
 void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  if (read_only_) {
+    throw Exception("can't write a page, the db file is open read-only");
+  }
+  uint32_t checksum = PageChecksum(page_data);
+  ReserveSpace(page_id);
+  std::shared_lock<std::shared_mutex> epoch_guard(checksum_epoch_latch_);
+  UnverifyChecksums(&page_id, 1);
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  size_t offset = static_cast<size_t>(page_id) * PAGE_SIZE;
-  // set write cursor to offset
   num_writes_ += 1;
-  db_io_.seekp(offset);
-  db_io_.write(page_data, PAGE_SIZE);
-  // check for I/O error
-  if (db_io_.bad()) {
+  // the write goes straight to the file, and Sync makes it durable
+  if (!WriteRun(page_id, &page_data, 1)) {
     LOG_DEBUG("I/O error while writing");
     return;
   }
-  // needs to flush to keep disk file in sync
-  db_io_.flush();
+  StoreChecksums(page_id, &checksum, 1);
 }
 
 /**
@@ -105,28 +266,354 @@ void DiskManager::WritePage(page_id_t page_id, const char *page_data) {
  */
 void DiskManager::ReadPage(page_id_t page_id, char *page_data) {
   std::scoped_lock scoped_db_io_latch(db_io_latch_);
-  int offset = page_id * PAGE_SIZE;
+  ReadRun(page_id, 1, page_data);
+}
+
+/**
+ * Read several pages, coalescing runs of consecutive page ids into one read each
+ */
+void DiskManager::ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages) {
+  std::vector<size_t> order(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [page_ids](size_t a, size_t b) { return page_ids[a] < page_ids[b]; });
+
+  std::vector<char> run_buffer;
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  size_t begin = 0;
+  while (begin < num_pages) {
+    size_t end = begin + 1;
+    while (end < num_pages && page_ids[order[end]] == page_ids[order[end - 1]] + 1) {
+      end++;
+    }
+    if (end - begin == 1) {
+      ReadRun(page_ids[order[begin]], 1, page_data[order[begin]]);
+    } else {
+      run_buffer.resize((end - begin) * PAGE_SIZE);
+      ReadRun(page_ids[order[begin]], end - begin, run_buffer.data());
+      for (size_t i = begin; i < end; i++) {
+        memcpy(page_data[order[i]], run_buffer.data() + (i - begin) * PAGE_SIZE, PAGE_SIZE);
+      }
+    }
+    begin = end;
+  }
+}
+
+/**
+ * Write several pages, coalescing runs of consecutive page ids into one pwritev each
+ */
+void DiskManager::WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages) {
+  std::vector<size_t> order(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    order[i] = i;
+  }
+  std::sort(order.begin(), order.end(), [page_ids](size_t a, size_t b) { return page_ids[a] < page_ids[b]; });
+
+  if (num_pages == 0) {
+    return;
+  }
+  if (read_only_) {
+    throw Exception("can't write a page, the db file is open read-only");
+  }
+  std::vector<uint32_t> checksums(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    checksums[i] = PageChecksum(page_data[order[i]]);
+  }
+  ReserveSpace(page_ids[order.back()]);
+  std::shared_lock<std::shared_mutex> epoch_guard(checksum_epoch_latch_);
+  UnverifyChecksums(page_ids, num_pages);
+  std::vector<const char *> run_data(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    run_data[i] = page_data[order[i]];
+  }
+  std::scoped_lock scoped_db_io_latch(db_io_latch_);
+  size_t begin = 0;
+  while (begin < num_pages) {
+    size_t end = begin + 1;
+    while (end < num_pages && page_ids[order[end]] == page_ids[order[end - 1]] + 1) {
+      end++;
+    }
+    if (!WriteRun(page_ids[order[begin]], run_data.data() + begin, end - begin)) {
+      LOG_DEBUG("I/O error while writing");
+      return;
+    }
+    StoreChecksums(page_ids[order[begin]], checksums.data() + begin, end - begin);
+    begin = end;
+  }
+  num_writes_ += static_cast<int>(num_pages);
+}
+
+/**
+ * Make the pages written so far durable
+ */
+void DiskManager::Sync() {
+  std::vector<page_id_t> unsynced_page_ids = TakeUnsyncedChecksums();
+  num_syncs_ += 1;
+  if (sync_fd_ >= 0 && fdatasync(sync_fd_) != 0) {
+    LOG_DEBUG("I/O error while syncing");
+  }
+  SyncSidecars(unsynced_page_ids);
+}
+
+void DiskManager::SyncSidecars(const std::vector<page_id_t> &page_ids) {
+  {
+    std::scoped_lock scoped_checksum_latch(checksum_latch_);
+    if (checksum_fd_ >= 0 && !read_only_) {
+      std::vector<page_id_t> sorted_page_ids = page_ids;
+      std::sort(sorted_page_ids.begin(), sorted_page_ids.end());
+      // one write per run of consecutive entries; a page written again since the Sync started keeps its 0
+      auto written = [this](page_id_t page_id) {
+        return static_cast<size_t>(page_id) < checksums_.size() && unsynced_checksums_.count(page_id) == 0;
+      };
+      size_t begin = 0;
+      while (begin < sorted_page_ids.size()) {
+        if (!written(sorted_page_ids[begin])) {
+          begin++;
+          continue;
+        }
+        size_t end = begin + 1;
+        while (end < sorted_page_ids.size() && sorted_page_ids[end] == sorted_page_ids[end - 1] + 1 &&
+               written(sorted_page_ids[end])) {
+          end++;
+        }
+        auto first = static_cast<size_t>(sorted_page_ids[begin]);
+        if (pwrite(checksum_fd_, checksums_.data() + first, (end - begin) * sizeof(uint32_t),
+                   static_cast<off_t>(CHECKSUM_HEADER_SIZE + first * sizeof(uint32_t))) < 0) {
+          LOG_DEBUG("I/O error while writing checksums");
+        }
+        begin = end;
+      }
+      if (fdatasync(checksum_fd_) != 0) {
+        LOG_DEBUG("I/O error while syncing checksums");
+      }
+    }
+  }
+  SaveFreePageMap();
+}
+
+auto DiskManager::PageChecksum(const char *page_data) -> uint32_t {
+  uint32_t checksum = Crc32cUtil::Compute(page_data, PAGE_SIZE);
+  return checksum == 0 ? 1 : checksum;
+}
+
+void DiskManager::UnverifyChecksums(const page_id_t *page_ids, size_t num_pages) {
+  std::scoped_lock scoped_checksum_latch(checksum_latch_);
+  if (checksum_fd_ < 0) {
+    return;
+  }
+  // An entry outside the set matches the sidecar, so only a nonzero one has to be zeroed on disk. The zero is not
+  // synced; the header covers a power loss, see the class comment.
+  const uint32_t no_checksum = 0;
+  for (size_t i = 0; i < num_pages; i++) {
+    auto index = static_cast<size_t>(page_ids[i]);
+    if (!unsynced_checksums_.insert(page_ids[i]).second || index >= checksums_.size() || checksums_[index] == 0) {
+      continue;
+    }
+    if (pwrite(checksum_fd_, &no_checksum, sizeof(no_checksum),
+               static_cast<off_t>(CHECKSUM_HEADER_SIZE + index * sizeof(uint32_t))) < 0) {
+      LOG_DEBUG("I/O error while writing checksums");
+    }
+  }
+}
+
+void DiskManager::StoreChecksums(page_id_t first_page_id, const uint32_t *checksums, size_t num_pages) {
+  std::scoped_lock scoped_checksum_latch(checksum_latch_);
+  auto first = static_cast<size_t>(first_page_id);
+  if (checksums_.size() < first + num_pages) {
+    checksums_.resize(first + num_pages, 0);
+  }
+  memcpy(checksums_.data() + first, checksums, num_pages * sizeof(uint32_t));
+}
+
+auto DiskManager::TakeUnsyncedChecksums() -> std::vector<page_id_t> {
+  std::unique_lock<std::shared_mutex> epoch_guard(checksum_epoch_latch_);
+  std::scoped_lock scoped_checksum_latch(checksum_latch_);
+  std::vector<page_id_t> page_ids(unsynced_checksums_.begin(), unsynced_checksums_.end());
+  unsynced_checksums_.clear();
+  return page_ids;
+}
+
+auto DiskManager::CheckChecksum(page_id_t page_id, const char *page_data) -> bool {
+  if (!verify_checksums_) {
+    return true;
+  }
+  uint32_t expected;
+  {
+    std::scoped_lock scoped_checksum_latch(checksum_latch_);
+    auto index = static_cast<size_t>(page_id);
+    expected = index < checksums_.size() ? checksums_[index] : 0;
+  }
+  uint32_t checksum = PageChecksum(page_data);
+  if (expected == 0 || checksum == expected) {
+    return true;
+  }
+  if (checksums_may_be_stale_) {
+    // The entry may be older than the page, see the class comment; the next Sync stores the page's checksum.
+    LOG_WARN("page %d does not match a checksum from before a reboot, it is unverified", page_id);
+    std::scoped_lock scoped_checksum_latch(checksum_latch_);
+    auto index = static_cast<size_t>(page_id);
+    if (index < checksums_.size() && checksums_[index] == expected) {
+      checksums_[index] = checksum;
+      unsynced_checksums_.insert(page_id);
+    }
+    return true;
+  }
+  checksum_failures_++;
+  LOG_WARN("page %d does not match its checksum", page_id);
+  return false;
+}
+
+void DiskManager::VerifyChecksum(page_id_t page_id, const char *page_data) {
+  if (!CheckChecksum(page_id, page_data)) {
+    throw Exception(ExceptionType::CORRUPTION, "page " + std::to_string(page_id) + " does not match its checksum");
+  }
+}
+
+void DiskManager::DeallocatePage(page_id_t page_id) {
+  std::scoped_lock scoped_free_latch(free_latch_);
+  free_page_map_.Free(page_id);
+}
+
+auto DiskManager::AllocateFreePage(uint32_t stride, uint32_t offset, tablespace_id_t tablespace_id) -> page_id_t {
+  if (tablespace_id != DEFAULT_TABLESPACE_ID) {
+    return INVALID_PAGE_ID;
+  }
+  std::scoped_lock scoped_free_latch(free_latch_);
+  return free_page_map_.Allocate(stride, offset);
+}
+
+auto DiskManager::GetNumFreePages() -> size_t {
+  std::scoped_lock scoped_free_latch(free_latch_);
+  return free_page_map_.Size();
+}
+
+auto DiskManager::IsFreePage(page_id_t page_id) -> bool {
+  std::scoped_lock scoped_free_latch(free_latch_);
+  return free_page_map_.IsFree(page_id);
+}
+
+/**
+ * Cut the trailing free pages off the file
+ */
+auto DiskManager::TruncateFreeTail() -> size_t {
+  std::scoped_lock scoped_latches(free_latch_, reserve_latch_, db_io_latch_);
+  size_t num_pages = GetNumPages();
+  size_t new_num_pages = free_page_map_.TrailingFreeStart(num_pages);
+  if (new_num_pages == num_pages || sync_fd_ < 0) {
+    return 0;
+  }
+  if (ftruncate(sync_fd_, static_cast<off_t>(new_num_pages * PAGE_SIZE)) != 0) {
+    LOG_DEBUG("failed to truncate the db file: %s", strerror(errno));
+    return 0;
+  }
+  // truncating also releases the space fallocate reserved past the end of the file
+  reserved_size_ = new_num_pages * PAGE_SIZE;
+  {
+    // the cut pages read as zeros from now on, which have no checksum
+    std::scoped_lock scoped_checksum_latch(checksum_latch_);
+    if (checksums_.size() > new_num_pages) {
+      checksums_.resize(new_num_pages);
+      if (checksum_fd_ >= 0 &&
+          ftruncate(checksum_fd_, static_cast<off_t>(CHECKSUM_HEADER_SIZE + new_num_pages * sizeof(uint32_t))) != 0) {
+        LOG_DEBUG("failed to truncate the checksum file: %s", strerror(errno));
+      }
+    }
+  }
+  return num_pages - new_num_pages;
+}
+
+void DiskManager::SaveFreePageMap() {
+  if (free_map_name_.empty()) {
+    return;
+  }
+  std::scoped_lock scoped_free_latch(free_latch_);
+  free_page_map_.Write(free_map_name_);
+}
+
+/**
+ * Allocate disk space ahead of the writes, one chunk at a time
+ */
+void DiskManager::ReserveSpace(page_id_t last_page_id) {
+  size_t end = (static_cast<size_t>(last_page_id) + 1) * PAGE_SIZE;
+  if (end <= reserved_size_.load(std::memory_order_relaxed)) {
+    return;
+  }
+  std::scoped_lock scoped_reserve_latch(reserve_latch_);
+  size_t reserved = reserved_size_;
+  if (end <= reserved || sync_fd_ < 0) {
+    return;
+  }
+  size_t chunk = DB_FILE_GROWTH_CHUNK * PAGE_SIZE;
+  size_t new_reserved = (end + chunk - 1) / chunk * chunk;
+  if (fallocate(sync_fd_, FALLOC_FL_KEEP_SIZE, reserved, new_reserved - reserved) != 0) {
+    // not supported by every file system; the writes then allocate as they go
+    LOG_DEBUG("fallocate failed: %s", strerror(errno));
+  }
+  reserved_size_ = new_reserved;
+}
+
+void DiskManager::ReadRun(page_id_t first_page_id, size_t num_pages, char *buffer) {
+  int64_t offset = static_cast<int64_t>(first_page_id) * PAGE_SIZE;
+  int64_t size = static_cast<int64_t>(num_pages) * PAGE_SIZE;
+  num_reads_ += static_cast<int>(num_pages);
   // check if read beyond file length
   if (offset > GetFileSize(file_name_)) {
-    LOG_DEBUG("I/O error reading past end of file");
-    // std::cerr << "I/O error while reading" << std::endl;
+    // pages are allocated lazily, so a page past the end of the file was never written
+    memset(buffer, 0, size);
   } else {
     // set read cursor to offset
     db_io_.seekp(offset);
-    db_io_.read(page_data, PAGE_SIZE);
+    db_io_.read(buffer, size);
     if (db_io_.bad()) {
       LOG_DEBUG("I/O error while reading");
       return;
     }
-    // if file ends before reading PAGE_SIZE
-    int read_count = db_io_.gcount();
-    if (read_count < PAGE_SIZE) {
+    // if file ends before reading the whole run
+    int64_t read_count = db_io_.gcount();
+    if (read_count < size) {
       LOG_DEBUG("Read less than a page");
       db_io_.clear();
       // std::cerr << "Read less than a page" << std::endl;
-      memset(page_data + read_count, 0, PAGE_SIZE - read_count);
+      memset(buffer + read_count, 0, size - read_count);
+    }
+  }
+  for (size_t i = 0; i < num_pages; i++) {
+    VerifyChecksum(first_page_id + static_cast<page_id_t>(i), buffer + i * PAGE_SIZE);
+  }
+}
+
+auto DiskManager::WriteRun(page_id_t first_page_id, const char *const *page_data, size_t num_pages) -> bool {
+  std::vector<iovec> iov(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    iov[i].iov_base = const_cast<char *>(page_data[i]);  // NOLINT
+    iov[i].iov_len = PAGE_SIZE;
+  }
+  auto offset = static_cast<off_t>(first_page_id) * PAGE_SIZE;
+  size_t next = 0;
+  while (next < num_pages) {
+    auto count = static_cast<int>(std::min<size_t>(num_pages - next, IOV_MAX));
+    ssize_t written = pwritev(sync_fd_, iov.data() + next, count, offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    offset += written;
+    // a short write continues with the rest of the page it stopped in
+    while (written > 0) {
+      auto length = static_cast<ssize_t>(iov[next].iov_len);
+      if (written < length) {
+        iov[next].iov_base = static_cast<char *>(iov[next].iov_base) + written;
+        iov[next].iov_len -= written;
+        break;
+      }
+      written -= length;
+      next++;
     }
   }
+  return true;
 }
 
 /**
@@ -191,6 +678,14 @@ auto DiskManager::ReadLog(char *log_data, int size, int offset) -> bool {
   return true;
 }
 
+/**
+ * Returns the number of whole pages in the database file
+ */
+auto DiskManager::GetNumPages() -> size_t {
+  int64_t file_size = GetFileSize(file_name_);
+  return file_size < 0 ? 0 : static_cast<size_t>(file_size) / PAGE_SIZE;
+}
+
 /**
  * Returns number of flushes made so far
  */
@@ -201,6 +696,11 @@ auto DiskManager::GetNumFlushes() const -> int { return num_flushes_; }
  */
 auto DiskManager::GetNumWrites() const -> int { return num_writes_; }
 
+/**
+ * Returns number of Reads made so far
+ */
+auto DiskManager::GetNumReads() const -> int { return num_reads_; }
+
 /**
  * Returns true if the log is currently being flushed
  */
@@ -209,10 +709,10 @@ auto DiskManager::GetFlushState() const -> bool { return flush_log_; }
 /**
  * Private helper function to get disk file size
  */
-auto DiskManager::GetFileSize(const std::string &file_name) -> int {
+auto DiskManager::GetFileSize(const std::string &file_name) -> int64_t {
   struct stat stat_buf;
   int rc = stat(file_name.c_str(), &stat_buf);
-  return rc == 0 ? static_cast<int>(stat_buf.st_size) : -1;
+  return rc == 0 ? static_cast<int64_t>(stat_buf.st_size) : -1;
 }
 
 }  // namespace bustub
@@ -0,0 +1,164 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// free_page_map.cpp
+//
+// Identification: src/storage/disk/free_page_map.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/free_page_map.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "common/logger.h"
+
+namespace bustub {
+
+void FreePageMap::Free(page_id_t page_id) {
+  auto index = static_cast<size_t>(page_id);
+  size_t word = index / WORD_BITS;
+  if (words_.size() <= word) {
+    words_.resize(word + 1, 0);
+  }
+  if ((words_[word] & Bit(index)) != 0) {
+    return;
+  }
+  words_[word] |= Bit(index);
+  num_free_++;
+  first_word_ = std::min(first_word_, word);
+  dirty_ = true;
+}
+
+auto FreePageMap::Allocate(uint32_t stride, uint32_t offset) -> page_id_t {
+  // skip the empty words in front for good, they stay empty until a Free
+  while (first_word_ < words_.size() && words_[first_word_] == 0) {
+    first_word_++;
+  }
+  for (size_t word = first_word_; word < words_.size(); word++) {
+    uint64_t bits = words_[word];
+    if (bits == 0) {
+      continue;
+    }
+    if (stride > 1) {
+      // keep the bits of the page ids congruent to offset
+      uint64_t mask = 0;
+      size_t first = word * WORD_BITS;
+      for (size_t bit = (offset + stride - first % stride) % stride; bit < WORD_BITS; bit += stride) {
+        mask |= uint64_t{1} << bit;
+      }
+      bits &= mask;
+      if (bits == 0) {
+        continue;
+      }
+    }
+    size_t index = word * WORD_BITS + static_cast<size_t>(__builtin_ctzll(bits));
+    words_[word] &= ~Bit(index);
+    num_free_--;
+    dirty_ = true;
+    return static_cast<page_id_t>(index);
+  }
+  return INVALID_PAGE_ID;
+}
+
+auto FreePageMap::TrailingFreeStart(size_t num_pages) const -> size_t {
+  size_t end = num_pages;
+  while (end > 0 && IsFree(static_cast<page_id_t>(end - 1))) {
+    end--;
+  }
+  return end;
+}
+
+/** Makes a rename in the directory of the file durable. */
+static auto SyncDirectoryOf(const std::string &file_name) -> bool {
+  size_t slash = file_name.rfind('/');
+  std::string directory = slash == std::string::npos ? "." : file_name.substr(0, slash + 1);
+  int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd < 0) {
+    return false;
+  }
+  bool synced = fsync(fd) == 0;
+  close(fd);
+  return synced;
+}
+
+auto FreePageMap::Write(const std::string &file_name) -> bool {
+  if (!dirty_) {
+    return true;
+  }
+  size_t num_words = words_.size();
+  while (num_words > 0 && words_[num_words - 1] == 0) {
+    num_words--;
+  }
+  uint64_t num_bits = num_words == 0 ? 0 : num_words * WORD_BITS - __builtin_clzll(words_[num_words - 1]);
+  std::vector<uint8_t> file((num_bits + 7) / 8 + sizeof(MAGIC) + sizeof(num_bits));
+  uint32_t magic = MAGIC;
+  memcpy(file.data(), &magic, sizeof(magic));
+  memcpy(file.data() + sizeof(magic), &num_bits, sizeof(num_bits));
+  uint8_t *bitmap = file.data() + sizeof(magic) + sizeof(num_bits);
+  for (size_t i = 0; i < (num_bits + 7) / 8; i++) {
+    bitmap[i] = static_cast<uint8_t>(words_[i / 8] >> (8 * (i % 8)));
+  }
+  std::string tmp_file_name = file_name + ".tmp";
+  int fd = open(tmp_file_name.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  bool written = fd >= 0 && write(fd, file.data(), file.size()) == static_cast<ssize_t>(file.size()) && fsync(fd) == 0;
+  if (fd >= 0) {
+    close(fd);
+  }
+  if (!written) {
+    LOG_WARN("failed to write free page map %s", tmp_file_name.c_str());
+    return false;
+  }
+  if (std::rename(tmp_file_name.c_str(), file_name.c_str()) != 0) {
+    return false;
+  }
+  if (!SyncDirectoryOf(file_name)) {
+    LOG_WARN("failed to sync the directory of %s", file_name.c_str());
+  }
+  dirty_ = false;
+  return true;
+}
+
+auto FreePageMap::Read(const std::string &file_name) -> bool {
+  std::ifstream in(file_name, std::ios::binary | std::ios::ate);
+  if (!in.is_open()) {
+    return false;
+  }
+  auto file_size = static_cast<uint64_t>(in.tellg());
+  in.seekg(0);
+  uint32_t magic = 0;
+  uint64_t num_bits = 0;
+  in.read(reinterpret_cast<char *>(&magic), sizeof(magic));
+  in.read(reinterpret_cast<char *>(&num_bits), sizeof(num_bits));
+  if (!in.good() || magic != MAGIC || file_size != sizeof(magic) + sizeof(num_bits) + (num_bits + 7) / 8) {
+    LOG_WARN("%s is not a complete free page map", file_name.c_str());
+    return false;
+  }
+  std::vector<uint8_t> bitmap((num_bits + 7) / 8);
+  in.read(reinterpret_cast<char *>(bitmap.data()), static_cast<std::streamsize>(bitmap.size()));
+  if (!in.good()) {
+    return false;
+  }
+  words_.assign((num_bits + WORD_BITS - 1) / WORD_BITS, 0);
+  num_free_ = 0;
+  for (size_t i = 0; i < bitmap.size(); i++) {
+    words_[i / 8] |= static_cast<uint64_t>(bitmap[i]) << (8 * (i % 8));
+  }
+  for (uint64_t word : words_) {
+    num_free_ += static_cast<size_t>(__builtin_popcountll(word));
+  }
+  first_word_ = 0;
+  dirty_ = false;
+  return true;
+}
+
+}  // namespace bustub
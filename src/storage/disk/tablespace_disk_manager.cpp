@@ -0,0 +1,217 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tablespace_disk_manager.cpp
+//
+// Identification: src/storage/disk/tablespace_disk_manager.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/tablespace_disk_manager.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "common/exception.h"
+
+namespace bustub {
+
+TablespaceDiskManager::TablespaceDiskManager(const std::string &db_file) : DiskManager(db_file) {}
+
+void TablespaceDiskManager::AddTablespace(tablespace_id_t tablespace_id, std::unique_ptr<DiskManager> disk_manager) {
+  std::scoped_lock scoped_tablespace_latch(tablespace_latch_);
+  if (tablespace_id <= DEFAULT_TABLESPACE_ID || tablespace_id >= MAX_TABLESPACES ||
+      tablespaces_[tablespace_id] != nullptr) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "can't add tablespace " + std::to_string(tablespace_id));
+  }
+  tablespaces_[tablespace_id] = disk_manager.get();
+  owned_.push_back(std::move(disk_manager));
+}
+
+auto TablespaceDiskManager::HasTablespace(tablespace_id_t tablespace_id) -> bool {
+  return tablespace_id == DEFAULT_TABLESPACE_ID ||
+         (tablespace_id > DEFAULT_TABLESPACE_ID && tablespace_id < MAX_TABLESPACES &&
+          tablespaces_[tablespace_id] != nullptr);
+}
+
+void TablespaceDiskManager::ShutDown() {
+  {
+    std::scoped_lock scoped_tablespace_latch(tablespace_latch_);
+    for (auto &disk_manager : owned_) {
+      disk_manager->ShutDown();
+    }
+  }
+  DiskManager::ShutDown();
+}
+
+void TablespaceDiskManager::WritePage(page_id_t page_id, const char *page_data) {
+  DiskManager *disk_manager = DiskManagerOf(page_id);
+  if (disk_manager == nullptr) {
+    DiskManager::WritePage(page_id, page_data);
+    return;
+  }
+  num_writes_ += 1;
+  disk_manager->WritePage(LocalPageId(page_id), page_data);
+}
+
+void TablespaceDiskManager::ReadPage(page_id_t page_id, char *page_data) {
+  DiskManager *disk_manager = DiskManagerOf(page_id);
+  if (disk_manager == nullptr) {
+    DiskManager::ReadPage(page_id, page_data);
+    return;
+  }
+  num_reads_ += 1;
+  disk_manager->ReadPage(LocalPageId(page_id), page_data);
+}
+
+void TablespaceDiskManager::ReadPages(const page_id_t *page_ids, char *const *page_data, size_t num_pages) {
+  if (std::all_of(page_ids, page_ids + num_pages,
+                  [](page_id_t page_id) { return TablespaceOf(page_id) == DEFAULT_TABLESPACE_ID; })) {
+    DiskManager::ReadPages(page_ids, page_data, num_pages);
+    return;
+  }
+  ForEachTablespace(page_ids, num_pages, [&](DiskManager *disk_manager, const auto &ids, const auto &batch) {
+    std::vector<char *> data(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      data[i] = page_data[batch[i]];
+    }
+    if (disk_manager == nullptr) {
+      DiskManager::ReadPages(ids.data(), data.data(), ids.size());
+      return;
+    }
+    num_reads_ += static_cast<int>(ids.size());
+    disk_manager->ReadPages(ids.data(), data.data(), ids.size());
+  });
+}
+
+void TablespaceDiskManager::WritePages(const page_id_t *page_ids, const char *const *page_data, size_t num_pages) {
+  if (std::all_of(page_ids, page_ids + num_pages,
+                  [](page_id_t page_id) { return TablespaceOf(page_id) == DEFAULT_TABLESPACE_ID; })) {
+    DiskManager::WritePages(page_ids, page_data, num_pages);
+    return;
+  }
+  ForEachTablespace(page_ids, num_pages, [&](DiskManager *disk_manager, const auto &ids, const auto &batch) {
+    std::vector<const char *> data(batch.size());
+    for (size_t i = 0; i < batch.size(); i++) {
+      data[i] = page_data[batch[i]];
+    }
+    if (disk_manager == nullptr) {
+      DiskManager::WritePages(ids.data(), data.data(), ids.size());
+      return;
+    }
+    num_writes_ += static_cast<int>(ids.size());
+    disk_manager->WritePages(ids.data(), data.data(), ids.size());
+  });
+}
+
+void TablespaceDiskManager::Sync() {
+  DiskManager::Sync();
+  for (auto &tablespace : tablespaces_) {
+    if (DiskManager *disk_manager = tablespace; disk_manager != nullptr) {
+      disk_manager->Sync();
+    }
+  }
+}
+
+void TablespaceDiskManager::DeallocatePage(page_id_t page_id) {
+  DiskManager *disk_manager = DiskManagerOf(page_id);
+  if (disk_manager == nullptr) {
+    DiskManager::DeallocatePage(page_id);
+    return;
+  }
+  disk_manager->DeallocatePage(LocalPageId(page_id));
+}
+
+auto TablespaceDiskManager::AllocateFreePage(uint32_t stride, uint32_t offset, tablespace_id_t tablespace_id)
+    -> page_id_t {
+  if (!HasTablespace(tablespace_id)) {
+    return INVALID_PAGE_ID;
+  }
+  if (tablespace_id == DEFAULT_TABLESPACE_ID) {
+    return DiskManager::AllocateFreePage(stride, offset, tablespace_id);
+  }
+  // The global page id must be congruent to offset, so the local one is congruent to offset minus the first page id.
+  auto first_page_id = static_cast<uint32_t>(FirstPageIdOf(tablespace_id));
+  uint32_t local_offset = (offset + stride - first_page_id % stride) % stride;
+  page_id_t page_id = tablespaces_[tablespace_id].load()->AllocateFreePage(stride, local_offset, DEFAULT_TABLESPACE_ID);
+  return page_id == INVALID_PAGE_ID ? INVALID_PAGE_ID : FirstPageIdOf(tablespace_id) + page_id;
+}
+
+auto TablespaceDiskManager::GetNumFreePages() -> size_t {
+  size_t num_free_pages = DiskManager::GetNumFreePages();
+  for (auto &tablespace : tablespaces_) {
+    if (DiskManager *disk_manager = tablespace; disk_manager != nullptr) {
+      num_free_pages += disk_manager->GetNumFreePages();
+    }
+  }
+  return num_free_pages;
+}
+
+auto TablespaceDiskManager::TruncateFreeTail() -> size_t {
+  size_t num_pages = DiskManager::TruncateFreeTail();
+  for (auto &tablespace : tablespaces_) {
+    if (DiskManager *disk_manager = tablespace; disk_manager != nullptr) {
+      num_pages += disk_manager->TruncateFreeTail();
+    }
+  }
+  return num_pages;
+}
+
+auto TablespaceDiskManager::IsFreePage(page_id_t page_id) -> bool {
+  if (page_id < 0 || !HasTablespace(TablespaceOf(page_id))) {
+    return false;
+  }
+  DiskManager *disk_manager = DiskManagerOf(page_id);
+  return disk_manager == nullptr ? DiskManager::IsFreePage(page_id) : disk_manager->IsFreePage(LocalPageId(page_id));
+}
+
+auto TablespaceDiskManager::HasPage(page_id_t page_id) -> bool {
+  if (page_id < 0 || !HasTablespace(TablespaceOf(page_id))) {
+    return false;
+  }
+  DiskManager *disk_manager = DiskManagerOf(page_id);
+  return disk_manager == nullptr ? DiskManager::HasPage(page_id) : disk_manager->HasPage(LocalPageId(page_id));
+}
+
+auto TablespaceDiskManager::DiskManagerOf(page_id_t page_id) -> DiskManager * {
+  tablespace_id_t tablespace_id = TablespaceOf(page_id);
+  if (tablespace_id == DEFAULT_TABLESPACE_ID) {
+    return nullptr;
+  }
+  DiskManager *disk_manager = tablespace_id > 0 && tablespace_id < MAX_TABLESPACES ? tablespaces_[tablespace_id].load()
+                                                                                   : nullptr;
+  if (disk_manager == nullptr) {
+    throw Exception(ExceptionType::OUT_OF_RANGE, "page " + std::to_string(page_id) + " is in no tablespace");
+  }
+  return disk_manager;
+}
+
+void TablespaceDiskManager::ForEachTablespace(
+    const page_id_t *page_ids, size_t num_pages,
+    const std::function<void(DiskManager *, const std::vector<page_id_t> &, const std::vector<size_t> &)> &fn) {
+  std::vector<size_t> order(num_pages);
+  for (size_t i = 0; i < num_pages; i++) {
+    order[i] = i;
+  }
+  std::stable_sort(order.begin(), order.end(), [page_ids](size_t a, size_t b) {
+    return TablespaceOf(page_ids[a]) < TablespaceOf(page_ids[b]);
+  });
+  std::vector<page_id_t> ids;
+  std::vector<size_t> batch;
+  for (size_t begin = 0, end; begin < num_pages; begin = end) {
+    tablespace_id_t tablespace_id = TablespaceOf(page_ids[order[begin]]);
+    DiskManager *disk_manager = DiskManagerOf(page_ids[order[begin]]);
+    ids.clear();
+    batch.clear();
+    for (end = begin; end < num_pages && TablespaceOf(page_ids[order[end]]) == tablespace_id; end++) {
+      ids.push_back(disk_manager == nullptr ? page_ids[order[end]] : LocalPageId(page_ids[order[end]]));
+      batch.push_back(order[end]);
+    }
+    fn(disk_manager, ids, batch);
+  }
+}
+
+}  // namespace bustub
@@ -1,3 +1,6 @@
+#include <algorithm>
+#include <thread>  // NOLINT
+#include <utility>
 #include <vector>
 
 #include "storage/index/extendible_hash_table_index.h"
@@ -9,10 +12,13 @@ namespace bustub {
 template <typename KeyType, typename ValueType, typename KeyComparator>
 HASH_TABLE_INDEX_TYPE::ExtendibleHashTableIndex(std::unique_ptr<IndexMetadata> &&metadata,
                                                 BufferPoolManager *buffer_pool_manager,
-                                                const HashFunction<KeyType> &hash_fn)
+                                                const HashFunction<KeyType> &hash_fn, tablespace_id_t tablespace_id)
     : Index(std::move(metadata)),
       comparator_(GetMetadata()->GetKeySchema()),
-      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn) {}
+      container_(GetMetadata()->GetName(), buffer_pool_manager, comparator_, hash_fn, tablespace_id) {
+  // removes only schedule the merges, the container's destructor stops the thread
+  container_.StartMaintenance(hash_table_maintenance_interval);
+}
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_INDEX_TYPE::InsertEntry(const Tuple &key, RID rid, Transaction *transaction) {
@@ -40,6 +46,29 @@ void HASH_TABLE_INDEX_TYPE::ScanKey(const Tuple &key, std::vector<RID> *result,
 
   container_.GetValue(transaction, index_key, result);
 }
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_INDEX_TYPE::BulkBuild(TableHeap *table_heap, const Schema &schema, Transaction *transaction) {
+  size_t num_threads = std::max(1U, std::thread::hardware_concurrency());
+  // each thread collects its own entries
+  std::vector<std::vector<std::pair<KeyType, ValueType>>> thread_entries(num_threads);
+  table_heap->ParallelScan(transaction, num_threads, [&](size_t thread, const Tuple &tuple) {
+    KeyType index_key;
+    index_key.SetFromKey(tuple.KeyFromTuple(schema, *GetKeySchema(), GetKeyAttrs()));
+    thread_entries[thread].emplace_back(index_key, tuple.GetRid());
+  });
+  std::vector<std::pair<KeyType, ValueType>> entries = std::move(thread_entries[0]);
+  for (size_t i = 1; i < num_threads; i++) {
+    entries.insert(entries.end(), thread_entries[i].begin(), thread_entries[i].end());
+    thread_entries[i].clear();
+    thread_entries[i].shrink_to_fit();
+  }
+  if (!container_.BulkLoad(transaction, entries)) {
+    for (const auto &[index_key, rid] : entries) {
+      container_.Insert(transaction, index_key, rid);
+    }
+  }
+}
 template class ExtendibleHashTableIndex<GenericKey<4>, RID, GenericComparator<4>>;
 template class ExtendibleHashTableIndex<GenericKey<8>, RID, GenericComparator<8>>;
 template class ExtendibleHashTableIndex<GenericKey<16>, RID, GenericComparator<16>>;
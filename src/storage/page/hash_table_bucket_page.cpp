@@ -11,6 +11,14 @@
 //===----------------------------------------------------------------------===//
 
 #include "storage/page/hash_table_bucket_page.h"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
 #include "common/logger.h"
 #include "common/util/hash_util.h"
 #include "storage/index/generic_key.h"
@@ -19,13 +27,95 @@
 
 namespace bustub {
 
+/**
+ * Sets the bit of every slot in [begin, num_slots) whose fingerprint equals fingerprint in matches, which starts out
+ * zeroed.
+ */
+static void MatchFingerprintsScalar(const uint8_t *fingerprints, size_t begin, size_t num_slots, uint8_t fingerprint,
+                                    uint64_t *matches) {
+  for (size_t i = begin; i < num_slots; i++) {
+    matches[i / 64] |= static_cast<uint64_t>(fingerprints[i] == fingerprint) << (i % 64);
+  }
+}
+
+#if defined(__x86_64__)
+/** MatchFingerprintsScalar for all slots, comparing 16 fingerprints per instruction. SSE2 is part of x86-64. */
+static void MatchFingerprintsSse2(const uint8_t *fingerprints, size_t num_slots, uint8_t fingerprint,
+                                  uint64_t *matches) {
+  __m128i needle = _mm_set1_epi8(static_cast<char>(fingerprint));
+  size_t i = 0;
+  for (; i + 16 <= num_slots; i += 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(fingerprints + i));
+    auto mask = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, needle)));
+    matches[i / 64] |= static_cast<uint64_t>(mask) << (i % 64);
+  }
+  MatchFingerprintsScalar(fingerprints, i, num_slots, fingerprint, matches);
+}
+
+/** MatchFingerprintsScalar for all slots, comparing 32 fingerprints per instruction. */
+__attribute__((target("avx2"))) static void MatchFingerprintsAvx2(const uint8_t *fingerprints, size_t num_slots,
+                                                                  uint8_t fingerprint, uint64_t *matches) {
+  __m256i needle = _mm256_set1_epi8(static_cast<char>(fingerprint));
+  size_t i = 0;
+  for (; i + 32 <= num_slots; i += 32) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(fingerprints + i));
+    auto mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, needle)));
+    matches[i / 64] |= static_cast<uint64_t>(mask) << (i % 64);
+  }
+  MatchFingerprintsScalar(fingerprints, i, num_slots, fingerprint, matches);
+}
+#endif
+
+/** Sets the bit of every slot whose fingerprint equals fingerprint in matches, which starts out zeroed. */
+static void MatchFingerprints(const uint8_t *fingerprints, size_t num_slots, uint8_t fingerprint, uint64_t *matches) {
+#if defined(__x86_64__)
+  static const bool has_avx2 = __builtin_cpu_supports("avx2");
+  if (has_avx2) {
+    MatchFingerprintsAvx2(fingerprints, num_slots, fingerprint, matches);
+  } else {
+    MatchFingerprintsSse2(fingerprints, num_slots, fingerprint, matches);
+  }
+#else
+  MatchFingerprintsScalar(fingerprints, 0, num_slots, fingerprint, matches);
+#endif
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+auto HASH_TABLE_BUCKET_TYPE::Fingerprint(KeyType key, KeyComparator cmp) -> uint8_t {
+  // Comparator hashes may be weak in their high bits; the top byte of the product depends on all of them.
+  return static_cast<uint8_t>((static_cast<uint64_t>(cmp.Hash(key)) * 0x9e3779b97f4a7c15ULL) >> 56);
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::ReadableWords(uint64_t *words) const {
+  // bit i of the bitmap is bit i % 64 of word i / 64 on a little-endian machine
+  words[BITMAP_WORDS - 1] = 0;
+  memcpy(words, readable_, sizeof(readable_));
+}
+
+template <typename KeyType, typename ValueType, typename KeyComparator>
+void HASH_TABLE_BUCKET_TYPE::MatchingSlots(KeyType key, KeyComparator cmp, uint64_t *matches) const {
+  uint64_t readable[BITMAP_WORDS];
+  ReadableWords(readable);
+  std::fill(matches, matches + BITMAP_WORDS, 0);
+  MatchFingerprints(fingerprints_, BUCKET_ARRAY_SIZE, Fingerprint(key, cmp), matches);
+  for (size_t i = 0; i < BITMAP_WORDS; i++) {
+    matches[i] &= readable[i];
+  }
+}
+
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vector<ValueType> *result) -> bool {
+  uint64_t matches[BITMAP_WORDS];
+  MatchingSlots(key, cmp, matches);
   bool flag = false;
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i) && cmp(key, array_[i].first) == 0) {
-      result->push_back(array_[i].second);
-      flag = true;
+  for (size_t word = 0; word < BITMAP_WORDS; word++) {
+    for (uint64_t bits = matches[word]; bits != 0; bits &= bits - 1) {
+      size_t i = word * 64 + __builtin_ctzll(bits);
+      if (cmp(key, array_[i].first) == 0) {
+        result->push_back(array_[i].second);
+        flag = true;
+      }
     }
   }
   return flag;
@@ -33,18 +123,28 @@ auto HASH_TABLE_BUCKET_TYPE::GetValue(KeyType key, KeyComparator cmp, std::vecto
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator cmp) -> bool {
-  int64_t free_slot = -1;
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i)) {
+  static_assert(sizeof(HashTableBucketPage) + BUCKET_ARRAY_SIZE * sizeof(MappingType) <= PAGE_SIZE,
+                "the bucket must fit into a page");
+  uint64_t matches[BITMAP_WORDS];
+  MatchingSlots(key, cmp, matches);
+  for (size_t word = 0; word < BITMAP_WORDS; word++) {
+    for (uint64_t bits = matches[word]; bits != 0; bits &= bits - 1) {
+      size_t i = word * 64 + __builtin_ctzll(bits);
       if (cmp(key, array_[i].first) == 0 && value == array_[i].second) {
         return false;
       }
-    } else if (free_slot == -1) {
-      free_slot = i;
     }
   }
 
-  if (free_slot == -1) {
+  uint64_t readable[BITMAP_WORDS];
+  ReadableWords(readable);
+  size_t free_slot = BUCKET_ARRAY_SIZE;
+  for (size_t word = 0; word < BITMAP_WORDS && free_slot == BUCKET_ARRAY_SIZE; word++) {
+    if (~readable[word] != 0) {
+      free_slot = std::min<size_t>(word * 64 + __builtin_ctzll(~readable[word]), BUCKET_ARRAY_SIZE);
+    }
+  }
+  if (free_slot == BUCKET_ARRAY_SIZE) {
     // is full
     LOG_ERROR("Bucket is full which should not");
     return false;
@@ -53,16 +153,22 @@ auto HASH_TABLE_BUCKET_TYPE::Insert(KeyType key, ValueType value, KeyComparator
   // insert it and return true
   SetOccupied(free_slot);
   SetReadable(free_slot);
+  fingerprints_[free_slot] = Fingerprint(key, cmp);
   array_[free_slot] = MappingType(key, value);
   return true;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::Remove(KeyType key, ValueType value, KeyComparator cmp) -> bool {
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i) && cmp(key, array_[i].first) == 0 && value == array_[i].second) {
-      RemoveAt(i);
-      return true;
+  uint64_t matches[BITMAP_WORDS];
+  MatchingSlots(key, cmp, matches);
+  for (size_t word = 0; word < BITMAP_WORDS; word++) {
+    for (uint64_t bits = matches[word]; bits != 0; bits &= bits - 1) {
+      size_t i = word * 64 + __builtin_ctzll(bits);
+      if (cmp(key, array_[i].first) == 0 && value == array_[i].second) {
+        RemoveAt(i);
+        return true;
+      }
     }
   }
   return false;
@@ -80,7 +186,7 @@ auto HASH_TABLE_BUCKET_TYPE::ValueAt(uint32_t bucket_idx) const -> ValueType {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 void HASH_TABLE_BUCKET_TYPE::RemoveAt(uint32_t bucket_idx) {
-  readable_[bucket_idx / 8] ^= (1 << (bucket_idx % 8));
+  readable_[bucket_idx / 8] &= static_cast<char>(~(1 << (bucket_idx % 8)));
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
@@ -105,27 +211,25 @@ void HASH_TABLE_BUCKET_TYPE::SetReadable(uint32_t bucket_idx) {
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::IsFull() -> bool {
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (!IsReadable(i)) {
-      return false;
-    }
-  }
-  return true;
+  return NumReadable() == BUCKET_ARRAY_SIZE;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::NumReadable() -> uint32_t {
-  return 0;
+  uint64_t readable[BITMAP_WORDS];
+  ReadableWords(readable);
+  uint32_t num_readable = 0;
+  for (uint64_t word : readable) {
+    num_readable += __builtin_popcountll(word);
+  }
+  return num_readable;
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
 auto HASH_TABLE_BUCKET_TYPE::IsEmpty() -> bool {
-  for (size_t i = 0; i < BUCKET_ARRAY_SIZE; i++) {
-    if (IsReadable(i)) {
-      return false;
-    }
-  }
-  return true;
+  uint64_t readable[BITMAP_WORDS];
+  ReadableWords(readable);
+  return std::all_of(readable, readable + BITMAP_WORDS, [](uint64_t word) { return word == 0; });
 }
 
 template <typename KeyType, typename ValueType, typename KeyComparator>
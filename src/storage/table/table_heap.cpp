@@ -11,6 +11,9 @@
 //===----------------------------------------------------------------------===//
 
 #include <cassert>
+#include <mutex>   // NOLINT
+#include <thread>  // NOLINT
+#include <vector>
 
 #include "common/logger.h"
 #include "storage/table/table_heap.h"
@@ -25,10 +28,10 @@ TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_m
       first_page_id_(first_page_id) {}
 
 TableHeap::TableHeap(BufferPoolManager *buffer_pool_manager, LockManager *lock_manager, LogManager *log_manager,
-                     Transaction *txn)
+                     Transaction *txn, tablespace_id_t tablespace_id)
     : buffer_pool_manager_(buffer_pool_manager), lock_manager_(lock_manager), log_manager_(log_manager) {
   // Initialize the first table page.
-  auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_));
+  auto first_page = reinterpret_cast<TablePage *>(buffer_pool_manager_->NewPage(&first_page_id_, tablespace_id));
   BUSTUB_ASSERT(first_page != nullptr, "Couldn't create a page for the table heap.");
   first_page->WLatch();
   first_page->Init(first_page_id_, PAGE_SIZE, INVALID_LSN, log_manager_, txn);
@@ -62,8 +65,9 @@ auto TableHeap::InsertTuple(const Tuple &tuple, RID *rid, Transaction *txn) -> b
       cur_page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
       cur_page->WLatch();
     } else {
-      // Otherwise we have run out of valid pages. We need to create a new page.
-      auto new_page = static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id));
+      // Otherwise we have run out of valid pages. We need to create a new page, in the table's tablespace.
+      auto new_page =
+          static_cast<TablePage *>(buffer_pool_manager_->NewPage(&next_page_id, TablespaceOf(first_page_id_)));
       // If we could not create a new page,
       if (new_page == nullptr) {
         // Then life sucks and we abort the transaction.
@@ -189,6 +193,52 @@ auto TableHeap::Begin(Transaction *txn) -> TableIterator {
   return TableIterator(this, rid, txn);
 }
 
+void TableHeap::ParallelScan(Transaction *txn, size_t num_threads,
+                             const std::function<void(size_t, const Tuple &)> &fn) {
+  if (enable_logging) {
+    num_threads = 1;
+  }
+  // The chain is walked under cursor_latch, so fetching pages is serial; reading their tuples isn't.
+  std::mutex cursor_latch;
+  page_id_t next_page_id = first_page_id_;
+  auto scan = [&](size_t thread) {
+    while (true) {
+      TablePage *page;
+      {
+        std::scoped_lock cursor_guard(cursor_latch);
+        if (next_page_id == INVALID_PAGE_ID) {
+          return;
+        }
+        page = static_cast<TablePage *>(buffer_pool_manager_->FetchPage(next_page_id));
+        BUSTUB_ASSERT(page != nullptr, "all pages are pinned");
+        page->RLatch();
+        next_page_id = page->GetNextPageId();
+        buffer_pool_manager_->Prefetch(next_page_id);
+      }
+      RID rid;
+      Tuple tuple;
+      for (bool found = page->GetFirstTupleRid(&rid); found;) {
+        if (page->GetTuple(rid, &tuple, txn, lock_manager_)) {
+          fn(thread, tuple);
+        }
+        RID next_rid;
+        found = page->GetNextTupleRid(rid, &next_rid);
+        rid = next_rid;
+      }
+      page->RUnlatch();
+      buffer_pool_manager_->UnpinPage(page->GetTablePageId(), false);
+    }
+  };
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; i++) {
+    threads.emplace_back(scan, i);
+  }
+  scan(0);
+  for (auto &thread : threads) {
+    thread.join();
+  }
+}
+
 auto TableHeap::End() -> TableIterator { return TableIterator(this, RID(INVALID_PAGE_ID, 0), nullptr); }
 
 }  // namespace bustub
@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include <cassert>
 
 #include "storage/table/table_heap.h"
@@ -44,6 +45,7 @@ auto TableIterator::operator++() -> TableIterator & {
                                  &next_tuple_rid)) {  // end of this page
     while (cur_page->GetNextPageId() != INVALID_PAGE_ID) {
       auto next_page = static_cast<TablePage *>(buffer_pool_manager->FetchPage(cur_page->GetNextPageId()));
+      ReadAhead(cur_page->GetTablePageId(), next_page->GetTablePageId(), next_page->GetNextPageId());
       cur_page->RUnlatch();
       buffer_pool_manager->UnpinPage(cur_page->GetTablePageId(), false);
       cur_page = next_page;
@@ -64,6 +66,25 @@ auto TableIterator::operator++() -> TableIterator & {
   return *this;
 }
 
+void TableIterator::ReadAhead(page_id_t cur_page_id, page_id_t next_page_id, page_id_t after_next_page_id) {
+  BufferPoolManager *buffer_pool_manager = table_heap_->buffer_pool_manager_;
+  if (next_page_id != cur_page_id + 1 || after_next_page_id != next_page_id + 1) {
+    // Not sequential: only the page the chain points at next is known to be useful.
+    readahead_window_ = 0;
+    buffer_pool_manager->Prefetch(after_next_page_id);
+    return;
+  }
+  // Never read ahead more than a quarter of the pool, or the scan would evict its own read-ahead.
+  size_t max_window = std::max<size_t>(1, std::min(MAX_READAHEAD_PAGES, buffer_pool_manager->GetPoolSize() / 4));
+  readahead_window_ = std::min(readahead_window_ == 0 ? MIN_READAHEAD_PAGES : readahead_window_ * 2, max_window);
+  page_id_t begin = std::max(after_next_page_id, readahead_end_);
+  page_id_t end = after_next_page_id + static_cast<page_id_t>(readahead_window_);
+  if (begin < end) {
+    buffer_pool_manager->PrefetchRange(begin, end - begin);
+    readahead_end_ = end;
+  }
+}
+
 auto TableIterator::operator++(int) -> TableIterator {
   TableIterator clone(*this);
   ++(*this);
@@ -11,10 +11,16 @@
 //===----------------------------------------------------------------------===//
 
 #include "buffer/buffer_pool_manager_instance.h"
+#include <sys/stat.h>
 #include <cstdio>
+#include <cstring>
 #include <random>
 #include <string>
+#include <thread>  // NOLINT
+#include <utility>
+#include <vector>
 #include "buffer/buffer_pool_manager.h"
+#include "common/exception.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
@@ -140,4 +146,584 @@ TEST(BufferPoolManagerInstanceTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+// Hits on resident pages from many threads must keep pin counts exact, while misses keep evicting correctly.
+TEST(BufferPoolManagerInstanceTest, ConcurrentFetchTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+  const int num_threads = 8;
+  const int rounds = 2000;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+
+  // Pages 0..3 stay hot; pages 4..19 cycle through the remaining frames.
+  std::vector<page_id_t> page_ids;
+  for (int i = 0; i < 20; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    page_ids.push_back(page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid] {
+      char expected[PAGE_SIZE];
+      for (int i = 0; i < rounds; ++i) {
+        page_id_t page_id = (i % 4 == 3) ? page_ids[4 + (i + tid) % 16] : page_ids[(i + tid) % 4];
+        auto *page = bpm->FetchPage(page_id);
+        if (page == nullptr) {
+          continue;
+        }
+        snprintf(expected, PAGE_SIZE, "page %d", page_id);
+        EXPECT_EQ(page_id, page->GetPageId());
+        EXPECT_EQ(0, strcmp(page->GetData(), expected));
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Every pin was matched by an unpin, so every page can be deleted.
+  for (auto page_id : page_ids) {
+    EXPECT_EQ(true, bpm->DeletePage(page_id));
+  }
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+/** Exposes the replacer of a buffer pool instance to the tests. */
+class InspectableBufferPoolManagerInstance : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+  auto GetReplacerSize() -> size_t { return replacer_->Size(); }
+};
+
+// Racing first pins, last unpins, evictions, flushes and cleaner write-backs must leave exactly the unpinned frames in
+// the replacer.
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, PinTransitionStressTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 8;
+  const size_t num_pages = 12;
+  const int num_threads = 6;
+  const int rounds = 20000;
+
+  for (auto policy : {ReplacerPolicy::LRU, ReplacerPolicy::LRU_K, ReplacerPolicy::CLOCK}) {
+    auto *disk_manager = new DiskManager(db_name);
+    auto *bpm = new InspectableBufferPoolManagerInstance(buffer_pool_size, 1, 0, disk_manager, nullptr, policy);
+    bpm->StartPageCleaner(buffer_pool_size, std::chrono::milliseconds(1));
+
+    // Most fetches are hits that move a pin count between 0 and 1; the rest evict one of the other pages.
+    std::vector<page_id_t> page_ids;
+    for (size_t i = 0; i < num_pages; ++i) {
+      page_id_t page_id;
+      ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+      page_ids.push_back(page_id);
+      EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+    }
+
+    std::vector<std::thread> threads;
+    for (int tid = 0; tid < num_threads; ++tid) {
+      threads.emplace_back([&, tid] {
+        std::mt19937 rng(tid);
+        for (int i = 0; i < rounds; ++i) {
+          page_id_t page_id = page_ids[rng() % page_ids.size()];
+          auto *page = bpm->FetchPage(page_id);
+          ASSERT_NE(nullptr, page);
+          EXPECT_EQ(page_id, page->GetPageId());
+          bool dirty = rng() % 4 == 0;
+          if (dirty) {
+            page->WLatch();
+            page->GetData()[tid]++;
+            page->WUnlatch();
+          }
+          EXPECT_EQ(true, bpm->UnpinPage(page_id, dirty));
+          if (i % 100 == 0) {
+            bpm->FlushPage(page_id);
+          }
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    bpm->StopPageCleaner();
+
+    size_t unpinned = 0;
+    for (size_t i = 0; i < buffer_pool_size; ++i) {
+      Page *page = &bpm->GetPages()[i];
+      if (page->GetPageId() != INVALID_PAGE_ID && page->GetPinCount() == 0) {
+        unpinned++;
+      }
+    }
+    EXPECT_EQ(buffer_pool_size, unpinned);
+    EXPECT_EQ(unpinned, bpm->GetReplacerSize());
+
+    disk_manager->ShutDown();
+    remove("test.db");
+
+    delete bpm;
+    delete disk_manager;
+  }
+}
+
+// NOLINTNEXTLINE
+// With the page cleaner running, evictions should find victims that have already been written back.
+TEST(BufferPoolManagerInstanceTest, PageCleanerTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 10;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->StartPageCleaner(buffer_pool_size, std::chrono::milliseconds(5));
+
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    auto *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+  for (int i = 0; i < 1000 && bpm->GetCleanedPageCount() < buffer_pool_size; ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  EXPECT_EQ(buffer_pool_size, bpm->GetCleanedPageCount());
+
+  // Evict everything: all victims are clean, and the data written by the cleaner reads back.
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(buffer_pool_size, bpm->GetCleanVictimCount());
+  EXPECT_EQ(0, bpm->GetDirtyVictimCount());
+  bpm->StopPageCleaner();
+
+  char expected[PAGE_SIZE];
+  for (page_id_t page_id = 0; page_id < static_cast<page_id_t>(buffer_pool_size); ++page_id) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(expected, PAGE_SIZE, "page %d", page_id);
+    EXPECT_EQ(0, strcmp(page->GetData(), expected));
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+// Racing flushes and cleaner write-backs of pages that keep changing must never leave a clean frame that differs from
+// its page on disk.
+TEST(BufferPoolManagerInstanceTest, WriteBackRaceTest) {
+  const std::string db_name = "test.db";
+  const size_t buffer_pool_size = 4;
+  const int num_threads = 4;
+  const int rounds = 5000;
+
+  auto *disk_manager = new DiskManager(db_name);
+  auto *bpm = new BufferPoolManagerInstance(buffer_pool_size, disk_manager);
+  bpm->StartPageCleaner(buffer_pool_size, std::chrono::milliseconds(1));
+  std::vector<page_id_t> page_ids;
+  for (size_t i = 0; i < buffer_pool_size; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    page_ids.push_back(page_id);
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+  }
+
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&, tid] {
+      for (int i = 0; i < rounds; ++i) {
+        page_id_t page_id = page_ids[(i + tid) % page_ids.size()];
+        auto *page = bpm->FetchPage(page_id);
+        ASSERT_NE(nullptr, page);
+        page->WLatch();
+        snprintf(page->GetData(), PAGE_SIZE, "thread %d round %d", tid, i);
+        page->WUnlatch();
+        EXPECT_EQ(true, bpm->UnpinPage(page_id, true));
+        // Every other thread flushes, so flushes overlap the cleaner's writes of the same pages.
+        if (tid % 2 == 0) {
+          bpm->FlushPage(page_id);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  bpm->StopPageCleaner();
+
+  char on_disk[PAGE_SIZE];
+  for (auto page_id : page_ids) {
+    auto *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    if (!page->IsDirty()) {
+      disk_manager->ReadPage(page_id, on_disk);
+      EXPECT_EQ(0, memcmp(on_disk, page->GetData(), PAGE_SIZE)) << "page " << page_id;
+    }
+    EXPECT_EQ(true, bpm->UnpinPage(page_id, false));
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+
+  delete bpm;
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ResizeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+
+  // Scenario: a full pool of pinned pages has room again after growing.
+  std::vector<page_id_t> page_ids(10);
+  for (size_t i = 0; i < 5; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_ids[i]));
+  }
+  page_id_t page_id_temp;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_TRUE(bpm->Resize(10));
+  EXPECT_EQ(10, bpm->GetPoolSize());
+  for (size_t i = 5; i < 10; ++i) {
+    Page *page = bpm->NewPage(&page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_ids[i]);
+  }
+  for (size_t i = 0; i < 5; ++i) {
+    Page *page = bpm->FetchPage(page_ids[i]);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_ids[i]);
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], true));
+  }
+
+  // Scenario: shrinking fails while a page that would have to leave is pinned, and leaves the size alone without
+  // evicting the unpinned pages before it.
+  for (size_t i = 0; i < 10; ++i) {
+    if (i != 7) {
+      EXPECT_TRUE(bpm->UnpinPage(page_ids[i], true));
+    }
+  }
+  uint64_t evictions = bpm->GetStats().evictions_;
+  EXPECT_FALSE(bpm->Resize(3));
+  EXPECT_EQ(10, bpm->GetPoolSize());
+  EXPECT_EQ(evictions, bpm->GetStats().evictions_);
+
+  // Scenario: once it is unpinned, the pool shrinks and evicted pages come back from disk intact.
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[7], true));
+  EXPECT_TRUE(bpm->Resize(3));
+  EXPECT_EQ(3, bpm->GetPoolSize());
+  for (size_t i = 0; i < 10; ++i) {
+    Page *page = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_ids[i]), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+  std::vector<Page *> pinned(3);
+  for (size_t i = 0; i < 3; ++i) {
+    pinned[i] = bpm->FetchPage(page_ids[i]);
+    ASSERT_NE(nullptr, pinned[i]);
+  }
+  EXPECT_EQ(nullptr, bpm->FetchPage(page_ids[3]));
+
+  // Scenario: sizes outside of the reserved capacity are rejected.
+  EXPECT_FALSE(bpm->Resize(0));
+  EXPECT_FALSE(bpm->Resize(5 * BUFFER_POOL_MAX_GROWTH + 1));
+  EXPECT_TRUE(bpm->Resize(5 * BUFFER_POOL_MAX_GROWTH));
+  EXPECT_NE(nullptr, bpm->FetchPage(page_ids[3]));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, StatsTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(3, disk_manager);
+
+  // Scenario: three new pages fill the pool; two of them are written back when a fourth needs a frame.
+  std::vector<page_id_t> page_ids(4);
+  for (size_t i = 0; i < 3; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_ids[i]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], i != 2));
+  }
+  ASSERT_NE(nullptr, bpm->NewPage(&page_ids[3]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[3], false));
+  BufferPoolStats stats = bpm->GetStats();
+  EXPECT_EQ(0, stats.hits_);
+  EXPECT_EQ(0, stats.misses_);
+  EXPECT_EQ(1, stats.evictions_);
+  EXPECT_EQ(1, stats.dirty_evictions_);
+
+  // Scenario: fetches of resident pages are hits, the evicted page is a miss that evicts a clean page.
+  for (int round = 0; round < 4; ++round) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_ids[3]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[3], true));
+  }
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+  stats = bpm->GetStats();
+  EXPECT_EQ(4, stats.hits_);
+  EXPECT_EQ(1, stats.misses_);
+  EXPECT_EQ(2, stats.evictions_);
+  EXPECT_EQ(2, stats.dirty_evictions_);
+  EXPECT_DOUBLE_EQ(0.8, stats.HitRatio());
+  EXPECT_EQ(2, bpm->GetDirtyVictimCount());
+  EXPECT_EQ(0, bpm->GetCleanVictimCount());
+
+  // Scenario: the histogram has two pages pinned once, page 0 by its miss and page 2, and page 3 pinned five times.
+  EXPECT_EQ(2, stats.access_histogram_[BufferPoolStats::HistogramBucket(1)]);
+  EXPECT_EQ(1, stats.access_histogram_[BufferPoolStats::HistogramBucket(5)]);
+  EXPECT_EQ(3, BufferPoolStats::HistogramBucket(5));
+
+  // Scenario: flushing writes back the dirty page and the new page that was never written, not the clean page.
+  bpm->FlushAllPages();
+  EXPECT_EQ(2, bpm->GetStats().flushes_);
+
+  // Scenario: counts from many threads add up, whichever counter shard they land on.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < 8; ++tid) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        ASSERT_NE(nullptr, bpm->FetchPage(page_ids[3]));
+        bpm->UnpinPage(page_ids[3], false);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(8004, bpm->GetStats().hits_);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, LazyAllocationTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(2, disk_manager);
+
+  // Scenario: allocating pages does not write them.
+  page_id_t page_ids[3];
+  for (int i = 0; i < 3; ++i) {
+    if (i == 2) {
+      EXPECT_EQ(0, disk_manager->GetNumWrites());
+      EXPECT_EQ(0, disk_manager->GetNumPages());
+    }
+    ASSERT_NE(nullptr, bpm->NewPage(&page_ids[i]));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+
+  // Scenario: making room for the third page writes the first, even though it was never marked dirty.
+  EXPECT_EQ(1, disk_manager->GetNumWrites());
+  EXPECT_EQ(1, disk_manager->GetNumPages());
+
+  // Scenario: a page that was never written reads as zeros.
+  char buf[PAGE_SIZE];
+  memset(buf, 1, PAGE_SIZE);
+  disk_manager->ReadPage(page_ids[2] + 10, buf);
+  EXPECT_EQ(0, buf[0]);
+  EXPECT_EQ(0, buf[PAGE_SIZE - 1]);
+  Page *page = bpm->FetchPage(page_ids[0]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, page->GetData()[0]);
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+
+  // Scenario: the file keeps its size while disk space is reserved ahead of the writes.
+  bpm->FlushAllPages();
+  EXPECT_EQ(3, disk_manager->GetNumPages());
+  struct stat stat_buf;
+  ASSERT_EQ(0, stat("test.db", &stat_buf));
+  EXPECT_GE(static_cast<size_t>(stat_buf.st_blocks) * 512, DB_FILE_GROWTH_CHUNK * PAGE_SIZE);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, FreedPageReuseTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(4, disk_manager);
+  page_id_t page_ids[3];
+  for (auto &page_id : page_ids) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  for (auto page_id : page_ids) {
+    EXPECT_TRUE(bpm->DeletePage(page_id));
+  }
+
+  // Scenario: neither a prefetch nor a stale warm-up snapshot brings a deleted page back.
+  int reads = disk_manager->GetNumReads();
+  bpm->Prefetch(page_ids[0]);
+  bpm->WarmUp({page_ids[1], page_ids[2]});
+  bpm->WaitForWarmUp();
+  EXPECT_EQ(reads, disk_manager->GetNumReads());
+
+  // Scenario: the id of a deleted page that is fetched again is not reused while it is pinned.
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[0]));
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(page_ids[1], page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[1], false));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+
+  // Scenario: once unpinned, reusing the id evicts the stale copy, whose eviction can't unmap the new page later.
+  Page *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(page_ids[0], page_id);
+  EXPECT_EQ(0, page->GetData()[0]);
+  snprintf(page->GetData(), PAGE_SIZE, "new page");
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  page = bpm->FetchPage(page_ids[0]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_STREQ("new page", page->GetData());
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+  remove("test.crc");
+  delete disk_manager;
+}
+
+/** Hands out one page near the end of the default tablespace from its free page map, as after a long run. */
+class NearlyFullDiskManager : public DiskManager {
+ public:
+  using DiskManager::DiskManager;
+  auto AllocateFreePage(uint32_t stride, uint32_t offset, tablespace_id_t tablespace_id) -> page_id_t override {
+    return std::exchange(free_page_id_, INVALID_PAGE_ID);
+  }
+
+ private:
+  page_id_t free_page_id_{FirstPageIdOf(DEFAULT_TABLESPACE_ID + 1) - 2};
+};
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, TablespaceLimitTest) {
+  auto *disk_manager = new NearlyFullDiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(3, disk_manager);
+
+  // Scenario: the last page ids of the tablespace are handed out.
+  page_id_t page_ids[2];
+  for (auto &page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  }
+  EXPECT_EQ(FirstPageIdOf(DEFAULT_TABLESPACE_ID + 1) - 2, page_ids[0]);
+  EXPECT_EQ(FirstPageIdOf(DEFAULT_TABLESPACE_ID + 1) - 1, page_ids[1]);
+
+  // Scenario: past them, NewPage fails instead of aborting, and keeps the frame it would have used.
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(INVALID_PAGE_ID, page_id);
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  ASSERT_NE(nullptr, bpm->FetchPage(0));
+  EXPECT_TRUE(bpm->UnpinPage(0, false));
+  // deleted rather than written, which would make a 64 GiB file
+  for (auto id : page_ids) {
+    EXPECT_TRUE(bpm->UnpinPage(id, false));
+    EXPECT_TRUE(bpm->DeletePage(id));
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+  remove("test.crc");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(BufferPoolManagerInstanceTest, ReadOnlyMmapTest) {
+  {
+    DiskManager disk_manager("test.db");
+    BufferPoolManagerInstance bpm(8, &disk_manager);
+    for (int i = 0; i < 8; ++i) {
+      page_id_t page_id;
+      Page *page = bpm.NewPage(&page_id);
+      ASSERT_NE(nullptr, page);
+      snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+      EXPECT_TRUE(bpm.UnpinPage(page_id, true));
+    }
+    bpm.FlushAllPages();
+    disk_manager.ShutDown();
+  }
+
+  auto *disk_manager = new DiskManager("test.db", true);
+  auto *bpm = new BufferPoolManagerInstance(2, disk_manager);
+  ASSERT_TRUE(disk_manager->IsReadOnly());
+
+  // Scenario: fetched pages point into the mapping of the file, and pin counts and latches work as usual.
+  for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(disk_manager->GetMappedPage(page_id), page->GetData());
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    EXPECT_EQ(page, bpm->FetchPage(page_id));
+    EXPECT_EQ(2, page->GetPinCount());
+    page->RLatch();
+    page->RUnlatch();
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  const page_id_t page_ids[] = {3, 5};
+  Page *pages[2];
+  ASSERT_EQ(2, bpm->FetchPages(page_ids, 2, pages));
+  EXPECT_EQ(disk_manager->GetMappedPage(5), pages[1]->GetData());
+  const bool is_dirty[] = {false, false};
+  EXPECT_TRUE(bpm->UnpinPages(page_ids, 2, is_dirty));
+  EXPECT_EQ(0, disk_manager->GetNumReads());
+
+  // Scenario: the file cannot change.
+  page_id_t page_id;
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id));
+  EXPECT_FALSE(bpm->DeletePage(3));
+  EXPECT_THROW(disk_manager->WritePage(0, pages[0]->GetData()), Exception);
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+  EXPECT_THROW(DiskManager("missing.db", true), Exception);
+  remove("test.db");
+  remove("test.log");
+}
+
 }  // namespace bustub
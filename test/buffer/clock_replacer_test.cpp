@@ -10,16 +10,22 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
 #include <cstdio>
+#include <iostream>
+#include <memory>
+#include <random>
 #include <thread>  // NOLINT
 #include <vector>
 
 #include "buffer/clock_replacer.h"
+#include "buffer/lru_k_replacer.h"
+#include "buffer/lru_replacer.h"
 #include "gtest/gtest.h"
 
 namespace bustub {
 
-TEST(ClockReplacerTest, DISABLED_SampleTest) {
+TEST(ClockReplacerTest, SampleTest) {
   ClockReplacer clock_replacer(7);
 
   // Scenario: unpin six elements, i.e. add them to the replacer.
@@ -59,4 +65,108 @@ TEST(ClockReplacerTest, DISABLED_SampleTest) {
   EXPECT_EQ(4, value);
 }
 
+// NOLINTNEXTLINE
+TEST(ClockReplacerTest, ConcurrencyTest) {
+  const int num_threads = 8;
+  const int frames_per_thread = 100;
+  ClockReplacer clock_replacer(num_threads * frames_per_thread);
+
+  // Every thread unpins its own frames, pins back half of them, and unpins them again.
+  std::vector<std::thread> threads;
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&clock_replacer, tid] {
+      for (frame_id_t i = tid * frames_per_thread; i < (tid + 1) * frames_per_thread; ++i) {
+        clock_replacer.Unpin(i);
+      }
+      for (frame_id_t i = tid * frames_per_thread; i < (tid + 1) * frames_per_thread; i += 2) {
+        clock_replacer.Pin(i);
+      }
+      for (frame_id_t i = tid * frames_per_thread; i < (tid + 1) * frames_per_thread; i += 4) {
+        clock_replacer.Unpin(i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(num_threads * frames_per_thread * 3 / 4, clock_replacer.Size());
+
+  // Concurrent victims hand out every evictable frame exactly once.
+  std::vector<std::vector<frame_id_t>> victims(num_threads);
+  threads.clear();
+  for (int tid = 0; tid < num_threads; ++tid) {
+    threads.emplace_back([&clock_replacer, &victims, tid] {
+      frame_id_t frame_id;
+      while (clock_replacer.Victim(&frame_id)) {
+        victims[tid].push_back(frame_id);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  std::vector<bool> seen(num_threads * frames_per_thread, false);
+  size_t num_victims = 0;
+  for (const auto &thread_victims : victims) {
+    for (auto frame_id : thread_victims) {
+      EXPECT_FALSE(seen[frame_id]);
+      EXPECT_TRUE(frame_id % 2 == 1 || frame_id % 4 == 0);
+      seen[frame_id] = true;
+      num_victims++;
+    }
+  }
+  EXPECT_EQ(num_threads * frames_per_thread * 3 / 4, num_victims);
+  EXPECT_EQ(0, clock_replacer.Size());
+}
+
+// NOLINTNEXTLINE
+TEST(ClockReplacerTest, DISABLED_ReplacerBenchmark) {
+  const size_t num_frames = 4096;
+  const int ops_per_thread = 200000;
+
+  for (int num_threads : {1, 8, 32}) {
+    for (int policy = 0; policy < 3; ++policy) {
+      std::unique_ptr<Replacer> replacer;
+      const char *name;
+      if (policy == 0) {
+        replacer = std::make_unique<LRUReplacer>(num_frames);
+        name = "LRU  ";
+      } else if (policy == 1) {
+        replacer = std::make_unique<LRUKReplacer>(num_frames, LRUK_REPLACER_K, LRUK_CORRELATED_PERIOD);
+        name = "LRU-K";
+      } else {
+        replacer = std::make_unique<ClockReplacer>(num_frames);
+        name = "Clock";
+      }
+      for (size_t i = 0; i < num_frames; ++i) {
+        replacer->Unpin(i);
+      }
+
+      // Each operation is one page access (pin, then unpin); every 16th access also evicts a frame.
+      auto start = std::chrono::steady_clock::now();
+      std::vector<std::thread> threads;
+      for (int tid = 0; tid < num_threads; ++tid) {
+        threads.emplace_back([&replacer, tid] {
+          std::mt19937 rng(tid);
+          std::uniform_int_distribution<frame_id_t> frame(0, num_frames - 1);
+          for (int i = 0; i < ops_per_thread; ++i) {
+            frame_id_t frame_id = frame(rng);
+            replacer->Pin(frame_id);
+            replacer->Unpin(frame_id);
+            if (i % 16 == 0 && replacer->Victim(&frame_id)) {
+              replacer->Unpin(frame_id);
+            }
+          }
+        });
+      }
+      for (auto &thread : threads) {
+        thread.join();
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << name << " " << num_threads << " threads: " << num_threads * ops_per_thread / elapsed / 1e6
+                << " M accesses/s" << std::endl;
+    }
+  }
+}
+
 }  // namespace bustub
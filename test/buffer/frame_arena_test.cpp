@@ -0,0 +1,67 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// frame_arena_test.cpp
+//
+// Identification: test/buffer/frame_arena_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "buffer/frame_arena.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, LayoutTest) {
+  const size_t num_frames = 1000;
+  FrameArena arena(num_frames);
+
+  // The frame data is one huge-page-aligned block of zeroed pages, in frame order.
+  EXPECT_EQ(0, reinterpret_cast<uintptr_t>(arena.GetData()) % FrameArena::HUGE_PAGE_SIZE);
+  for (size_t i = 0; i < num_frames; ++i) {
+    Page *page = &arena.GetPages()[i];
+    EXPECT_EQ(arena.GetData() + i * PAGE_SIZE, page->GetData());
+    EXPECT_EQ(INVALID_PAGE_ID, page->GetPageId());
+    EXPECT_EQ(0, page->GetPinCount());
+    EXPECT_EQ(0, page->GetData()[0]);
+    EXPECT_EQ(0, page->GetData()[PAGE_SIZE - 1]);
+  }
+
+  // Frames do not overlap.
+  arena.GetPages()[0].GetData()[PAGE_SIZE - 1] = 'a';
+  EXPECT_EQ(0, arena.GetPages()[1].GetData()[0]);
+}
+
+// NOLINTNEXTLINE
+TEST(FrameArenaTest, NumaNodeTest) {
+  // Node 0 exists on every Linux machine. If mbind is not permitted, the arena still works with first-touch placement.
+  FrameArena arena(10, 0);
+  arena.GetPages()[9].GetData()[0] = 'a';
+  EXPECT_EQ('a', arena.GetData()[9 * PAGE_SIZE]);
+
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(2, 5, disk_manager, nullptr, ReplacerPolicy::LRU, std::vector<int>{0});
+  page_id_t page_id;
+  Page *page = bpm->NewPage(&page_id);
+  ASSERT_NE(nullptr, page);
+  snprintf(page->GetData(), PAGE_SIZE, "Hello");
+  EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  EXPECT_TRUE(bpm->FlushPage(page_id));
+  delete bpm;
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -0,0 +1,262 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// lru_k_replacer_test.cpp
+//
+// Identification: test/buffer/lru_k_replacer_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <atomic>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+#include <random>
+#include <thread>  // NOLINT
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/lru_k_replacer.h"
+#include "concurrency/transaction.h"
+#include "container/hash/extendible_hash_table.h"
+#include "gtest/gtest.h"
+#include "logging/common.h"
+#include "storage/table/table_heap.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/** Pins and unpins a frame, the way the buffer pool reports one access to it. */
+static void Access(Replacer *replacer, frame_id_t frame_id) {
+  replacer->Pin(frame_id);
+  replacer->Unpin(frame_id);
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, SampleTest) {
+  LRUKReplacer lru_k_replacer(7, 2);
+
+  // Scenario: access six frames once, then frames 1 and 2 a second time.
+  for (frame_id_t i = 1; i <= 6; ++i) {
+    Access(&lru_k_replacer, i);
+  }
+  Access(&lru_k_replacer, 1);
+  Access(&lru_k_replacer, 2);
+  EXPECT_EQ(6, lru_k_replacer.Size());
+
+  // Scenario: frames with a single access go first, oldest first.
+  int value;
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(3, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(4, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(5, value);
+
+  // Scenario: pinning frame 6 takes it out of the replacer and gives it a second access.
+  lru_k_replacer.Pin(6);
+  EXPECT_EQ(2, lru_k_replacer.Size());
+  lru_k_replacer.Unpin(6);
+  lru_k_replacer.Unpin(6);
+  EXPECT_EQ(3, lru_k_replacer.Size());
+
+  // Scenario: the rest go by their second most recent access.
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(1, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(2, value);
+  lru_k_replacer.Victim(&value);
+  EXPECT_EQ(6, value);
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+  EXPECT_EQ(0, lru_k_replacer.Size());
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, ScanResistanceTest) {
+  LRUKReplacer lru_k_replacer(10, 2);
+
+  // Frames 0-3 hold a hot set that is accessed twice, frames 4-9 a scan that touches every page once.
+  for (int round = 0; round < 2; ++round) {
+    for (frame_id_t i = 0; i < 4; ++i) {
+      Access(&lru_k_replacer, i);
+    }
+  }
+  for (frame_id_t i = 4; i < 10; ++i) {
+    Access(&lru_k_replacer, i);
+  }
+
+  std::vector<frame_id_t> coldest;
+  lru_k_replacer.PeekVictims(7, &coldest);
+  EXPECT_EQ((std::vector<frame_id_t>{4, 5, 6, 7, 8, 9, 0}), coldest);
+
+  for (frame_id_t expected = 4; expected < 10; ++expected) {
+    frame_id_t value;
+    EXPECT_TRUE(lru_k_replacer.Victim(&value));
+    EXPECT_EQ(expected, value);
+  }
+  EXPECT_EQ(4, lru_k_replacer.Size());
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, CorrelatedReferenceTest) {
+  LRUKReplacer lru_k_replacer(10, 2, 2);
+
+  // Frame 0 is accessed three times in a row, like a scan reading every tuple of a page. That is one access.
+  for (int i = 0; i < 3; ++i) {
+    Access(&lru_k_replacer, 0);
+  }
+  // Frame 1 is accessed twice, with three other accesses in between.
+  Access(&lru_k_replacer, 1);
+  Access(&lru_k_replacer, 2);
+  Access(&lru_k_replacer, 3);
+  Access(&lru_k_replacer, 4);
+  Access(&lru_k_replacer, 1);
+
+  frame_id_t value;
+  for (frame_id_t expected : {0, 2, 3, 4, 1}) {
+    EXPECT_TRUE(lru_k_replacer.Victim(&value));
+    EXPECT_EQ(expected, value);
+  }
+  EXPECT_FALSE(lru_k_replacer.Victim(&value));
+}
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, BufferPoolScanResistanceTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(16, disk_manager, nullptr, ReplacerPolicy::LRU_K);
+
+  // Four hot pages, each used again after enough other accesses that it is not a correlated reference.
+  std::vector<page_id_t> hot_pages(4);
+  for (auto &page_id : hot_pages) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  std::vector<page_id_t> warm_pages(LRUK_CORRELATED_PERIOD);
+  for (auto &page_id : warm_pages) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  for (auto page_id : hot_pages) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+
+  // A stream of pages used once each, much larger than the pool.
+  for (int i = 0; i < 50; ++i) {
+    page_id_t page_id;
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // The hot pages are still resident.
+  int reads = disk_manager->GetNumReads();
+  for (auto page_id : hot_pages) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(reads, disk_manager->GetNumReads());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+/** A buffer pool instance that counts page fetches, to compute its hit ratio. */
+class CountingBufferPoolManager : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+  auto GetFetchCount() -> uint64_t { return fetches_; }
+
+ protected:
+  auto FetchPgImp(page_id_t page_id) -> Page * override {
+    fetches_++;
+    return BufferPoolManagerInstance::FetchPgImp(page_id);
+  }
+
+ private:
+  std::atomic<uint64_t> fetches_{0};
+};
+
+// NOLINTNEXTLINE
+TEST(LRUKReplacerTest, DISABLED_MixedWorkloadBenchmark) {
+  const size_t pool_size = 128;
+  const size_t num_tuples = 10000;
+  const int num_keys = 20000;
+  const int num_lookup_threads = 4;
+  const int lookups_per_thread = 50000;
+
+  Column col1{"a", TypeId::VARCHAR, 200};
+  Column col2{"b", TypeId::BIGINT};
+  Schema schema{std::vector<Column>{col1, col2}};
+  Tuple tuple = ConstructTuple(&schema);
+
+  for (auto policy : {ReplacerPolicy::LRU, ReplacerPolicy::LRU_K}) {
+    auto *disk_manager = new DiskManager("test.db");
+    auto *bpm = new CountingBufferPoolManager(pool_size, disk_manager, nullptr, policy);
+
+    // A table that does not fit in the pool, and an index whose pages do.
+    Transaction txn(0);
+    TableHeap table(bpm, nullptr, nullptr, &txn);
+    for (size_t i = 0; i < num_tuples; ++i) {
+      RID rid;
+      ASSERT_TRUE(table.InsertTuple(tuple, &rid, &txn));
+    }
+    ExtendibleHashTable<int, int, IntComparator> ht("index", bpm, IntComparator(), HashFunction<int>());
+    for (int i = 0; i < num_keys; ++i) {
+      ht.Insert(nullptr, i, i);
+    }
+    bpm->FlushAllPages();
+
+    uint64_t fetches = bpm->GetFetchCount();
+    int reads = disk_manager->GetNumReads();
+    std::atomic<bool> done{false};
+    auto start = std::chrono::steady_clock::now();
+
+    // One thread scans the table over and over while the others look keys up in the index.
+    std::thread scanner([&] {
+      Transaction scan_txn(1);
+      while (!done) {
+        for (auto iter = table.Begin(&scan_txn); iter != table.End() && !done; ++iter) {
+        }
+      }
+    });
+    std::vector<std::thread> lookups;
+    for (int tid = 0; tid < num_lookup_threads; ++tid) {
+      lookups.emplace_back([&, tid] {
+        std::mt19937 rng(tid);
+        std::uniform_int_distribution<int> key(0, num_keys - 1);
+        std::vector<int> result;
+        for (int i = 0; i < lookups_per_thread; ++i) {
+          result.clear();
+          ht.GetValue(nullptr, key(rng), &result);
+        }
+      });
+    }
+    for (auto &thread : lookups) {
+      thread.join();
+    }
+    done = true;
+    scanner.join();
+
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    uint64_t workload_fetches = bpm->GetFetchCount() - fetches;
+    int workload_reads = disk_manager->GetNumReads() - reads;
+    std::cout << (policy == ReplacerPolicy::LRU ? "LRU  " : "LRU-K") << ": " << workload_fetches << " fetches, "
+              << workload_reads << " reads, hit ratio "
+              << 1.0 - static_cast<double>(workload_reads) / static_cast<double>(workload_fetches) << ", "
+              << num_lookup_threads * lookups_per_thread / elapsed << " lookups/s" << std::endl;
+
+    delete bpm;
+    disk_manager->ShutDown();
+    remove("test.db");
+    remove("test.log");
+    delete disk_manager;
+  }
+}
+
+}  // namespace bustub
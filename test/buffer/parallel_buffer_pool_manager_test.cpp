@@ -10,6 +10,7 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <algorithm>
 #include "buffer/parallel_buffer_pool_manager.h"
 #include <cstdio>
 #include <random>
@@ -146,4 +147,187 @@ TEST(ParallelBufferPoolManagerTest, SampleTest) {
   delete disk_manager;
 }
 
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, ResizeTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(2, 2, disk_manager);
+
+  // Scenario: every instance is full of pinned pages until the pool grows.
+  page_id_t page_id_temp;
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  }
+  EXPECT_EQ(nullptr, bpm->NewPage(&page_id_temp));
+  EXPECT_TRUE(bpm->Resize(4));
+  EXPECT_EQ(8, bpm->GetPoolSize());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_NE(nullptr, bpm->NewPage(&page_id_temp));
+  }
+
+  // Scenario: shrinking needs the pages in the dropped frames to be unpinned.
+  EXPECT_FALSE(bpm->Resize(1));
+  EXPECT_EQ(8, bpm->GetPoolSize());
+
+  // Scenario: the first instance could shrink but the second can't, so the first one keeps its size as well.
+  for (page_id_t page_id = 0; page_id < 8; page_id += 2) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  EXPECT_FALSE(bpm->Resize(1));
+  EXPECT_EQ(8, bpm->GetPoolSize());
+  for (page_id_t page_id = 1; page_id < 8; page_id += 2) {
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  EXPECT_TRUE(bpm->Resize(1));
+  EXPECT_EQ(2, bpm->GetPoolSize());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, FetchPagesTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(2, 4, disk_manager);
+
+  // Sixteen pages over two instances of four frames: pages 8-15 stay resident.
+  for (int i = 0; i < 16; ++i) {
+    page_id_t page_id;
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+
+  // Scenario: a batch that mixes misses on both instances, a hit and a repeated page.
+  const page_id_t page_ids[] = {0, 1, 2, 3, 9, 0};
+  Page *pages[6];
+  int reads = disk_manager->GetNumReads();
+  EXPECT_EQ(6, bpm->FetchPages(page_ids, 6, pages));
+  EXPECT_EQ(reads + 4, disk_manager->GetNumReads());
+  for (int i = 0; i < 6; ++i) {
+    ASSERT_NE(nullptr, pages[i]);
+    EXPECT_EQ(page_ids[i], pages[i]->GetPageId());
+    EXPECT_EQ("page " + std::to_string(page_ids[i]), std::string(pages[i]->GetData()));
+  }
+  EXPECT_EQ(pages[0], pages[5]);
+  EXPECT_EQ(2, pages[0]->GetPinCount());
+  const bool is_dirty[] = {false, false, true, false, false, false};
+  EXPECT_TRUE(bpm->UnpinPages(page_ids, 6, is_dirty));
+  EXPECT_EQ(0, pages[0]->GetPinCount());
+
+  // Scenario: an instance with fewer frames than requested pages fetches what fits.
+  const page_id_t more_page_ids[] = {0, 2, 4, 6, 8};
+  Page *more_pages[5];
+  EXPECT_EQ(4, bpm->FetchPages(more_page_ids, 5, more_pages));
+  EXPECT_EQ(1, std::count(more_pages, more_pages + 5, nullptr));
+  for (int i = 0; i < 5; ++i) {
+    if (more_pages[i] != nullptr) {
+      EXPECT_TRUE(bpm->UnpinPage(more_page_ids[i], false));
+    }
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, FlushAllPagesTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(2, 8, disk_manager);
+
+  std::vector<page_id_t> page_ids(16);
+  for (auto &page_id : page_ids) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, page_id % 4 != 0));
+  }
+
+  // Scenario: new pages are dirty until they are first written, so all pages of both instances are written, and made
+  // durable with a single sync.
+  int writes = disk_manager->GetNumWrites();
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + 16, disk_manager->GetNumWrites());
+  EXPECT_EQ(1, disk_manager->GetNumSyncs());
+
+  // Scenario: the next flush only writes the pages dirtied since.
+  for (auto page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, page_id % 4 != 0));
+  }
+  bpm->FlushAllPages();
+  EXPECT_EQ(writes + 28, disk_manager->GetNumWrites());
+  EXPECT_EQ(2, disk_manager->GetNumSyncs());
+
+  // Scenario: flushing one dirty page syncs it as well.
+  ASSERT_NE(nullptr, bpm->FetchPage(page_ids[1]));
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[1], true));
+  EXPECT_TRUE(bpm->FlushPage(page_ids[1]));
+  EXPECT_EQ(3, disk_manager->GetNumSyncs());
+
+  delete bpm;
+  char buf[PAGE_SIZE];
+  for (auto page_id : page_ids) {
+    disk_manager->ReadPage(page_id, buf);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(buf));
+  }
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(ParallelBufferPoolManagerTest, PageReuseTest) {
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new ParallelBufferPoolManager(2, 8, disk_manager);
+
+  std::vector<page_id_t> page_ids(16);
+  for (auto &page_id : page_ids) {
+    ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  bpm->FlushAllPages();
+  EXPECT_EQ(16, disk_manager->GetNumPages());
+
+  // Scenario: deleted pages are handed out again, each by the instance its id maps to, before any new id.
+  for (page_id_t page_id : {2, 5, 14, 15}) {
+    EXPECT_TRUE(bpm->DeletePage(page_id));
+  }
+  EXPECT_EQ(4, disk_manager->GetNumFreePages());
+  std::vector<page_id_t> reused(4);
+  for (auto &page_id : reused) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ(page_id, page->GetPageId());
+    EXPECT_EQ(0, page->GetData()[0]);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  std::sort(reused.begin(), reused.end());
+  EXPECT_EQ((std::vector<page_id_t>{2, 5, 14, 15}), reused);
+  page_id_t page_id;
+  ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+  EXPECT_EQ(16, page_id);
+  EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+
+  // Scenario: compaction cuts the trailing free pages off the file while the pool is running.
+  EXPECT_TRUE(bpm->DeletePage(14));
+  EXPECT_TRUE(bpm->DeletePage(15));
+  EXPECT_EQ(2, disk_manager->TruncateFreeTail());
+  EXPECT_EQ(14, disk_manager->GetNumPages());
+
+  delete bpm;
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  remove("test.fsm");
+  delete disk_manager;
+}
+
 }  // namespace bustub
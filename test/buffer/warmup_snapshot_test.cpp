@@ -0,0 +1,162 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// warmup_snapshot_test.cpp
+//
+// Identification: test/buffer/warmup_snapshot_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "buffer/warmup_snapshot.h"
+
+#include <algorithm>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+// NOLINTNEXTLINE
+TEST(WarmupSnapshotTest, FileTest) {
+  std::vector<page_id_t> page_ids{7, 3, 12, 0};
+  ASSERT_TRUE(WarmupSnapshot::Write("test.warm", page_ids));
+  std::vector<page_id_t> read_page_ids;
+  ASSERT_TRUE(WarmupSnapshot::Read("test.warm", &read_page_ids));
+  EXPECT_EQ(page_ids, read_page_ids);
+
+  // Scenario: a missing or truncated snapshot is not used.
+  EXPECT_FALSE(WarmupSnapshot::Read("missing.warm", &read_page_ids));
+  {
+    std::ofstream out("test.warm", std::ios::binary | std::ios::trunc);
+    out.write("BTWU", 4);
+  }
+  EXPECT_FALSE(WarmupSnapshot::Read("test.warm", &read_page_ids));
+  remove("test.warm");
+}
+
+// NOLINTNEXTLINE
+TEST(WarmupSnapshotTest, WarmUpTest) {
+  const size_t pool_size = 10;
+  auto *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+
+  // Twice as many pages as frames; the last ones touched are the hot set.
+  std::vector<page_id_t> page_ids(2 * pool_size);
+  for (auto &page_id : page_ids) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  std::vector<page_id_t> hot_page_ids{3, 17, 5, 11, 0, 8, 14, 2, 19, 6};
+  for (auto iter = hot_page_ids.rbegin(); iter != hot_page_ids.rend(); ++iter) {
+    ASSERT_NE(nullptr, bpm->FetchPage(*iter));
+    EXPECT_TRUE(bpm->UnpinPage(*iter, false));
+  }
+  std::vector<page_id_t> resident;
+  bpm->GetResidentPages(&resident);
+  EXPECT_EQ(hot_page_ids, resident);
+  ASSERT_TRUE(bpm->DumpWarmupSnapshot("test.warm"));
+  bpm->FlushAllPages();
+  delete bpm;
+
+  // Scenario: a restarted pool loads the hot set and serves it without further reads, in the same replacer order.
+  bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+  ASSERT_TRUE(bpm->LoadWarmupSnapshot("test.warm"));
+  bpm->WaitForWarmUp();
+  EXPECT_EQ(pool_size, bpm->GetWarmedPageCount());
+  resident.clear();
+  bpm->GetResidentPages(&resident);
+  EXPECT_EQ(hot_page_ids, resident);
+  int reads = disk_manager->GetNumReads();
+  for (auto page_id : hot_page_ids) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(reads, disk_manager->GetNumReads());
+  delete bpm;
+
+  // Scenario: warm-up never evicts, so a pool that is already in use only gets its free frames filled.
+  bpm = new BufferPoolManagerInstance(pool_size, disk_manager);
+  for (page_id_t page_id = 0; page_id < 8; ++page_id) {
+    ASSERT_NE(nullptr, bpm->FetchPage(page_id));
+  }
+  ASSERT_TRUE(bpm->LoadWarmupSnapshot("test.warm"));
+  bpm->WaitForWarmUp();
+  EXPECT_EQ(2, bpm->GetWarmedPageCount());
+  delete bpm;
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  remove("test.warm");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(WarmupSnapshotTest, DISABLED_TimeToWarmBenchmark) {
+  const size_t num_pages = 16384;
+  const size_t pool_size = 4096;
+  auto *disk_manager = new DiskManager("test.db");
+  {
+    BufferPoolManagerInstance bpm(pool_size, disk_manager);
+    for (size_t i = 0; i < num_pages; ++i) {
+      page_id_t page_id;
+      ASSERT_NE(nullptr, bpm.NewPage(&page_id));
+      EXPECT_TRUE(bpm.UnpinPage(page_id, true));
+    }
+  }
+
+  // The hot set is a random quarter of the file, in the order a workload touches it.
+  std::vector<page_id_t> hot_page_ids(num_pages);
+  for (size_t i = 0; i < num_pages; ++i) {
+    hot_page_ids[i] = static_cast<page_id_t>(i);
+  }
+  std::shuffle(hot_page_ids.begin(), hot_page_ids.end(), std::mt19937(15445));
+  hot_page_ids.resize(pool_size);
+  ASSERT_TRUE(WarmupSnapshot::Write("test.warm", hot_page_ids));
+
+  for (int run = 0; run < 3; ++run) {
+    // Cold start: every first access to the hot set is a miss, in workload order.
+    auto start = std::chrono::steady_clock::now();
+    {
+      BufferPoolManagerInstance bpm(pool_size, disk_manager);
+      for (auto page_id : hot_page_ids) {
+        ASSERT_NE(nullptr, bpm.FetchPage(page_id));
+        bpm.UnpinPage(page_id, false);
+      }
+    }
+    auto cold = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Warm start: the snapshot is loaded in page id order before the workload runs.
+    start = std::chrono::steady_clock::now();
+    {
+      BufferPoolManagerInstance bpm(pool_size, disk_manager);
+      ASSERT_TRUE(bpm.LoadWarmupSnapshot("test.warm"));
+      bpm.WaitForWarmUp();
+      EXPECT_EQ(pool_size, bpm.GetWarmedPageCount());
+    }
+    auto warm = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << pool_size << " hot pages: on-demand " << cold << " s, warm-up " << warm << " s" << std::endl;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  remove("test.warm");
+  delete disk_manager;
+}
+
+}  // namespace bustub
@@ -19,6 +19,7 @@
 #include "catalog/table_generator.h"
 #include "execution/executor_context.h"
 #include "gtest/gtest.h"
+#include "storage/disk/tablespace_disk_manager.h"
 #include "type/value_factory.h"
 
 namespace bustub {
@@ -688,4 +689,94 @@ TEST(CatalogTest, DISABLED_IndexInteraction3) {
   remove("catalog_test.log");
 }
 
+TEST(CatalogTest, TablespaceTest) {
+  auto disk_manager = std::make_unique<TablespaceDiskManager>("catalog_test.db");
+  disk_manager->AddTablespace(1, std::make_unique<DiskManager>("catalog_test_tables.db"));
+  disk_manager->AddTablespace(2, std::make_unique<DiskManager>("catalog_test_indexes.db"));
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  std::vector<Column> columns{};
+  columns.emplace_back("A", TypeId::BIGINT);
+  Schema schema{columns};
+  std::vector<uint32_t> key_attrs{0};
+
+  // The table's pages and the index's pages are allocated in the tablespaces they were created in
+  auto *table_info = catalog->CreateTable(txn.get(), "foobar", schema, 1);
+  ASSERT_NE(Catalog::NULL_TABLE_INFO, table_info);
+  EXPECT_EQ(1, table_info->tablespace_id_);
+  EXPECT_EQ(1, TablespaceOf(table_info->table_->GetFirstPageId()));
+  auto *index_info = catalog->CreateIndex<BigintKeyType, BigintValueType, BigintComparatorType>(
+      txn.get(), "index1", "foobar", schema, schema, key_attrs, BIGINT_SIZE, BigintHashFunctionType{}, 2);
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  EXPECT_EQ(2, index_info->tablespace_id_);
+
+  // Nothing but the tablespaces' files is written once the pages are flushed
+  bpm->FlushAllPages();
+  EXPECT_EQ(0, disk_manager->GetNumPages());
+  EXPECT_LT(0, disk_manager->GetNumWrites());
+
+  disk_manager->ShutDown();
+  for (const std::string name : {"catalog_test", "catalog_test_tables", "catalog_test_indexes"}) {
+    for (const char *extension : {".db", ".log", ".crc", ".fsm"}) {
+      remove((name + extension).c_str());
+    }
+  }
+}
+
+// NOLINTNEXTLINE
+TEST(CatalogTest, BulkBuildIndexTest) {
+  auto disk_manager = std::make_unique<DiskManager>("catalog_test.db");
+  auto bpm = std::make_unique<BufferPoolManagerInstance>(32, disk_manager.get());
+  auto catalog = std::make_unique<Catalog>(bpm.get(), nullptr, nullptr);
+  auto txn = std::make_unique<Transaction>(0);
+
+  std::vector<Column> columns{};
+  columns.emplace_back("A", TypeId::BIGINT);
+  columns.emplace_back("B", TypeId::INTEGER);
+  Schema schema{columns};
+  std::vector<uint32_t> key_attrs{0};
+  Schema key_schema{std::vector<Column>{columns[0]}};
+
+  // Enough rows for many buckets, some of them deleted, and a duplicate key
+  auto *table_info = catalog->CreateTable(txn.get(), "foobar", schema);
+  const int64_t num_rows = 5000;
+  std::vector<RID> rids;
+  for (int64_t i = 0; i < num_rows; i++) {
+    Tuple tuple{{ValueFactory::GetBigIntValue(i), ValueFactory::GetIntegerValue(static_cast<int32_t>(i))}, &schema};
+    RID rid;
+    ASSERT_TRUE(table_info->table_->InsertTuple(tuple, &rid, txn.get()));
+    rids.push_back(rid);
+  }
+  for (int64_t i = 0; i < num_rows; i += 10) {
+    ASSERT_TRUE(table_info->table_->MarkDelete(rids[i], txn.get()));
+  }
+  Tuple duplicate{{ValueFactory::GetBigIntValue(1), ValueFactory::GetIntegerValue(-1)}, &schema};
+  RID duplicate_rid;
+  ASSERT_TRUE(table_info->table_->InsertTuple(duplicate, &duplicate_rid, txn.get()));
+
+  auto *index_info = catalog->CreateIndex<BigintKeyType, BigintValueType, BigintComparatorType>(
+      txn.get(), "index1", "foobar", schema, key_schema, key_attrs, BIGINT_SIZE, BigintHashFunctionType{});
+  ASSERT_NE(Catalog::NULL_INDEX_INFO, index_info);
+  for (int64_t i = 0; i < num_rows; i++) {
+    Tuple key{{ValueFactory::GetBigIntValue(i)}, &key_schema};
+    std::vector<RID> result;
+    index_info->index_->ScanKey(key, &result, txn.get());
+    if (i % 10 == 0) {
+      EXPECT_TRUE(result.empty()) << "Indexed deleted row " << i;
+    } else if (i == 1) {
+      EXPECT_EQ(2, result.size());
+    } else {
+      ASSERT_EQ(1, result.size()) << "Failed to index row " << i;
+      EXPECT_EQ(rids[i], result[0]);
+    }
+  }
+
+  disk_manager->ShutDown();
+  for (const char *extension : {".db", ".log", ".crc", ".fsm"}) {
+    remove((std::string("catalog_test") + extension).c_str());
+  }
+}
+
 }  // namespace bustub
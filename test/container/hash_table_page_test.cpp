@@ -10,6 +10,9 @@
 //
 //===----------------------------------------------------------------------===//
 
+#include <chrono>  // NOLINT
+#include <iostream>
+#include <random>
 #include <thread>  // NOLINT
 #include <vector>
 
@@ -114,4 +117,51 @@ TEST(HashTablePageTest, BucketPageSampleTest) {
   delete bpm;
 }
 
+// NOLINTNEXTLINE
+TEST(HashTablePageTest, DISABLED_BucketProbeBenchmark) {
+  // Probes of a full bucket; a miss has to rule out every slot.
+  const int num_probes = 1000000;
+  DiskManager *disk_manager = new DiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(5, disk_manager);
+  page_id_t bucket_page_id = INVALID_PAGE_ID;
+  auto bucket_page = reinterpret_cast<HashTableBucketPage<int, int, IntComparator> *>(
+      bpm->NewPage(&bucket_page_id, nullptr)->GetData());
+  int num_pairs = 0;
+  while (!bucket_page->IsFull()) {
+    ASSERT_TRUE(bucket_page->Insert(num_pairs, num_pairs, IntComparator()));
+    num_pairs++;
+  }
+
+  std::mt19937 rng(15445);
+  std::uniform_int_distribution<int> key_dist(0, num_pairs - 1);
+  auto time_probes = [&](int key_offset, size_t expected_size) {
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_probes; i++) {
+      std::vector<int> res;
+      bucket_page->GetValue(key_dist(rng) + key_offset, IntComparator(), &res);
+      EXPECT_EQ(expected_size, res.size());
+    }
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / num_probes;
+  };
+  double hit_ns = time_probes(0, 1);
+  double miss_ns = time_probes(num_pairs, 0);
+
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_probes; i++) {
+    int key = key_dist(rng);
+    ASSERT_TRUE(bucket_page->Remove(key, key, IntComparator()));
+    ASSERT_TRUE(bucket_page->Insert(key, key, IntComparator()));
+  }
+  double update_ns =
+      std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / num_probes;
+  std::cout << "bucket of " << num_pairs << " pairs: " << hit_ns << " ns per hit, " << miss_ns << " ns per miss, "
+            << update_ns << " ns per remove and insert" << std::endl;
+
+  bpm->UnpinPage(bucket_page_id, true, nullptr);
+  disk_manager->ShutDown();
+  remove("test.db");
+  delete disk_manager;
+  delete bpm;
+}
+
 }  // namespace bustub
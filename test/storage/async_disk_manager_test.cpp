@@ -0,0 +1,362 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// async_disk_manager_test.cpp
+//
+// Identification: test/storage/async_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/async_disk_manager.h"
+
+#include <atomic>
+#include <chrono>              // NOLINT
+#include <condition_variable>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <mutex>  // NOLINT
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/exception.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+class AsyncDiskManagerTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+    remove("test.crc");
+  }
+
+  void TearDown() override {
+    remove("test.db");
+    remove("test.log");
+    remove("test.fsm");
+    remove("test.crc");
+  }
+};
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, ReadWritePageTest) {
+  char buf[PAGE_SIZE] = {0};
+  char data[PAGE_SIZE] = {0};
+  AsyncDiskManager dm("test.db", 8, GetParam());
+  std::strncpy(data, "A test string.", sizeof(data));
+
+  // Scenario: a page past the end of the file reads as zeros.
+  memset(buf, 1, sizeof(buf));
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(0, buf[0]);
+  EXPECT_EQ(0, buf[PAGE_SIZE - 1]);
+
+  dm.WritePage(0, data);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+
+  std::memset(buf, 0, sizeof(buf));
+  dm.WritePage(5, data);
+  dm.ReadPage(5, buf);
+  EXPECT_EQ(std::memcmp(buf, data, sizeof(buf)), 0);
+  EXPECT_EQ(6, dm.GetNumPages());
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, AsyncTest) {
+  const int num_pages = 100;
+  AsyncDiskManager dm("test.db", 8, GetParam());
+  EXPECT_EQ(GetParam(), dm.IsIoUring());
+
+  // Scenario: more writes than the queue depth are in flight; every one of them completes.
+  std::vector<std::vector<char>> pages(num_pages, std::vector<char>(PAGE_SIZE));
+  std::atomic<int> completed{0};
+  for (int i = 0; i < num_pages; ++i) {
+    snprintf(pages[i].data(), PAGE_SIZE, "page %d", i);
+    dm.WritePageAsync(i, pages[i].data(), [&completed](bool ok) {
+      EXPECT_TRUE(ok);
+      completed++;
+    });
+  }
+  dm.WaitForAll();
+  EXPECT_EQ(num_pages, completed);
+  EXPECT_EQ(num_pages, dm.GetNumWrites());
+
+  // Scenario: a batch read returns every page, in any order.
+  std::vector<page_id_t> page_ids(num_pages);
+  std::vector<std::vector<char>> buffers(num_pages, std::vector<char>(PAGE_SIZE));
+  std::vector<char *> buffer_ptrs(num_pages);
+  for (int i = 0; i < num_pages; ++i) {
+    page_ids[i] = num_pages - 1 - i;
+    buffer_ptrs[i] = buffers[i].data();
+  }
+  dm.ReadPages(page_ids.data(), buffer_ptrs.data(), num_pages);
+  for (int i = 0; i < num_pages; ++i) {
+    EXPECT_EQ("page " + std::to_string(page_ids[i]), std::string(buffers[i].data()));
+  }
+  EXPECT_EQ(num_pages, dm.GetNumReads());
+
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, WritePagesTest) {
+  AsyncDiskManager dm("test.db", 4, GetParam(), true);
+
+  // Scenario: a long run, written with vectored writes, and a few scattered pages, more requests than the queue depth.
+  std::vector<page_id_t> page_ids;
+  for (page_id_t page_id = 40; page_id >= 0; --page_id) {
+    if (page_id < 20 || page_id % 3 == 0) {
+      page_ids.push_back(page_id);
+    }
+  }
+  std::vector<std::vector<char>> pages(page_ids.size(), std::vector<char>(PAGE_SIZE));
+  std::vector<const char *> page_data(page_ids.size());
+  for (size_t i = 0; i < page_ids.size(); ++i) {
+    snprintf(pages[i].data(), PAGE_SIZE, "page %d", page_ids[i]);
+    page_data[i] = pages[i].data();
+  }
+  dm.WritePages(page_ids.data(), page_data.data(), page_ids.size());
+  dm.Sync();
+  EXPECT_EQ(page_ids.size(), dm.GetNumWrites());
+  EXPECT_EQ(1, dm.GetNumSyncs());
+
+  char buf[PAGE_SIZE];
+  for (auto page_id : page_ids) {
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(buf));
+  }
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, BufferPoolTest) {
+  auto *disk_manager = new AsyncDiskManager("test.db", 8, GetParam());
+  auto *bpm = new BufferPoolManagerInstance(4, disk_manager);
+
+  std::vector<page_id_t> page_ids(12);
+  for (auto &page_id : page_ids) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  Page *pages[4];
+  EXPECT_EQ(4, bpm->FetchPages(page_ids.data(), 4, pages));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ("page " + std::to_string(page_ids[i]), std::string(pages[i]->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_ids[i], false));
+  }
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, DirectIoTest) {
+  auto *disk_manager = new AsyncDiskManager("test.db", 8, GetParam(), true);
+  if (!disk_manager->IsDirectIo()) {
+    // The file system does not do O_DIRECT; the fallback has to work all the same.
+    std::cout << "O_DIRECT is not supported here, testing the buffered fallback" << std::endl;
+  }
+  // The O_DIRECT probe writes past the end of the file, and cuts it back.
+  EXPECT_EQ(0, disk_manager->GetNumPages());
+
+  // Scenario: aligned buffers are used as is, unaligned ones are copied through a bounce buffer.
+  alignas(DIRECT_IO_ALIGNMENT) char aligned[PAGE_SIZE] = {0};
+  std::vector<char> unaligned_storage(PAGE_SIZE + 8);
+  char *unaligned = unaligned_storage.data() + (reinterpret_cast<uintptr_t>(unaligned_storage.data()) % 2 == 0 ? 1 : 0);
+  snprintf(aligned, PAGE_SIZE, "aligned");
+  snprintf(unaligned, PAGE_SIZE, "unaligned");
+  disk_manager->WritePage(0, aligned);
+  disk_manager->WritePage(1, unaligned);
+  disk_manager->ReadPage(0, unaligned);
+  EXPECT_EQ("aligned", std::string(unaligned));
+  disk_manager->ReadPage(1, aligned);
+  EXPECT_EQ("unaligned", std::string(aligned));
+  EXPECT_EQ(disk_manager->IsDirectIo() ? 2 : 0, disk_manager->GetNumBouncedIos());
+
+  // Scenario: buffer pool frames are aligned, so the pool never needs a bounce buffer.
+  uint64_t bounced = disk_manager->GetNumBouncedIos();
+  auto *bpm = new BufferPoolManagerInstance(4, disk_manager);
+  std::vector<page_id_t> page_ids(12);
+  for (auto &page_id : page_ids) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    snprintf(page->GetData(), PAGE_SIZE, "page %d", page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  for (auto page_id : page_ids) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    EXPECT_EQ("page " + std::to_string(page_id), std::string(page->GetData()));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  EXPECT_EQ(bounced, disk_manager->GetNumBouncedIos());
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+
+  // Scenario: probing an existing file leaves its size and its pages alone.
+  disk_manager = new AsyncDiskManager("test.db", 8, GetParam(), true);
+  size_t num_pages = disk_manager->GetNumPages();
+  EXPECT_LE(page_ids.back() + 1, num_pages);
+  disk_manager->ReadPage(page_ids.back(), aligned);
+  EXPECT_EQ("page " + std::to_string(page_ids.back()), std::string(aligned));
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_P(AsyncDiskManagerTest, ChecksumTest) {
+  char data[PAGE_SIZE];
+  memset(data, 'c', sizeof(data));
+  {
+    AsyncDiskManager dm("test.db", 8, GetParam());
+    dm.WritePage(0, data);
+    dm.ShutDown();
+  }
+  {
+    std::fstream file("test.db", std::ios::binary | std::ios::in | std::ios::out);
+    file.seekp(100);
+    file.put('d');
+  }
+
+  // Scenario: a corrupt page is reported by every read path, and counted once per read.
+  AsyncDiskManager dm("test.db", 8, GetParam());
+  char buf[PAGE_SIZE];
+  EXPECT_THROW(dm.ReadPage(0, buf), Exception);
+  EXPECT_EQ(1, dm.GetNumChecksumFailures());
+  const page_id_t page_ids[] = {0};
+  char *page_data[] = {buf};
+  EXPECT_THROW(dm.ReadPages(page_ids, page_data, 1), Exception);
+  EXPECT_EQ(2, dm.GetNumChecksumFailures());
+  std::atomic<bool> read_ok{true};
+  dm.ReadPageAsync(0, buf, [&read_ok](bool ok) { read_ok = ok; });
+  dm.WaitForAll();
+  EXPECT_FALSE(read_ok);
+  EXPECT_EQ(3, dm.GetNumChecksumFailures());
+  dm.ShutDown();
+}
+
+INSTANTIATE_TEST_SUITE_P(Backends, AsyncDiskManagerTest, ::testing::Values(true, false));
+
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerBenchmark, DISABLED_GroupCommitBenchmark) {
+  const size_t num_pages = 4096;
+  for (bool async : {false, true}) {
+    for (bool group_commit : {false, true}) {
+      remove("test.db");
+      DiskManager *disk_manager = async ? new AsyncDiskManager("test.db") : new DiskManager("test.db");
+      auto *bpm = new BufferPoolManagerInstance(num_pages, disk_manager);
+      // A bulk load: every page is new and dirty.
+      std::vector<page_id_t> page_ids(num_pages);
+      for (auto &page_id : page_ids) {
+        ASSERT_NE(nullptr, bpm->NewPage(&page_id));
+        bpm->UnpinPage(page_id, true);
+      }
+      auto start = std::chrono::steady_clock::now();
+      if (group_commit) {
+        bpm->FlushAllPages();
+      } else {
+        // Every page written and synced on its own, like a write path that flushes per page.
+        for (auto page_id : page_ids) {
+          bpm->FlushPage(page_id);
+        }
+      }
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << (async ? "async  " : "fstream") << (group_commit ? " batch + one sync" : " per-page sync   ") << ": "
+                << num_pages / elapsed << " pages/s, " << disk_manager->GetNumSyncs() << " syncs" << std::endl;
+      delete bpm;
+      disk_manager->ShutDown();
+      delete disk_manager;
+    }
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+// NOLINTNEXTLINE
+TEST(AsyncDiskManagerBenchmark, DISABLED_QueueDepthBenchmark) {
+  const int num_pages = 16384;
+  const int num_reads = 65536;
+  remove("test.db");
+  {
+    DiskManager dm("test.db");
+    char data[PAGE_SIZE] = {0};
+    for (int i = 0; i < num_pages; ++i) {
+      dm.WritePage(i, data);
+    }
+    dm.ShutDown();
+  }
+
+  std::vector<page_id_t> page_ids(num_reads);
+  std::mt19937 rng(15445);
+  std::uniform_int_distribution<page_id_t> page(0, num_pages - 1);
+  for (auto &page_id : page_ids) {
+    page_id = page(rng);
+  }
+
+  {
+    // Baseline: the fstream DiskManager, one read at a time.
+    DiskManager dm("test.db");
+    char buf[PAGE_SIZE];
+    auto start = std::chrono::steady_clock::now();
+    for (auto page_id : page_ids) {
+      dm.ReadPage(page_id, buf);
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "fstream          : " << num_reads / elapsed << " reads/s" << std::endl;
+    dm.ShutDown();
+  }
+
+  for (bool use_io_uring : {true, false}) {
+    for (uint32_t queue_depth = 1; queue_depth <= 64; queue_depth *= 2) {
+      AsyncDiskManager dm("test.db", queue_depth, use_io_uring);
+      std::vector<char> buffers(static_cast<size_t>(queue_depth) * PAGE_SIZE);
+      // Every buffer has one read in flight; a completion puts its buffer back for the next read.
+      std::mutex latch;
+      std::condition_variable cv;
+      std::vector<char *> free_buffers;
+      for (uint32_t i = 0; i < queue_depth; ++i) {
+        free_buffers.push_back(&buffers[static_cast<size_t>(i) * PAGE_SIZE]);
+      }
+      auto start = std::chrono::steady_clock::now();
+      for (auto page_id : page_ids) {
+        char *buffer;
+        {
+          std::unique_lock<std::mutex> lock(latch);
+          cv.wait(lock, [&] { return !free_buffers.empty(); });
+          buffer = free_buffers.back();
+          free_buffers.pop_back();
+        }
+        dm.ReadPageAsync(page_id, buffer, [&, buffer](bool ok) {
+          std::lock_guard<std::mutex> guard(latch);
+          free_buffers.push_back(buffer);
+          cv.notify_one();
+        });
+      }
+      dm.WaitForAll();
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << (use_io_uring ? "io_uring" : "threads ") << " depth " << queue_depth << "\t: "
+                << num_reads / elapsed << " reads/s" << std::endl;
+      dm.ShutDown();
+    }
+  }
+  remove("test.db");
+  remove("test.log");
+}
+
+}  // namespace bustub
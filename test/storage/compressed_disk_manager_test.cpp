@@ -0,0 +1,293 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// compressed_disk_manager_test.cpp
+//
+// Identification: test/storage/compressed_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/compressed_disk_manager.h"
+
+#include <sys/stat.h>
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "common/exception.h"
+#include "common/util/lz_codec.h"
+#include "gtest/gtest.h"
+
+namespace bustub {
+
+class CompressedDiskManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { RemoveFiles(); }
+
+  void TearDown() override { RemoveFiles(); }
+
+  static void RemoveFiles() {
+    for (const char *file : {"test.db", "test.log", "test.ext", "test.crc", "test.fsm"}) {
+      remove(file);
+    }
+  }
+};
+
+/** Fills a page the way a table heap of integer columns looks: fixed size tuples of small integers and padding. */
+static void FillTablePage(char *page, int first_row) {
+  memset(page, 0, PAGE_SIZE);
+  const size_t tuple_size = 32;
+  for (size_t slot = 0; (slot + 1) * tuple_size <= PAGE_SIZE; ++slot) {
+    int32_t columns[3] = {first_row + static_cast<int32_t>(slot), static_cast<int32_t>(slot % 10), 15445};
+    memcpy(page + slot * tuple_size, columns, sizeof(columns));
+  }
+}
+
+static void FillRandomPage(char *page, uint32_t seed) {
+  std::mt19937 rng(seed);
+  for (size_t i = 0; i < PAGE_SIZE; ++i) {
+    page[i] = static_cast<char>(rng());
+  }
+}
+
+static auto FileSize(const char *file_name) -> size_t {
+  struct stat stat_buf;
+  return stat(file_name, &stat_buf) == 0 ? static_cast<size_t>(stat_buf.st_size) : 0;
+}
+
+// NOLINTNEXTLINE
+TEST(LzCodecTest, RoundTripTest) {
+  char page[PAGE_SIZE];
+  char compressed[LzCodec::MaxCompressedSize(PAGE_SIZE)];
+  char decompressed[PAGE_SIZE];
+  for (int kind = 0; kind < 4; ++kind) {
+    if (kind == 0) {
+      memset(page, 0, PAGE_SIZE);
+    } else if (kind == 1) {
+      FillTablePage(page, 1000);
+    } else if (kind == 2) {
+      FillRandomPage(page, 15445);
+    } else {
+      // random bytes with repeated stretches, to get long literal runs next to long matches
+      FillRandomPage(page, 721);
+      memset(page + 1000, 'a', 700);
+      memcpy(page + 3000, page + 10, 900);
+    }
+    size_t size = LzCodec::Compress(page, PAGE_SIZE, compressed, sizeof(compressed));
+    ASSERT_NE(0, size);
+    if (kind < 2) {
+      EXPECT_LT(size, PAGE_SIZE / 4);
+    }
+    EXPECT_EQ(PAGE_SIZE, LzCodec::Decompress(compressed, size, decompressed, PAGE_SIZE));
+    EXPECT_EQ(0, memcmp(page, decompressed, PAGE_SIZE));
+
+    // Scenario: truncated input or a short output buffer fail instead of running out of bounds.
+    EXPECT_NE(PAGE_SIZE, LzCodec::Decompress(compressed, size / 2, decompressed, PAGE_SIZE));
+    EXPECT_EQ(0, LzCodec::Decompress(compressed, size, decompressed, PAGE_SIZE - 1));
+  }
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, ReadWritePageTest) {
+  char page[PAGE_SIZE];
+  char buf[PAGE_SIZE];
+  {
+    CompressedDiskManager dm("test.db");
+    // Scenario: a page that was never written reads as zeros.
+    memset(buf, 1, PAGE_SIZE);
+    dm.ReadPage(3, buf);
+    EXPECT_EQ(0, buf[0]);
+    EXPECT_EQ(0, dm.GetNumPages());
+
+    for (page_id_t page_id = 0; page_id < 16; ++page_id) {
+      FillTablePage(page, page_id * 1000);
+      dm.WritePage(page_id, page);
+    }
+    FillRandomPage(page, 16);
+    dm.WritePage(16, page);
+    EXPECT_EQ(17, dm.GetNumPages());
+    EXPECT_EQ(1, dm.GetNumUncompressedWrites());
+    // Scenario: compressible pages take a fraction of the space.
+    EXPECT_LT(dm.GetStoredBytes(), 16 * PAGE_SIZE / 4 + PAGE_SIZE);
+
+    // Scenario: a page grows out of its extent and moves; another one shrinks, and moves as well.
+    FillRandomPage(page, 3);
+    dm.WritePage(3, page);
+    FillTablePage(page, 16000);
+    dm.WritePage(16, page);
+    dm.ShutDown();
+  }
+  // 17 pages, and the old extents of the two that moved, in the space of 7
+  EXPECT_LE(FileSize("test.db"), 7 * PAGE_SIZE);
+
+  // Scenario: the indirection table survives a restart.
+  CompressedDiskManager dm("test.db");
+  for (page_id_t page_id = 0; page_id < 17; ++page_id) {
+    if (page_id == 3) {
+      FillRandomPage(page, 3);
+    } else {
+      FillTablePage(page, page_id * 1000);
+    }
+    dm.ReadPage(page_id, buf);
+    EXPECT_EQ(0, memcmp(page, buf, PAGE_SIZE)) << "page " << page_id;
+  }
+  const page_id_t page_ids[] = {5, 1};
+  char bufs[2][PAGE_SIZE];
+  char *page_data[] = {bufs[0], bufs[1]};
+  dm.ReadPages(page_ids, page_data, 2);
+  FillTablePage(page, 5000);
+  EXPECT_EQ(0, memcmp(page, bufs[0], PAGE_SIZE));
+
+  // Scenario: extents freed by a move are reused after the next sync instead of growing the file.
+  FillRandomPage(page, 4);
+  dm.WritePage(4, page);
+  size_t file_size = FileSize("test.db");
+  dm.Sync();
+  for (page_id_t page_id = 17; page_id < 19; ++page_id) {
+    FillTablePage(page, page_id * 1000);
+    dm.WritePage(page_id, page);
+  }
+  EXPECT_EQ(file_size, FileSize("test.db"));
+  dm.ReadPage(18, buf);
+  FillTablePage(page, 18000);
+  EXPECT_EQ(0, memcmp(page, buf, PAGE_SIZE));
+  dm.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, CrashTest) {
+  char page[PAGE_SIZE];
+  char buf[PAGE_SIZE];
+  {
+    CompressedDiskManager dm("test.db");
+    FillRandomPage(page, 7);
+    dm.WritePage(0, page);
+    FillTablePage(page, 1000);
+    dm.WritePage(1, page);
+    dm.Sync();
+    // The crash comes before the next Sync: the rewrite of page 0 is smaller, page 2 is new.
+    FillTablePage(page, 0);
+    dm.WritePage(0, page);
+    dm.WritePage(2, page);
+  }
+
+  // Scenario: the table still points at the old extents, which no write reused.
+  CompressedDiskManager dm("test.db");
+  FillRandomPage(page, 7);
+  dm.ReadPage(0, buf);
+  EXPECT_EQ(0, memcmp(page, buf, PAGE_SIZE));
+  FillTablePage(page, 1000);
+  dm.ReadPage(1, buf);
+  EXPECT_EQ(0, memcmp(page, buf, PAGE_SIZE));
+  dm.ReadPage(2, buf);
+  EXPECT_EQ(0, buf[0]);
+  EXPECT_EQ(0, dm.GetNumChecksumFailures());
+
+  // Scenario: a Sync writes only the changed entries, and the table grows with the page ids.
+  FillTablePage(page, 9000);
+  dm.WritePage(9, page);
+  dm.Sync();
+  EXPECT_EQ(16 + 10 * 16, FileSize("test.ext"));
+  dm.ShutDown();
+  CompressedDiskManager reopened("test.db");
+  reopened.ReadPage(9, buf);
+  EXPECT_EQ(0, memcmp(page, buf, PAGE_SIZE));
+  EXPECT_EQ(10, reopened.GetNumPages());
+  reopened.ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, BufferPoolTest) {
+  auto *disk_manager = new CompressedDiskManager("test.db");
+  auto *bpm = new BufferPoolManagerInstance(4, disk_manager);
+
+  std::vector<page_id_t> page_ids(32);
+  for (auto &page_id : page_ids) {
+    Page *page = bpm->NewPage(&page_id);
+    ASSERT_NE(nullptr, page);
+    FillTablePage(page->GetData(), page_id);
+    EXPECT_TRUE(bpm->UnpinPage(page_id, true));
+  }
+  // Scenario: the buffer pool sees the plain pages.
+  char expected[PAGE_SIZE];
+  for (auto page_id : page_ids) {
+    Page *page = bpm->FetchPage(page_id);
+    ASSERT_NE(nullptr, page);
+    FillTablePage(expected, page_id);
+    EXPECT_EQ(0, memcmp(expected, page->GetData(), PAGE_SIZE));
+    EXPECT_TRUE(bpm->UnpinPage(page_id, false));
+  }
+  bpm->FlushAllPages();
+  EXPECT_LT(FileSize("test.db"), 32 * PAGE_SIZE / 4);
+
+  // Scenario: the extents of deleted pages are released.
+  EXPECT_TRUE(bpm->DeletePage(page_ids[0]));
+  EXPECT_TRUE(bpm->DeletePage(page_ids[1]));
+  EXPECT_EQ(2, disk_manager->TruncateFreeTail());
+  Page *page = bpm->FetchPage(page_ids[0]);
+  ASSERT_NE(nullptr, page);
+  EXPECT_EQ(0, page->GetData()[0]);
+  EXPECT_TRUE(bpm->UnpinPage(page_ids[0], false));
+
+  delete bpm;
+  disk_manager->ShutDown();
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST_F(CompressedDiskManagerTest, DISABLED_CompressionBenchmark) {
+  const int num_pages = 4096;
+  std::vector<char> pages(static_cast<size_t>(num_pages) * PAGE_SIZE);
+  for (int i = 0; i < num_pages; ++i) {
+    FillTablePage(pages.data() + static_cast<size_t>(i) * PAGE_SIZE, i * 128);
+  }
+
+  char compressed[LzCodec::MaxCompressedSize(PAGE_SIZE)];
+  char decompressed[PAGE_SIZE];
+  size_t compressed_bytes = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_pages; ++i) {
+    compressed_bytes += LzCodec::Compress(pages.data() + static_cast<size_t>(i) * PAGE_SIZE, PAGE_SIZE, compressed,
+                                          sizeof(compressed));
+  }
+  auto compress_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  size_t size = LzCodec::Compress(pages.data(), PAGE_SIZE, compressed, sizeof(compressed));
+  start = std::chrono::steady_clock::now();
+  for (int i = 0; i < num_pages; ++i) {
+    LzCodec::Decompress(compressed, size, decompressed, PAGE_SIZE);
+  }
+  auto decompress_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+  double mb = static_cast<double>(num_pages) * PAGE_SIZE / (1 << 20);
+  std::cout << "ratio " << static_cast<double>(num_pages) * PAGE_SIZE / compressed_bytes << ", compress "
+            << mb / compress_s << " MB/s, decompress " << mb / decompress_s << " MB/s" << std::endl;
+
+  for (bool compress : {false, true}) {
+    RemoveFiles();
+    DiskManager *dm = compress ? new CompressedDiskManager("test.db") : new DiskManager("test.db");
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_pages; ++i) {
+      dm->WritePage(i, pages.data() + static_cast<size_t>(i) * PAGE_SIZE);
+    }
+    dm->Sync();
+    auto write_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    start = std::chrono::steady_clock::now();
+    for (int i = 0; i < num_pages; ++i) {
+      dm->ReadPage(i, decompressed);
+    }
+    auto read_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << (compress ? "compressed" : "plain     ") << ": file " << FileSize("test.db") / 1024 << " KiB, write "
+              << num_pages / write_s << " pages/s, read " << num_pages / read_s << " pages/s" << std::endl;
+    dm->ShutDown();
+    delete dm;
+  }
+}
+
+}  // namespace bustub
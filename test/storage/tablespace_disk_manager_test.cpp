@@ -0,0 +1,150 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// tablespace_disk_manager_test.cpp
+//
+// Identification: test/storage/tablespace_disk_manager_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include "storage/disk/tablespace_disk_manager.h"
+
+#include <sys/stat.h>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "common/exception.h"
+#include "gtest/gtest.h"
+#include "storage/disk/async_disk_manager.h"
+
+namespace bustub {
+
+class TablespaceDiskManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override { RemoveFiles(); }
+
+  void TearDown() override { RemoveFiles(); }
+
+  static void RemoveFiles() {
+    for (const std::string name : {"test", "test_hot", "test_cold"}) {
+      for (const char *extension : {".db", ".log", ".crc", ".fsm"}) {
+        remove((name + extension).c_str());
+      }
+    }
+  }
+
+  /** Creates a disk manager with tablespace 1 in test_hot.db, with its own I/O queue, and 2 in test_cold.db. */
+  static auto CreateDiskManager() -> std::unique_ptr<TablespaceDiskManager> {
+    auto disk_manager = std::make_unique<TablespaceDiskManager>("test.db");
+    disk_manager->AddTablespace(1, std::make_unique<AsyncDiskManager>("test_hot.db"));
+    disk_manager->AddTablespace(2, std::make_unique<DiskManager>("test_cold.db"));
+    return disk_manager;
+  }
+};
+
+static auto FileSize(const char *file_name) -> size_t {
+  struct stat stat_buf;
+  return stat(file_name, &stat_buf) == 0 ? static_cast<size_t>(stat_buf.st_size) : 0;
+}
+
+// NOLINTNEXTLINE
+TEST_F(TablespaceDiskManagerTest, ReadWritePageTest) {
+  auto dm = CreateDiskManager();
+  EXPECT_TRUE(dm->HasTablespace(DEFAULT_TABLESPACE_ID));
+  EXPECT_TRUE(dm->HasTablespace(2));
+  EXPECT_FALSE(dm->HasTablespace(3));
+  EXPECT_THROW(dm->AddTablespace(2, std::make_unique<DiskManager>("test_cold.db")), Exception);
+  EXPECT_THROW(dm->AddTablespace(DEFAULT_TABLESPACE_ID, std::make_unique<DiskManager>("test_cold.db")), Exception);
+
+  const page_id_t page_ids[] = {1, FirstPageIdOf(1) + 2, FirstPageIdOf(2), FirstPageIdOf(1)};
+  char data[4][PAGE_SIZE];
+  for (size_t i = 0; i < 4; i++) {
+    std::snprintf(data[i], PAGE_SIZE, "page %d", page_ids[i]);
+  }
+  dm->WritePage(page_ids[0], data[0]);
+  const char *batch[] = {data[1], data[2], data[3]};
+  dm->WritePages(page_ids + 1, batch, 3);
+  dm->Sync();
+
+  // Scenario: each tablespace's pages are stored at their offset within the tablespace's own file.
+  EXPECT_EQ(2 * PAGE_SIZE, FileSize("test.db"));
+  EXPECT_EQ(3 * PAGE_SIZE, FileSize("test_hot.db"));
+  EXPECT_EQ(PAGE_SIZE, FileSize("test_cold.db"));
+
+  char buf[4][PAGE_SIZE];
+  char *bufs[] = {buf[0], buf[1], buf[2], buf[3]};
+  dm->ReadPages(page_ids, bufs, 4);
+  for (size_t i = 0; i < 4; i++) {
+    EXPECT_EQ(0, std::strcmp(data[i], buf[i])) << "page " << page_ids[i];
+  }
+  dm->ReadPage(FirstPageIdOf(1) + 1, buf[0]);
+  EXPECT_EQ(0, buf[0][0]);
+  EXPECT_EQ(4, dm->GetNumWrites());
+
+  // Scenario: pages of a tablespace that does not exist can't be read or written.
+  EXPECT_THROW(dm->WritePage(FirstPageIdOf(3), data[0]), Exception);
+  EXPECT_THROW(dm->ReadPage(FirstPageIdOf(3), buf[0]), Exception);
+  EXPECT_FALSE(dm->HasPage(FirstPageIdOf(3)));
+  EXPECT_TRUE(dm->HasPage(FirstPageIdOf(1) + 2));
+  EXPECT_FALSE(dm->HasPage(FirstPageIdOf(1) + 3));
+
+  // Scenario: free pages are reused within their tablespace, congruent to the allocating instance.
+  dm->DeallocatePage(FirstPageIdOf(1) + 1);
+  dm->DeallocatePage(FirstPageIdOf(1) + 2);
+  EXPECT_EQ(2, dm->GetNumFreePages());
+  EXPECT_EQ(INVALID_PAGE_ID, dm->AllocateFreePage(1, 0, DEFAULT_TABLESPACE_ID));
+  EXPECT_EQ(INVALID_PAGE_ID, dm->AllocateFreePage(1, 0, 3));
+  EXPECT_EQ(FirstPageIdOf(1) + 2, dm->AllocateFreePage(3, (FirstPageIdOf(1) + 2) % 3, 1));
+  dm->DeallocatePage(FirstPageIdOf(1) + 2);
+  EXPECT_EQ(2, dm->TruncateFreeTail());
+  EXPECT_EQ(PAGE_SIZE, FileSize("test_hot.db"));
+  dm->ShutDown();
+}
+
+// NOLINTNEXTLINE
+TEST_F(TablespaceDiskManagerTest, BufferPoolTest) {
+  auto dm = CreateDiskManager();
+  {
+    ParallelBufferPoolManager bpm(3, 5, dm.get());
+    page_id_t page_ids[6];
+    for (int i = 0; i < 6; i++) {
+      Page *page = bpm.NewPage(&page_ids[i], i % 2 == 0 ? 1 : DEFAULT_TABLESPACE_ID);
+      ASSERT_NE(nullptr, page);
+      EXPECT_EQ(i % 2 == 0 ? 1 : DEFAULT_TABLESPACE_ID, TablespaceOf(page_ids[i]));
+      std::snprintf(page->GetData(), PAGE_SIZE, "page %d", page_ids[i]);
+      EXPECT_TRUE(bpm.UnpinPage(page_ids[i], true));
+    }
+    EXPECT_THROW(bpm.NewPage(&page_ids[0], 3), Exception);
+    bpm.FlushAllPages();
+    EXPECT_EQ(3 * PAGE_SIZE, FileSize("test_hot.db"));
+
+    // Scenario: a deleted page is handed out again in its tablespace by the instance it belongs to.
+    EXPECT_TRUE(bpm.DeletePage(page_ids[2]));
+    page_id_t page_id;
+    for (int i = 0; i < 3; i++) {
+      ASSERT_NE(nullptr, bpm.NewPage(&page_id, 1));
+      EXPECT_TRUE(bpm.UnpinPage(page_id, false));
+      if (page_id == page_ids[2]) {
+        break;
+      }
+    }
+    EXPECT_EQ(page_ids[2], page_id);
+  }
+  {
+    BufferPoolManagerInstance bpm(2, dm.get());
+    Page *page = bpm.FetchPage(FirstPageIdOf(1) + 2);
+    ASSERT_NE(nullptr, page);
+    EXPECT_STREQ(("page " + std::to_string(FirstPageIdOf(1) + 2)).c_str(), page->GetData());
+    EXPECT_TRUE(bpm.UnpinPage(page->GetPageId(), false));
+  }
+  dm->ShutDown();
+}
+
+}  // namespace bustub
@@ -0,0 +1,154 @@
+//===----------------------------------------------------------------------===//
+//
+//                         BusTub
+//
+// table_scan_test.cpp
+//
+// Identification: test/table/table_scan_test.cpp
+//
+// Copyright (c) 2015-2021, Carnegie Mellon University Database Group
+//
+//===----------------------------------------------------------------------===//
+
+#include <chrono>  // NOLINT
+#include <cstdio>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "buffer/buffer_pool_manager_instance.h"
+#include "buffer/parallel_buffer_pool_manager.h"
+#include "concurrency/transaction.h"
+#include "gtest/gtest.h"
+#include "logging/common.h"
+#include "storage/table/table_heap.h"
+#include "storage/table/tuple.h"
+
+namespace bustub {
+
+/** A buffer pool that ignores read-ahead hints, to compare scans with and without it. */
+class NoPrefetchBufferPoolManager : public BufferPoolManagerInstance {
+ public:
+  using BufferPoolManagerInstance::BufferPoolManagerInstance;
+  void Prefetch(page_id_t page_id) override {}
+};
+
+/** Fills a table heap with num_tuples copies of a tuple and returns its first page id. */
+static auto BuildTable(BufferPoolManager *bpm, Schema *schema, size_t num_tuples) -> page_id_t {
+  Tuple tuple = ConstructTuple(schema);
+  Transaction txn(0);
+  TableHeap table(bpm, nullptr, nullptr, &txn);
+  for (size_t i = 0; i < num_tuples; ++i) {
+    RID rid;
+    EXPECT_TRUE(table.InsertTuple(tuple, &rid, &txn));
+  }
+  bpm->FlushAllPages();
+  return table.GetFirstPageId();
+}
+
+/** Scans the whole table and returns the number of tuples seen. */
+static auto ScanTable(BufferPoolManager *bpm, page_id_t first_page_id) -> size_t {
+  Transaction txn(0);
+  TableHeap table(bpm, nullptr, nullptr, first_page_id);
+  size_t count = 0;
+  for (auto iter = table.Begin(&txn); iter != table.End(); ++iter) {
+    count++;
+  }
+  return count;
+}
+
+static auto TestSchema() -> Schema {
+  Column col1{"a", TypeId::VARCHAR, 200};
+  Column col2{"b", TypeId::BIGINT};
+  std::vector<Column> cols{col1, col2};
+  return Schema{cols};
+}
+
+// NOLINTNEXTLINE
+TEST(TableScanTest, ReadAheadTest) {
+  // about 30 pages at any page size
+  const size_t num_tuples = 3000 * (PAGE_SIZE / 4096);
+  Schema schema = TestSchema();
+  auto *disk_manager = new DiskManager("test.db");
+  page_id_t first_page_id;
+  {
+    BufferPoolManagerInstance bpm(50, disk_manager);
+    first_page_id = BuildTable(&bpm, &schema, num_tuples);
+  }
+
+  // Cold pool: the scan must see every tuple, and some pages must have arrived through read-ahead.
+  auto *bpm = new BufferPoolManagerInstance(50, disk_manager);
+  EXPECT_EQ(num_tuples, ScanTable(bpm, first_page_id));
+  EXPECT_LT(0, bpm->GetPrefetchedPageCount());
+  EXPECT_EQ(num_tuples, ScanTable(bpm, first_page_id));
+  delete bpm;
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TableScanTest, DISABLED_ColdScanBenchmark) {
+  const size_t num_tuples = 20000;
+  const size_t pool_size = 256;
+  Schema schema = TestSchema();
+  auto *disk_manager = new DiskManager("test.db");
+  page_id_t first_page_id;
+  {
+    BufferPoolManagerInstance bpm(pool_size, disk_manager);
+    first_page_id = BuildTable(&bpm, &schema, num_tuples);
+  }
+
+  for (int run = 0; run < 3; ++run) {
+    for (bool readahead : {false, true}) {
+      BufferPoolManagerInstance *bpm = readahead ? new BufferPoolManagerInstance(pool_size, disk_manager)
+                                                 : new NoPrefetchBufferPoolManager(pool_size, disk_manager);
+      auto start = std::chrono::steady_clock::now();
+      EXPECT_EQ(num_tuples, ScanTable(bpm, first_page_id));
+      auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+      std::cout << "cold scan, read-ahead " << (readahead ? "on " : "off") << ": " << elapsed << " s, "
+                << num_tuples / elapsed << " tuples/s, " << bpm->GetPrefetchedPageCount() << " pages read ahead"
+                << std::endl;
+      delete bpm;
+    }
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+// NOLINTNEXTLINE
+TEST(TableScanTest, DISABLED_PageSizeScanBenchmark) {
+  // Run it in builds with different BUSTUB_PAGE_SIZE; the pool gets the same memory at every page size.
+  const size_t num_tuples = 20000;
+  const size_t pool_bytes = 1 << 20;
+  Schema schema = TestSchema();
+  auto *disk_manager = new DiskManager("test.db");
+  page_id_t first_page_id;
+  {
+    BufferPoolManagerInstance bpm(pool_bytes / PAGE_SIZE, disk_manager);
+    first_page_id = BuildTable(&bpm, &schema, num_tuples);
+  }
+
+  for (int run = 0; run < 3; ++run) {
+    int reads = disk_manager->GetNumReads();
+    auto *bpm = new BufferPoolManagerInstance(pool_bytes / PAGE_SIZE, disk_manager);
+    auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(num_tuples, ScanTable(bpm, first_page_id));
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "cold scan, " << PAGE_SIZE << " byte pages: " << num_tuples / elapsed << " tuples/s, "
+              << disk_manager->GetNumReads() - reads << " pages read" << std::endl;
+    delete bpm;
+  }
+
+  disk_manager->ShutDown();
+  remove("test.db");
+  remove("test.log");
+  delete disk_manager;
+}
+
+}  // namespace bustub